@@ -21,9 +21,12 @@
  */
 
 #include "polynomial/cra_garner.h"
+#include "polynomial/cra_images.h"
 
 #include <cln/integer.h>
 #include <cln/integer_io.h>
+#include <cln/rational.h>
+#include <cln/rational_io.h>
 #include <cln/random.h>
 #include <cln/numtheory.h>
 using namespace cln;
@@ -34,6 +37,8 @@ using namespace cln;
 #include <vector>
 using namespace std;
 
+static cln::cl_I recip2(const cln::cl_I& a, const cln::cl_I& m);
+
 /// Generate a sequences of primes p_i such that \prod_i p_i < limit
 static std::vector<cln::cl_I>
 make_random_moduli(const cln::cl_I& limit);
@@ -88,6 +93,99 @@ static void run_test(const cln::cl_I& limit, const std::size_t ntimes)
 		run_test_once(limit);
 }
 
+/// Same as run_test_once, but reconstruct several numbers at once.
+static void run_batch_test_once(const cln::cl_I& lim, const std::size_t n)
+{
+	std::vector<cln::cl_I> moduli = make_random_moduli(lim);
+	std::vector<cln::cl_I> xs(n);
+	std::vector<std::vector<cln::cl_I> > residues(n);
+	for (std::size_t j = 0; j < n; ++j) {
+		xs[j] = random_I(lim) + 1;
+		if (xs[j] > (lim >> 1))
+			xs[j] = xs[j] - lim;
+		residues[j] = calc_residues(xs[j], moduli);
+	}
+
+	std::vector<cln::cl_I> xs_test = integer_cra(residues, moduli);
+	for (std::size_t j = 0; j < n; ++j) {
+		if (xs[j] != xs_test[j]) {
+			std::cerr << "Expected x = " << xs[j] << ", got " <<
+				xs_test[j] << " instead" << std::endl;
+			std::cerr << "moduli = ";
+			dump(moduli);
+			std::cerr << std::endl;
+			throw std::logic_error("bug in batch integer_cra?");
+		}
+	}
+}
+
+/// Reconstruct a random fraction n/d from n*d^{-1} mod m, where m is the
+/// product of random primes, |n|, d < sqrt(m/2).
+static void run_ratrec_test_once(const cln::cl_I& lim)
+{
+	std::vector<cln::cl_I> moduli = make_random_moduli(lim);
+	cln::cl_I m(1);
+	for (std::size_t i = 0; i < moduli.size(); ++i)
+		m = m*moduli[i];
+	const cln::cl_I bound = isqrt(m >> 1);
+	cln::cl_I num = random_I(2*bound) - bound;
+	cln::cl_I den;
+	do {
+		den = random_I(bound) + 1;
+	} while (gcd(den, m) != 1);
+	const cln::cl_RA x = num/den;
+	num = numerator(x);
+	den = denominator(x);
+
+	std::vector<cln::cl_I> residues(moduli.size());
+	for (std::size_t i = 0; i < moduli.size(); ++i)
+		residues[i] = mod(num*recip2(den, moduli[i]), moduli[i]);
+	const cln::cl_I a = integer_cra(residues, moduli);
+
+	cln::cl_RA x_test;
+	if (!rational_reconstruction(x_test, a, m) || x_test != x) {
+		std::cerr << "Expected " << x << ", got " << x_test
+			<< " instead (a = " << a << ", m = " << m << ")"
+			<< std::endl;
+		throw std::logic_error("bug in rational_reconstruction?");
+	}
+}
+
+/// Reconstruct n random numbers with |x| < lim/2 from their images modulo
+/// word-sized primes, added one prime at a time as the modular algorithms
+/// do, once until the modulus is large enough and once until the result
+/// is stable.
+static void run_images_test_once(const cln::cl_I& lim, const std::size_t n)
+{
+	std::vector<cln::cl_I> xs(n);
+	for (std::size_t j = 0; j < n; ++j)
+		xs[j] = random_I(lim) - (lim >> 1);
+
+	GiNaC::cra_images bounded(n), stable(n, 2);
+	std::vector<cln::cl_I> images(n);
+	cln::cl_I p = cln::cl_I(1) << 20;
+	while (bounded.modulus() <= lim || !stable.stable()) {
+		p = nextprobprime(p + 1);
+		for (std::size_t j = 0; j < n; ++j)
+			images[j] = mod(xs[j], p);
+		if (bounded.modulus() <= lim)
+			bounded.add(images, cl_I_to_long(p));
+		if (!stable.stable())
+			stable.add(images, cl_I_to_long(p));
+	}
+
+	if (bounded.result() != xs || stable.result() != xs) {
+		std::cerr << "Expected ";
+		dump(xs);
+		std::cerr << ", got ";
+		dump(bounded.result());
+		std::cerr << " and ";
+		dump(stable.result());
+		std::cerr << " instead" << std::endl;
+		throw std::logic_error("bug in cra_images?");
+	}
+}
+
 int main(int argc, char** argv)
 {
 	typedef std::map<cln::cl_I, std::size_t> map_t;
@@ -102,11 +200,21 @@ int main(int argc, char** argv)
 	// Run 32 tests with a bit bigger numbers
 	the_map[cln::cl_I("987654321098765432109876543210")] = 32;
 
+	// Run 8 tests with large numbers (lots of moduli, product tree is used)
+	const cln::cl_I huge = cln::cl_I(1) << 4000;
+	the_map[huge] = 8;
+
 	std::cout << "examining Garner's integer chinese remainder algorithm " << std::flush;
 
 	for (map_t::const_iterator i = the_map.begin(); i != the_map.end(); ++i)
 		run_test(i->first, i->second);
 
+	for (map_t::const_iterator i = the_map.begin(); i != the_map.end(); ++i) {
+		run_batch_test_once(i->first, 16);
+		run_ratrec_test_once(i->first);
+		run_images_test_once(i->first, 16);
+	}
+
 	return 0;
 }
 
@@ -143,3 +251,11 @@ static void dump(const std::vector<cln::cl_I>& v)
 		std::cerr << v[i] << " ";
 	std::cerr << "]";
 }
+
+/// Inverse of a modulo m
+static cln::cl_I recip2(const cln::cl_I& a, const cln::cl_I& m)
+{
+	cln::cl_I u, v;
+	xgcd(a, m, &u, &v);
+	return mod(u, m);
+}
@@ -26,6 +26,9 @@ using namespace GiNaC;
 #include <iostream>
 using namespace std;
 
+extern const ex
+swinnerton_dyer(const symbol & x, unsigned n);
+
 static symbol w("w"), x("x"), y("y"), z("z");
 
 static unsigned check_factor(const ex& e)
@@ -202,6 +205,65 @@ static unsigned check_factorization(const exvector& factors)
 	return 0;
 }
 
+/// Many modular factors, but few true ones: the lifted factors are
+/// recombined by lattice reduction.
+static unsigned exam_factor_swinnerton_dyer()
+{
+	unsigned result = 0;
+	symbol x("x");
+
+	result += check_factor(swinnerton_dyer(x, 5));
+	result += check_factor(swinnerton_dyer(x, 3)*swinnerton_dyer(x, 4));
+	result += check_factor(swinnerton_dyer(x, 4)*(pow(x, 3) - 5*x + 7)*(x + 2));
+
+	return result;
+}
+
+/// Two Eisenstein polynomials of degree above 48: the Hensel lifting
+/// multiplies their modular images by Kronecker substitution.
+static unsigned exam_factor_high_degree()
+{
+	unsigned result = 0;
+
+	result += check_factor((pow(x, 64) + 2*pow(x, 5) + 2)*(pow(x, 63) + 3*pow(x, 7) - 3));
+
+	return result;
+}
+
+/// factor_batch() must agree with factor() on every input, also if the
+/// inputs share factors with different multiplicities.
+static unsigned exam_factor_batch()
+{
+	unsigned result = 0;
+	const ex a = x*y + 3*z - 1;
+	const ex b = pow(x, 2) + y + 5;
+	const ex c = x - y;
+	const ex d = pow(x, 3) - 2;
+
+	exvector polys;
+	polys.push_back(expand(a*b*c));
+	polys.push_back(expand(pow(a, 2)*d));
+	polys.push_back(expand(-6*b*pow(c, 3)*d));
+	polys.push_back(expand(x*pow(y, 2)*a*d));
+	polys.push_back(expand(a*b*c*d));
+	polys.push_back(expand(pow(d, 2) - 4));
+	polys.push_back(x);
+	polys.push_back(7);
+	polys.push_back(sin(expand(a*c)) + 1);
+
+	const exvector f = factor_batch(polys, factor_options::all);
+	for ( size_t i=0; i<polys.size(); ++i ) {
+		const ex single = factor(polys[i], factor_options::all);
+		if ( !(f[i] - single).expand().is_zero() || f[i].nops() != single.nops() ) {
+			clog << "factor_batch() gave " << f[i] << " for " << polys[i]
+			     << ", factor() gave " << single << endl;
+			++result;
+		}
+	}
+
+	return result;
+}
+
 static unsigned factor_integer_content_bug()
 {
 	parser reader;
@@ -220,6 +282,9 @@ unsigned exam_factor()
 	result += exam_factor1(); cout << '.' << flush;
 	result += exam_factor2(); cout << '.' << flush;
 	result += exam_factor3(); cout << '.' << flush;
+	result += exam_factor_swinnerton_dyer(); cout << '.' << flush;
+	result += exam_factor_high_degree(); cout << '.' << flush;
+	result += exam_factor_batch(); cout << '.' << flush;
 	result += factor_integer_content_bug();
 	cout << '.' << flush;
 
@@ -21,9 +21,12 @@
  */
 
 #include "ginac.h"
+#include "sparse_matrix.h"
 using namespace GiNaC;
 
 #include <iostream>
+#include <sstream>
+#include <vector>
 using namespace std;
 
 static unsigned exam_lsolve1()
@@ -187,6 +190,140 @@ static unsigned exam_lsolve3S()
 	return result;
 }
 
+static unsigned exam_lsolve_sparse()
+{
+	// A large sparse system, where each equation only couples neighbours
+	unsigned result = 0;
+	const unsigned n = 30;
+	symbol a("a");
+	exvector x;
+	lst eqns, vars;
+	for (unsigned i=0; i<n; ++i) {
+		ostringstream buf;
+		buf << "x" << i;
+		x.push_back(symbol(buf.str()));
+		vars.append(x.back());
+	}
+	for (unsigned i=0; i<n; ++i) {
+		ex lhs = (a+2)*x[i];
+		if (i>0)
+			lhs -= x[i-1];
+		if (i+1<n)
+			lhs -= x[i+1];
+		if (i+3<n)
+			lhs += 2*x[i+3];
+		eqns.append(lhs == numeric(i%3));
+	}
+	const ex sol = lsolve(eqns, vars);
+	if (sol.nops() != n) {
+		++result;
+		clog << "solution of sparse system " << eqns
+		     << " erroneously returned " << sol << endl;
+		return result;
+	}
+	for (unsigned i=0; i<n; ++i) {
+		const ex e = eqns.op(i).lhs() - eqns.op(i).rhs();
+		if (!e.subs(sol).normal().is_zero()) {
+			++result;
+			clog << "solution of sparse system does not satisfy " << eqns.op(i)
+			     << ": " << sol << endl;
+			break;
+		}
+	}
+
+	// An underdetermined and an inconsistent sparse system
+	symbol y1("y1"), y2("y2"), y3("y3"), y4("y4"), y5("y5");
+	lst y(y1, y2, y3, y4, y5);
+	lst under(y1+y2==a, y3-y4==1, y2+y5==0, y1-y5==a);
+	ex usol = lsolve(under, y, solve_algo::markowitz);
+	for (size_t i=0; i<under.nops(); ++i) {
+		if (!(under.op(i).lhs()-under.op(i).rhs()).subs(usol).normal().is_zero()) {
+			++result;
+			clog << "solution of the system " << under << " for " << y
+			     << " erroneously returned " << usol << endl;
+			break;
+		}
+	}
+	lst incons(y1+y2==a, y3-y4==1, y2+y5==0, y1-y5==a+1);
+	ex isol = lsolve(incons, y, solve_algo::markowitz);
+	if (isol.nops() != 0) {
+		++result;
+		clog << "solution of the inconsistent system " << incons << " for " << y
+		     << " erroneously returned " << isol << endl;
+	}
+
+	return result;
+}
+
+static unsigned exam_lsolve_blocks()
+{
+	// A system which decomposes into 3x3 blocks, each depending on the
+	// unknowns of the previous one
+	unsigned result = 0;
+	const unsigned nb = 3;
+	symbol a("a"), b("b");
+	exvector x;
+	lst eqns, vars;
+	for (unsigned i=0; i<3*nb; ++i) {
+		ostringstream buf;
+		buf << "x" << i;
+		x.push_back(symbol(buf.str()));
+		vars.append(x.back());
+	}
+	for (unsigned k=0; k<nb; ++k) {
+		const unsigned i = 3*(nb-k-1);  // equations in reverse order
+		ex e0 = a*x[i] + x[i+1] - b*x[i+2];
+		ex e1 = x[i] + (a+b)*x[i+1] + 2*x[i+2];
+		ex e2 = b*x[i] - x[i+1] + a*x[i+2];
+		if (i>0) {
+			e0 += x[i-1];
+			e2 -= (a-b)*x[i-3];
+		}
+		eqns.append(e0 == 1).append(e1 == a).append(e2 == numeric(k));
+	}
+	// lsolve() only solves block by block if the system decomposes
+	matrix A(3*nb, 3*nb);
+	for (unsigned r=0; r<3*nb; ++r)
+		for (unsigned c=0; c<3*nb; ++c)
+			A(r, c) = eqns.op(r).lhs().coeff(x[c]);
+	std::vector<matrix_block> blocks;
+	if (!block_triangular_form(A, blocks) || blocks.size() != nb) {
+		++result;
+		clog << "the system " << eqns << " was not decomposed into "
+		     << nb << " blocks" << endl;
+	}
+	ex sol = lsolve(eqns, vars);
+	for (size_t i=0; i<eqns.nops(); ++i) {
+		if (!(eqns.op(i).lhs()-eqns.op(i).rhs()).subs(sol).normal().is_zero()) {
+			++result;
+			clog << "solution of the system " << eqns << " for " << vars
+			     << " erroneously returned " << sol << endl;
+			break;
+		}
+	}
+
+	// The second block is singular, so there is a free parameter
+	symbol y1("y1"), y2("y2"), y3("y3"), y4("y4"), y5("y5");
+	lst y(y1, y2, y3, y4, y5);
+	lst sing(y1==a, y2+y3==y1, a*y2+a*y3==a*y1, y4+y2==0, y5-y4==b);
+	sol = lsolve(sing, y);
+	bool ok = sol.nops() == 5;
+	unsigned free_count = 0;
+	for (size_t i=0; ok && i<sol.nops(); ++i)
+		if (sol.op(i).lhs() == sol.op(i).rhs())
+			++free_count;
+	ok = ok && free_count == 1;
+	for (size_t i=0; ok && i<sing.nops(); ++i)
+		ok = (sing.op(i).lhs()-sing.op(i).rhs()).subs(sol).normal().is_zero();
+	if (!ok) {
+		++result;
+		clog << "solution of the system " << sing << " for " << y
+		     << " erroneously returned " << sol << endl;
+	}
+
+	return result;
+}
+
 unsigned exam_lsolve()
 {
 	unsigned result = 0;
@@ -199,6 +336,8 @@ unsigned exam_lsolve()
 	result += exam_lsolve2c();  cout << '.' << flush;
 	result += exam_lsolve2S();  cout << '.' << flush;
 	result += exam_lsolve3S();  cout << '.' << flush;
+	result += exam_lsolve_sparse();  cout << '.' << flush;
+	result += exam_lsolve_blocks();  cout << '.' << flush;
 	
 	return result;
 }
@@ -24,7 +24,9 @@
 using namespace GiNaC;
 
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
+#include <vector>
 using namespace std;
 
 static unsigned matrix_determinants()
@@ -114,6 +116,225 @@ static unsigned matrix_determinants()
 	return result;
 }
 
+static unsigned matrix_determinant_modular()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+	matrix m(5,5);
+
+	// dense bivariate polynomial matrix with rational coefficients
+	for (unsigned r = 0; r < 5; ++r)
+		for (unsigned c = 0; c < 5; ++c)
+			m(r,c) = pow(x, (r*c) % 3) - numeric(int(r+c), 2)*y + (r==c ? x*y : ex(c));
+	ex det_mod = m.determinant(determinant_algo::modular);
+	ex det_lap = m.determinant(determinant_algo::laplace);
+	if (!(det_mod - det_lap).expand().is_zero()) {
+		clog << "modular determinant of " << m
+		     << " erroneously returned " << det_mod
+		     << " instead of " << det_lap << endl;
+		++result;
+	}
+
+	// singular polynomial matrix
+	m(4,0) = m(0,0) + 2*m(1,0);
+	m(4,1) = m(0,1) + 2*m(1,1);
+	m(4,2) = m(0,2) + 2*m(1,2);
+	m(4,3) = m(0,3) + 2*m(1,3);
+	m(4,4) = m(0,4) + 2*m(1,4);
+	det_mod = m.determinant(determinant_algo::modular);
+	if (!det_mod.is_zero()) {
+		clog << "modular determinant of singular matrix " << m
+		     << " erroneously returned " << det_mod << endl;
+		++result;
+	}
+
+	// entries which are not polynomials must fall back to another method
+	m(2,3) = sin(x);
+	m(3,1) = 1/(x-y);
+	det_mod = m.determinant(determinant_algo::modular);
+	det_lap = m.determinant(determinant_algo::laplace);
+	if (!(det_mod - det_lap).normal().is_zero()) {
+		clog << "modular determinant of " << m
+		     << " erroneously returned " << det_mod
+		     << " instead of " << det_lap << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned matrix_determinant_laplace()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+	matrix m(7,7);
+
+	// sparse matrix, only few minors are non-zero
+	for (unsigned r=0; r<7; ++r) {
+		m(r,r) = x+r;
+		m(r,(3*r+1)%7) += y-r;
+		m(r,(5*r+4)%7) -= z;
+	}
+	ex det_lap = m.determinant(determinant_algo::laplace);
+	ex det_bar = m.determinant(determinant_algo::bareiss);
+	if (!(det_lap - det_bar).expand().is_zero()) {
+		clog << "Laplace expansion of " << m
+		     << " erroneously returned " << det_lap
+		     << " instead of " << det_bar << endl;
+		++result;
+	}
+
+	// singular because of a vanishing column
+	for (unsigned r=0; r<7; ++r)
+		m(r,2) = 0;
+	det_lap = m.determinant(determinant_algo::laplace);
+	if (!det_lap.is_zero()) {
+		clog << "Laplace expansion of singular matrix " << m
+		     << " erroneously returned " << det_lap << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned matrix_automatic()
+{
+	unsigned result = 0;
+	symbol x("x");
+	const unsigned n = 6;
+
+	// sparse matrices of quotients of polynomials and of functions
+	for (unsigned k=0; k<2; ++k) {
+		matrix m(n,n), b(n,1), v(n,1);
+		for (unsigned r=0; r<n; ++r) {
+			m(r,r) = 1 + x*r;
+			if (k == 0)
+				m(r,(3*r+1)%n) += 1/(x+r);
+			else
+				m(r,(3*r+1)%n) += sin(x)*r;
+			b(r,0) = r%3;
+			v(r,0) = symbol();
+		}
+		ex det = m.determinant();
+		ex det_bar = m.determinant(determinant_algo::bareiss);
+		if (!(det - det_bar).normal().is_zero()) {
+			clog << "determinant of " << m << " erroneously returned "
+			     << det << " instead of " << det_bar << endl;
+			++result;
+		}
+		matrix sol = m.solve(v, b);
+		if (!ex(m.mul(sol).sub(b)).normal().is_zero_matrix()) {
+			clog << "solution of " << m << " * X == " << b
+			     << " erroneously returned " << sol << endl;
+			++result;
+		}
+	}
+
+	return result;
+}
+
+static std::vector<matrix_algo_record> algo_records;
+
+static void record_algo(const matrix_algo_record & rec)
+{
+	algo_records.push_back(rec);
+}
+
+static unsigned matrix_algo_callback_calls()
+{
+	unsigned result = 0;
+	const matrix_algo_callback previous = set_matrix_algo_callback(record_algo);
+
+	// the grid of the modular algorithm is too large for a generic matrix,
+	// the fallback is reported first
+	const matrix g = ex_to<matrix>(symbolic_matrix(5, 5, "g"));
+	g.determinant();
+	if (algo_records.size() != 2 ||
+	    algo_records[0].algo != determinant_algo::laplace ||
+	    algo_records[1].algo != determinant_algo::modular ||
+	    algo_records[1].requested != determinant_algo::automatic ||
+	    algo_records[1].solve || algo_records[1].rows != 5 ||
+	    algo_records[1].nonzero != 25 || algo_records[1].terms != 25 ||
+	    algo_records[1].numeric || algo_records[1].quotients) {
+		clog << "determinant of " << g << " was not reported correctly" << endl;
+		++result;
+	}
+
+	algo_records.clear();
+	const matrix m = ex_to<matrix>(lst_to_matrix(lst(lst(1, 2), lst(3, 0))));
+	const matrix v = ex_to<matrix>(lst_to_matrix(lst(lst(symbol()), lst(symbol()))));
+	const matrix b = ex_to<matrix>(lst_to_matrix(lst(lst(1), lst(2))));
+	m.solve(v, b, solve_algo::bareiss);
+	if (algo_records.size() != 1 || !algo_records[0].solve ||
+	    algo_records[0].algo != solve_algo::bareiss ||
+	    algo_records[0].nonzero != 3 || !algo_records[0].numeric) {
+		clog << "solution of " << m << " * X == " << b
+		     << " was not reported correctly" << endl;
+		++result;
+	}
+
+	set_matrix_algo_callback(previous);
+	algo_records.clear();
+	g.determinant();
+	if (!algo_records.empty()) {
+		clog << "determinant of " << g << " reported after removing the callback" << endl;
+		++result;
+	}
+
+	return result;
+}
+
+static unsigned matrix_charpoly()
+{
+	unsigned result = 0;
+	symbol x("x"), lambda("lambda");
+	matrix m(6,6);
+
+	// numeric matrices: rational, complex rational and floating point
+	for (unsigned r=0; r<6; ++r)
+		for (unsigned c=0; c<6; ++c)
+			m(r,c) = numeric((int)((3*r+5*c)%7)-3, c%2+1);
+	for (unsigned i=0; i<3; ++i) {
+		if (i == 1)
+			m(2,4) += I;
+		if (i == 2)
+			m(1,1) = numeric(1.5);
+		matrix ml(m);
+		for (unsigned r=0; r<6; ++r)
+			ml(r,r) -= lambda;
+		ex cp = m.charpoly(lambda);
+		ex det = ml.determinant(determinant_algo::laplace);
+		ex diff = (cp - det).expand();
+		for (int k=0; k<=6; ++k) {
+			if (abs(ex_to<numeric>(diff.coeff(lambda,k))) > numeric(1e-10)) {
+				clog << "charpoly of " << m
+				     << " erroneously returned " << cp
+				     << " instead of " << det << endl;
+				++result;
+				break;
+			}
+		}
+	}
+
+	// dense non-polynomial entries
+	for (unsigned r=0; r<6; ++r)
+		for (unsigned c=0; c<6; ++c)
+			m(r,c) = sin(x)*((r+c)%3) + (r*c+1)%4;
+	matrix ml(m);
+	for (unsigned r=0; r<6; ++r)
+		ml(r,r) -= lambda;
+	ex cp = m.charpoly(lambda);
+	ex det = ml.determinant(determinant_algo::laplace);
+	if (!(cp - det).expand().is_zero()) {
+		clog << "charpoly of " << m
+		     << " erroneously returned " << cp
+		     << " instead of " << det << endl;
+		++result;
+	}
+
+	return result;
+}
+
 static unsigned matrix_invert1()
 {
 	unsigned result = 0;
@@ -220,6 +441,231 @@ static unsigned matrix_solve2()
 	return result;
 }
 
+static unsigned matrix_solve_dixon()
+{
+	unsigned result = 0;
+	const unsigned n = 12;
+	matrix A(n,n), B(n,2), X(n,2), Id(n,n);
+	for (unsigned r=0; r<n; ++r) {
+		for (unsigned c=0; c<n; ++c)
+			A(r,c) = numeric((int)((7*r+3*c*c)%19)-9, (r+c)%4+1);
+		B(r,0) = numeric((int)(r%5)-2);
+		B(r,1) = numeric(1, r+1);
+		X(r,0) = symbol();
+		X(r,1) = symbol();
+		Id(r,r) = 1;
+	}
+
+	matrix sol_dixon = A.solve(X, B, solve_algo::dixon);
+	matrix sol_gauss = A.solve(X, B, solve_algo::gauss);
+	if (!sol_dixon.sub(sol_gauss).is_zero_matrix()) {
+		clog << "p-adic solution of " << A << " * X == " << B
+		     << " erroneously returned " << sol_dixon
+		     << " instead of " << sol_gauss << endl;
+		++result;
+	}
+	if (!A.mul(A.inverse()).sub(Id).is_zero_matrix()) {
+		clog << "inverse of " << A << " is wrong" << endl;
+		++result;
+	}
+
+	// singular matrix, handed over to Gauss elimination
+	for (unsigned c=0; c<n; ++c)
+		A(n-1,c) = A(0,c) + A(1,c);
+	for (unsigned r=0; r<n; ++r)
+		B(r,1) = 0;
+	B(n-1,0) = B(0,0) + B(1,0);
+	sol_dixon = A.solve(X, B, solve_algo::dixon);
+	if (!A.mul(sol_dixon).sub(B).expand().is_zero_matrix()) {
+		clog << "p-adic solution of singular system " << A << " * X == "
+		     << B << " erroneously returned " << sol_dixon << endl;
+		++result;
+	}
+	B(n-1,0) += 1;
+	try {
+		A.solve(X, B, solve_algo::dixon);
+		clog << "p-adic solution of inconsistent system " << A
+		     << " * X == " << B << " did not throw" << endl;
+		++result;
+	} catch (const std::runtime_error & e) {
+	}
+
+	return result;
+}
+
+static unsigned matrix_float()
+{
+	unsigned result = 0;
+	const long old_digits = Digits;
+	Digits = 15;
+
+	// larger than one block of the hardware floating point decomposition
+	const unsigned n = 40;
+	matrix A(n,n), Af(n,n), B(n,1), X(n,1);
+	for (unsigned r=0; r<n; ++r) {
+		for (unsigned c=0; c<n; ++c) {
+			A(r,c) = numeric((int)((r*r*c+3*c+5*r)%97)-48, (r+c)%4+1);
+			Af(r,c) = A(r,c).evalf();
+		}
+		B(r,0) = numeric((int)(r%5)-2);
+		X(r,0) = symbol();
+	}
+	const numeric eps = numeric(1, 1000000000);
+
+	const ex det = A.determinant();
+	const ex det_float = Af.determinant();
+	if (!is_a<numeric>(det_float) ||
+	    abs(ex_to<numeric>((det_float - det)/det)) > eps) {
+		clog << "determinant of " << Af << " erroneously returned "
+		     << det_float << " instead of " << det.evalf() << endl;
+		++result;
+	}
+
+	const matrix sol = A.solve(X, B);
+	const matrix sol_float = Af.solve(X, B);
+	for (unsigned r=0; r<n; ++r) {
+		const ex d = sol_float(r,0) - sol(r,0);
+		if (!is_a<numeric>(d) || abs(ex_to<numeric>(d)) > eps) {
+			clog << "solution of " << Af << " * X == " << B
+			     << " erroneously returned " << sol_float
+			     << " instead of " << sol.evalf() << endl;
+			++result;
+			break;
+		}
+	}
+
+	const matrix inv = A.inverse();
+	const matrix inv_float = Af.inverse();
+	for (unsigned i=0; i<n*n; ++i) {
+		const ex d = inv_float(i/n,i%n) - inv(i/n,i%n);
+		if (!is_a<numeric>(d) || abs(ex_to<numeric>(d)) > eps) {
+			clog << "inverse of " << Af << " erroneously returned "
+			     << inv_float << " instead of " << inv.evalf() << endl;
+			++result;
+			break;
+		}
+	}
+
+	symbol lambda("lambda");
+	const ex p = Af.charpoly(lambda);
+	if (!is_a<numeric>(p.coeff(lambda, 0)) ||
+	    abs(ex_to<numeric>((p.coeff(lambda, 0) - det)/det)) > eps ||
+	    p.coeff(lambda, n) != 1) {
+		clog << "charpoly of " << Af << " erroneously returned " << p << endl;
+		++result;
+	}
+
+	// singular because of a vanishing column
+	for (unsigned r=0; r<n; ++r)
+		Af(r,3) = 0;
+	if (!Af.determinant().is_zero()) {
+		clog << "determinant of singular matrix " << Af
+		     << " erroneously returned " << Af.determinant() << endl;
+		++result;
+	}
+
+	Digits = old_digits;
+	return result;
+}
+
+static unsigned matrix_lu_decomposition()
+{
+	unsigned result = 0;
+	symbol a("a"), b("b"), x("x");
+	matrix A(4,4), X(4,1), B(4,1);
+	A = 0, a, 1, 2,
+	    b, 1, 0, a,
+	    1, 2, a*b, 0,
+	    a, 0, 1, 1;
+	X = symbol("x0"), symbol("x1"), symbol("x2"), symbol("x3");
+
+	// same solutions as matrix::solve(), also after archiving
+	lu_decomposition lu(A);
+	archive ar;
+	ar.archive_ex(lu, "lu");
+	std::stringstream ss;
+	ss << ar;
+	ar.clear();
+	ss >> ar;
+	ex lu_ex = ar.unarchive_ex(lst(a, b), "lu");
+	if (!is_a<lu_decomposition>(lu_ex) || !lu_ex.is_equal(lu)) {
+		clog << "archiving " << lu << " erroneously returned " << lu_ex << endl;
+		return ++result;
+	}
+	for (int i=0; i<3; ++i) {
+		B = i, a-i, x, 1;
+		const lu_decomposition & lu2 = ex_to<lu_decomposition>(lu_ex);
+		matrix sol = (i%2 ? lu : lu2).solve(X, B);
+		matrix cmp = A.solve(X, B);
+		if (!ex(sol.sub(cmp)).normal().is_zero_matrix()) {
+			clog << "decomposition of " << A << " solved with " << B
+			     << " erroneously returned " << sol
+			     << " instead of " << cmp << endl;
+			++result;
+		}
+	}
+
+	// underdetermined numeric system
+	matrix C(3,4), Y(4,1), D(3,1);
+	C = 1, 2, 3, 4,
+	    2, 4, 7, 8,
+	    1, 2, 4, 4;
+	Y = symbol("y0"), symbol("y1"), symbol("y2"), symbol("y3");
+	D = 1, 3, 2;
+	lu_decomposition lu3(C);
+	matrix sol = lu3.solve(Y, D);
+	if (lu3.rank() != 2 || !ex(C.mul(sol).sub(D)).normal().is_zero_matrix()
+	    || !sol(1,0).is_equal(Y(1,0)) || !sol(3,0).is_equal(Y(3,0))) {
+		clog << "decomposition of " << C << " solved with " << D
+		     << " erroneously returned " << sol << endl;
+		++result;
+	}
+	D = 1, 3, 3;
+	try {
+		lu3.solve(Y, D);
+		clog << "decomposition of " << C << " solved inconsistent system "
+		     << "with " << D << endl;
+		++result;
+	} catch (const std::runtime_error & e) {
+	}
+
+	return result;
+}
+
+static unsigned matrix_mul()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y");
+
+	// mixed numeric and symbolic entries, some products cancel
+	matrix A(3, 3, lst(
+		1, x, 0,
+		0, y, -1,
+		x, 2, 0
+	)), B(3, 2, lst(
+		x, 1,
+		-1, numeric(2,3),
+		2*x, y
+	)), R(3, 2, lst(
+		0, 1 + numeric(2,3)*x,
+		-y - 2*x, numeric(2,3)*y - y,
+		pow(x, 2) - 2, x + numeric(4,3)
+	));
+	matrix P = A.mul(B);
+	if (!P.sub(R).expand().is_zero_matrix()) {
+		clog << A << " * " << B << " erroneously returned " << P
+		     << " instead of " << R << endl;
+		++result;
+	}
+	if (!is_exactly_a<numeric>(P(0,0)) || !P(0,0).is_zero()) {
+		clog << "entry (0,0) of " << A << " * " << B
+		     << " was not cancelled: " << P(0,0) << endl;
+		++result;
+	}
+
+	return result;
+}
+
 static unsigned matrix_evalm()
 {
 	unsigned result = 0;
@@ -343,10 +789,19 @@ unsigned exam_matrices()
 	cout << "examining symbolic matrix manipulations" << flush;
 	
 	result += matrix_determinants();  cout << '.' << flush;
+	result += matrix_determinant_modular();  cout << '.' << flush;
+	result += matrix_determinant_laplace();  cout << '.' << flush;
+	result += matrix_automatic();  cout << '.' << flush;
+	result += matrix_algo_callback_calls();  cout << '.' << flush;
+	result += matrix_charpoly();  cout << '.' << flush;
 	result += matrix_invert1();  cout << '.' << flush;
 	result += matrix_invert2();  cout << '.' << flush;
 	result += matrix_invert3();  cout << '.' << flush;
 	result += matrix_solve2();  cout << '.' << flush;
+	result += matrix_solve_dixon();  cout << '.' << flush;
+	result += matrix_float();  cout << '.' << flush;
+	result += matrix_lu_decomposition();  cout << '.' << flush;
+	result += matrix_mul();  cout << '.' << flush;
 	result += matrix_evalm();  cout << "." << flush;
 	result += matrix_rank();  cout << "." << flush;
 	result += matrix_misc();  cout << '.' << flush;
@@ -128,10 +128,176 @@ static unsigned exam_sqrfree()
 		     << e2 << endl;
 		++result;
 	}
+	e2 = sqrfree(expand(e1),lst(x,y),sqrfree_algo::modular);
+	if (e1 != e2) {
+		clog << "sqrfree(expand(" << e1 << "),[x,y],modular) erroneously returned "
+		     << e2 << endl;
+		++result;
+	}
+
+	// modular algorithm, also with a content and a numeric factor
+	symbol z("z");
+	e1 = 6*pow(y,2)*(x*y-z+1)*pow(x+y*z-3,2)*pow(pow(x,2)*z-y+5,3);
+	e2 = sqrfree(expand(e1),lst(x,y,z),sqrfree_algo::modular);
+	ex e3 = sqrfree(expand(e1),lst(x,y,z),sqrfree_algo::yun);
+	if (!(e2-e3).expand().is_zero() || e2.nops() != e3.nops()) {
+		clog << "sqrfree(expand(" << e1 << "),[x,y,z],modular) returned "
+		     << e2 << ", Yun's algorithm returned " << e3 << endl;
+		++result;
+	}
 	
 	return result;
 }
 
+static unsigned exam_resultant()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+	ex e1, e2, e3, r;
+
+	e1 = x + pow(y, 2);
+	e2 = 2*pow(x, 3) - 1;
+	r = resultant(e1, e2, x);
+	if (!(r + 1 + 2*pow(y, 6)).expand().is_zero()) {
+		clog << "resultant(" << e1 << "," << e2 << ",x) erroneously returned "
+		     << r << endl;
+		++result;
+	}
+	r = resultant(e1, e2, y);
+	if (!(r - (1 - 4*pow(x, 3) + 4*pow(x, 6))).expand().is_zero()) {
+		clog << "resultant(" << e1 << "," << e2 << ",y) erroneously returned "
+		     << r << endl;
+		++result;
+	}
+
+	// res(x-y, e) = e(x=y)
+	e1 = x - y;
+	e2 = pow(x, 7) - 3*pow(x, 4)*z + pow(z, 2)*x - 5;
+	r = resultant(e1, e2, x);
+	if (!(r - e2.subs(x == y)).expand().is_zero()) {
+		clog << "resultant(" << e1 << "," << e2 << ",x) erroneously returned "
+		     << r << endl;
+		++result;
+	}
+
+	// multiplicativity, rational coefficients and a common factor
+	e1 = pow(x, 6) - y*pow(x, 4) + 2*z*pow(x, 3) - pow(y, 2) + x*z - 7;
+	e2 = pow(x, 5) + 3*y*x - pow(z, 2)*pow(x, 2) + 1;
+	e3 = pow(x, 4) - 2*x*y*z + numeric(1, 3)*z - 4;
+	r = resultant(e1, expand(e2*e3), x);
+	if (!(r - resultant(e1, e2, x)*resultant(e1, e3, x)).expand().is_zero()) {
+		clog << "resultant(" << e1 << "," << expand(e2*e3)
+		     << ",x) is not the product of the resultants" << endl;
+		++result;
+	}
+	r = resultant(expand(e1*e3), expand(e2*e3), x);
+	if (!r.is_zero()) {
+		clog << "resultant(" << expand(e1*e3) << "," << expand(e2*e3)
+		     << ",x) erroneously returned " << r << endl;
+		++result;
+	}
+
+	return result;
+}
+
+/* Check expand_truncated() against expand() followed by dropping the terms
+ * of too high degree. */
+static unsigned check_expand_truncated(const ex & e, const lst & l, int order)
+{
+	const ex r = expand_truncated(e, l, order);
+	const ex full = e.expand();
+	ex ref = 0;
+	for (size_t i = 0; i < full.nops(); ++i) {
+		int d = 0;
+		for (size_t j = 0; j < l.nops(); ++j)
+			d += full.op(i).degree(l.op(j));
+		if (d <= order)
+			ref += full.op(i);
+	}
+	if (!(r - ref).expand().is_zero()) {
+		clog << "expand_truncated(" << e << "," << l << "," << order
+		     << ") erroneously returned " << r << endl;
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned exam_expand_truncated()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), e1("e1"), e2("e2");
+	ex e, r;
+
+	e = pow(1 + e1, 10);
+	r = expand_truncated(e, e1, 3);
+	if (!(r - (1 + 10*e1 + 45*pow(e1, 2) + 120*pow(e1, 3))).expand().is_zero()) {
+		clog << "expand_truncated(" << e << ",e1,3) erroneously returned "
+		     << r << endl;
+		++result;
+	}
+
+	// several symbols and negative powers of them
+	e = pow(1 + e1*x + e2*y + e1*e2, 5) * (1/e1 + e2 - x) * pow(1 - e2, 3);
+	for (int order = -1; order <= 4; ++order)
+		result += check_expand_truncated(e, lst(e1, e2), order);
+
+	// functions of the symbols are coefficients
+	e = sin(e1) * pow(1 + e1 + y, 3) + pow(1 + e1, -1) * (1 + e1);
+	result += check_expand_truncated(e, lst(e1), 1);
+
+	return result;
+}
+
+static unsigned check_expand_mod(const ex & e, const numeric & p)
+{
+	const ex r = expand_mod(e, p);
+	const ex ref = e.expand().smod(p);
+	if (!(r - ref).is_zero()) {
+		clog << "expand_mod(" << e << "," << p << ") erroneously returned "
+		     << r << " instead of " << ref << endl;
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned exam_expand_mod()
+{
+	unsigned result = 0;
+	symbol x("x"), y("y"), z("z");
+	ex e, r;
+
+	e = pow(3*x - 5*y + 7, 20) * (x*y - 2*z + 1);
+	result += check_expand_mod(e, 101);
+	result += check_expand_mod(e, 2147483647L);
+	result += check_expand_mod(e, numeric("18446744073709551557"));
+
+	// functions, roots and inverses of sums are left alone
+	e = pow(sin(x) + 2*sqrt(y) + 1, 5) * (pow(x + 1, -2) - 4*x*pow(y*z, -2));
+	result += check_expand_mod(e, 13);
+
+	// the base of an inverse is expanded
+	e = pow(x*(x + 1) + 3, -1) * pow(x + 1, 2) + pow(x*(y + 1) - x*y, -3);
+	result += check_expand_mod(e, 7);
+
+	// coefficients cancel
+	e = pow(x + 1, 7) - pow(x, 7) - 1;
+	r = expand_mod(e, 7);
+	if (!r.is_zero()) {
+		clog << "expand_mod(" << e << ",7) erroneously returned " << r << endl;
+		++result;
+	}
+
+	// rational coefficients
+	e = pow(x/2 + 1, 3);
+	r = expand_mod(e, 5);
+	if (!(r - (2*pow(x, 3) + 2*pow(x, 2) - x + 1)).is_zero()) {
+		clog << "expand_mod(" << e << ",5) erroneously returned " << r << endl;
+		++result;
+	}
+
+	return result;
+}
+
 /* Arithmetic Operators should behave just as one expects from built-in types.
  * When somebody screws up the operators this routine will most probably fail
  * to compile.  Unfortunately we can only test the stuff that is allowed, not
@@ -308,6 +474,9 @@ unsigned exam_misc()
 	result += exam_expand_subs2();  cout << '.' << flush;
 	result += exam_expand_power(); cout << '.' << flush;
 	result += exam_sqrfree(); cout << '.' << flush;
+	result += exam_resultant(); cout << '.' << flush;
+	result += exam_expand_truncated(); cout << '.' << flush;
+	result += exam_expand_mod(); cout << '.' << flush;
 	result += exam_operator_semantics(); cout << '.' << flush;
 	result += exam_subs(); cout << '.' << flush;
 	result += exam_joris(); cout << '.' << flush;
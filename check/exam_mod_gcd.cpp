@@ -62,9 +62,31 @@ static void run_test_once(const std::size_t deg)
 	}
 }
 
+// Images of the GCD modulo 13 and 29 have a too high degree, they must
+// not be combined with the images modulo other primes
+static void run_unlucky_prime_test()
+{
+	static const symbol x("x");
+	const ex ea = (x + 5)*(-3*pow(x, 16) - 216*pow(x, 15) - 7059*pow(x, 14)
+	  - 137376*pow(x, 13) - 1745829*pow(x, 12) - 14739432*pow(x, 11)
+	  - 76607817*pow(x, 10) - 136268041*pow(x, 9) + 1370915476*pow(x, 8)
+	  + 14063466422*pow(x, 7) + 68586509962*pow(x, 6) + 206692923805*pow(x, 5)
+	  + 380344710123*pow(x, 4) + 334429449699*pow(x, 3) - 125623839827*pow(x, 2)
+	  - 561087988613*x - 371960914074);
+	const ex eb = pow(x + 5, 2);
+
+	upoly g;
+	mod_gcd(g, ex_to_upoly(ea.expand(), x), ex_to_upoly(eb.expand(), x));
+	if (g != ex_to_upoly(x + 5, x)) {
+		std::cerr << "mod_gcd(" << ea << ", " << eb << ") = " << g << std::endl;
+		throw std::logic_error("bug in mod_gcd");
+	}
+}
+
 int main(int argc, char** argv)
 {
 	std::cout << "examining modular gcd. ";
+	run_unlucky_prime_test();
 	std::map<std::size_t, std::size_t> n_map;
 	// run 256 tests with polynomials of degree 10
 	n_map[10] = 256;
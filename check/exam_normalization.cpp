@@ -23,7 +23,9 @@
 #include "ginac.h"
 using namespace GiNaC;
 
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
 using namespace std;
 
 static symbol w("w"), x("x"), y("y"), z("z");
@@ -167,6 +169,61 @@ static unsigned exam_normal4()
 	return result;
 }
 
+/* Rational functions in one variable, large enough for dense polynomials */
+static unsigned exam_normal5()
+{
+	unsigned result = 0;
+	ex e, d;
+
+	// Cancellation of a cyclotomic denominator
+	e = 0;
+	for (int k = 0; k < 20; ++k)
+		e += pow(x, k);
+	e = e * (x - 1) / (pow(x, 20) - 1);
+	d = 1;
+	result += check_normal(e, d);
+
+	// Telescoping sum of partial fractions
+	e = 0;
+	for (int k = 1; k <= 20; ++k)
+		e += 1 / ((x + k) * (x + k + 1));
+	d = 20 / (pow(x, 2) + 22*x + 21);
+	result += check_normal(e, d);
+
+	// Rational coefficients and negative powers
+	e = (pow(x, 16)/4 - numeric(1, 4)) * pow(x/2 - numeric(1, 2), -1);
+	d = 0;
+	for (int k = 0; k < 16; ++k)
+		d += pow(x, k);
+	d = d / 2;
+	result += check_normal(e, d);
+
+	return result;
+}
+
+/* Sums of many fractions in two variables */
+static unsigned exam_normal6()
+{
+	unsigned result = 0;
+	ex e, d;
+
+	// Telescoping sum with an odd number of denominators
+	e = 0;
+	for (int k = 1; k <= 9; ++k)
+		e += y / ((x + k*y) * (x + (k+1)*y));
+	d = 9*y / ((x + y) * (x + 10*y));
+	result += check_normal(e, d);
+
+	// Terms with identical denominators which are not adjacent in the sum
+	e = 0;
+	for (int k = 1; k <= 7; ++k)
+		e += x / (x + k*y) + k*y / (x + k*y);
+	d = 7;
+	result += check_normal(e, d);
+
+	return result;
+}
+
 /* Test content(), integer_content(), primpart(). */
 static unsigned check_content(const ex & e, const ex & x, const ex & ic, const ex & c, const ex & pp)
 {
@@ -218,6 +275,75 @@ static unsigned exam_content()
 	return result;
 }
 
+static unsigned check_zero_probabilistic(const ex & e, bool zero)
+{
+	double error = 1;
+	bool r = is_zero_probabilistic(e, 64, &error);
+	if (r != zero) {
+		clog << "is_zero_probabilistic(" << e << ") erroneously returned "
+		     << r << endl;
+		return 1;
+	}
+	if (zero ? !(error > 0 && error <= std::ldexp(1.0, -64)) : error != 0) {
+		clog << "is_zero_probabilistic(" << e << ") reported error probability "
+		     << error << endl;
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned exam_zero_probabilistic()
+{
+	unsigned result = 0;
+	ex e;
+
+	e = pow(x+y+z, 9) - expand(pow(x+y+z, 9));
+	result += check_zero_probabilistic(e, true);
+	result += check_zero_probabilistic(e + pow(x, 9)/(y+w), false);
+
+	e = 1/(x-1) - 1/(x+1) - 2/(pow(x,2)-1);
+	result += check_zero_probabilistic(e, true);
+	result += check_zero_probabilistic(e + numeric(1, 1000003), false);
+
+	e = (x+I*y)*(x-I*y) - pow(x,2) - pow(y,2);
+	result += check_zero_probabilistic(e, true);
+
+	e = (sqrt(x)+1)*(sqrt(x)-1) - x + 1 + (pow(x, numeric(2,3))-pow(y,4))/(pow(x, numeric(1,3))+pow(y,2));
+	result += check_zero_probabilistic(e, false);
+	result += check_zero_probabilistic(e - pow(x, numeric(1,3)) + pow(y,2), true);
+
+	// the same points for the same seed
+	e = 1/(x-1) - 1/(x+1) - 2/(pow(x,2)-1);
+	for (unsigned long seed = 1; seed < 4; ++seed) {
+		if (!is_zero_probabilistic(e, 64, 0, false, seed) ||
+		    is_zero_probabilistic(e + pow(y, 3), 64, 0, false, seed)) {
+			clog << "is_zero_probabilistic(" << e << ") failed with seed "
+			     << seed << endl;
+			++result;
+		}
+	}
+
+	// not zero as a rational function in x, sin(x) and cos(x)
+	e = pow(sin(x),2) + pow(cos(x),2) - 1;
+	result += check_zero_probabilistic(e, false);
+
+	// the degree is too large for word-sized primes
+	const ex big = pow(x, numeric(1L << 30));
+	e = big*(y+1) - big*y - big;
+	try {
+		is_zero_probabilistic(e);
+		clog << "is_zero_probabilistic(" << e << ") did not throw" << endl;
+		++result;
+	} catch (const std::runtime_error &) {
+	}
+	if (!is_zero_probabilistic(e, 64, 0, true)) {
+		clog << "is_zero_probabilistic(" << e << ") with exact fallback failed" << endl;
+		++result;
+	}
+
+	return result;
+}
+
 unsigned exam_normalization()
 {
 	unsigned result = 0;
@@ -228,7 +354,10 @@ unsigned exam_normalization()
 	result += exam_normal2(); cout << '.' << flush;
 	result += exam_normal3(); cout << '.' << flush;
 	result += exam_normal4(); cout << '.' << flush;
+	result += exam_normal5(); cout << '.' << flush;
+	result += exam_normal6(); cout << '.' << flush;
 	result += exam_content(); cout << '.' << flush;
+	result += exam_zero_probabilistic(); cout << '.' << flush;
 	
 	return result;
 }
@@ -155,3 +155,27 @@ sparse_tree(const symbol & x,
 
 	return 0;
 }
+
+/* Create the Swinnerton-Dyer polynomial in x for the first n primes, the
+ * minimal polynomial of the sum of their square roots.  It is irreducible,
+ * but splits into linear and quadratic factors modulo every prime. */
+const ex
+swinnerton_dyer(const symbol & x, unsigned n)
+{
+	static const int primes[] = { 2, 3, 5, 7, 11, 13, 17 };
+	const symbol y("y");
+	ex sd = x;
+	for (unsigned k = 0; k < n; ++k) {
+		// sd(x - sqrt(p))*sd(x + sqrt(p)) == A^2 - p*B^2
+		const ex t = sd.subs(x == x - y).expand();
+		ex A = 0, B = 0;
+		for (int i = 0; i <= t.degree(y); ++i) {
+			if (i % 2 == 0)
+				A += t.coeff(y, i)*pow(primes[k], i/2);
+			else
+				B += t.coeff(y, i)*pow(primes[k], (i - 1)/2);
+		}
+		sd = (A*A - primes[k]*B*B).expand();
+	}
+	return sd;
+}
@@ -0,0 +1,104 @@
+/** @file time_factor_multivariate.cpp
+ *
+ *  Time factorization of multivariate polynomials. Most of the time is spent
+ *  in the multivariate Hensel lifting. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ginac.h"
+#include "timer.h"
+using namespace GiNaC;
+
+#include <iostream>
+#include <vector>
+using namespace std;
+
+/// Product of (1 + x_1 + ... + x_n)^d + 2 and (1 + x_1^2 + ... + x_n^2)^d + 3.
+static unsigned multivariate_factor(unsigned n, unsigned d)
+{
+	exvector x;
+	for (unsigned i = 0; i < n; ++i)
+		x.push_back(symbol());
+	ex s1 = 1, s2 = 1;
+	for (unsigned i = 0; i < n; ++i) {
+		s1 += x[i];
+		s2 += pow(x[i], 2);
+	}
+	const ex f1 = expand(pow(s1, d) + 2);
+	const ex f2 = expand(pow(s2, d) + 3);
+	const ex p = expand(f1*f2);
+	const ex f = factor(p);
+	if (!is_a<mul>(f) || !(expand(f) - p).is_zero()) {
+		clog << "polynomial " << f1 << " * " << f2
+		     << " was factored as " << f << endl;
+		return 1;
+	}
+	return 0;
+}
+
+unsigned time_factor_multivariate()
+{
+	unsigned result = 0;
+
+	cout << "timing factorization of multivariate polynomials" << flush;
+
+	vector<unsigned> vars;
+	vector<unsigned> degrees;
+	vector<double> times;
+	timer swatch;
+
+	vars.push_back(2); degrees.push_back(4);
+	vars.push_back(2); degrees.push_back(8);
+	vars.push_back(3); degrees.push_back(3);
+	vars.push_back(3); degrees.push_back(5);
+	vars.push_back(4); degrees.push_back(3);
+
+	for (size_t i=0; i<vars.size(); ++i) {
+		int count = 1;
+		swatch.start();
+		result += multivariate_factor(vars[i], degrees[i]);
+		// correct for very small times:
+		while (swatch.read()<0.02) {
+			multivariate_factor(vars[i], degrees[i]);
+			++count;
+		}
+		times.push_back(swatch.read()/count);
+		cout << '.' << flush;
+	}
+
+	// print the report:
+	cout << endl << "	vars/degree:";
+	for (size_t i=0; i<vars.size(); ++i)
+		cout << '\t' << vars[i] << '/' << degrees[i];
+	cout << endl << "	time/s:";
+	for (vector<double>::iterator i=times.begin(); i!=times.end(); ++i)
+		cout << '\t' << *i;
+	cout << endl;
+
+	return result;
+}
+
+extern void randomify_symbol_serials();
+
+int main(int argc, char** argv)
+{
+	randomify_symbol_serials();
+	cout << setprecision(2) << showpoint;
+	return time_factor_multivariate();
+}
@@ -0,0 +1,95 @@
+/** @file time_factor_swinnerton_dyer.cpp
+ *
+ *  Time factorization of Swinnerton-Dyer polynomials. These are irreducible,
+ *  but have a lot of factors modulo every prime, so trying all combinations
+ *  of modular factors takes exponential time. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ginac.h"
+#include "timer.h"
+using namespace GiNaC;
+
+#include <iostream>
+#include <vector>
+using namespace std;
+
+extern const ex
+swinnerton_dyer(const symbol & x, unsigned n);
+
+static unsigned swinnerton_dyer_factor(unsigned n)
+{
+	const symbol x("x");
+	const ex sd = swinnerton_dyer(x, n);
+	const ex f = factor(sd);
+	if (!f.is_equal(sd)) {
+		clog << "Swinnerton-Dyer polynomial of degree " << sd.degree(x)
+		     << " was factored as " << f << endl;
+		return 1;
+	}
+	return 0;
+}
+
+unsigned time_factor_swinnerton_dyer()
+{
+	unsigned result = 0;
+
+	cout << "timing factorization of Swinnerton-Dyer polynomials" << flush;
+
+	vector<unsigned> sizes;
+	vector<double> times;
+	timer swatch;
+
+	sizes.push_back(4);
+	sizes.push_back(5);
+	sizes.push_back(6);
+
+	for (vector<unsigned>::iterator i=sizes.begin(); i!=sizes.end(); ++i) {
+		int count = 1;
+		swatch.start();
+		result += swinnerton_dyer_factor(*i);
+		// correct for very small times:
+		while (swatch.read()<0.02) {
+			swinnerton_dyer_factor(*i);
+			++count;
+		}
+		times.push_back(swatch.read()/count);
+		cout << '.' << flush;
+	}
+
+	// print the report:
+	cout << endl << "	degree:";
+	for (vector<unsigned>::iterator i=sizes.begin(); i!=sizes.end(); ++i)
+		cout << '\t' << (1 << *i);
+	cout << endl << "	time/s:";
+	for (vector<double>::iterator i=times.begin(); i!=times.end(); ++i)
+		cout << '\t' << *i;
+	cout << endl;
+
+	return result;
+}
+
+extern void randomify_symbol_serials();
+
+int main(int argc, char** argv)
+{
+	randomify_symbol_serials();
+	cout << setprecision(2) << showpoint;
+	return time_factor_swinnerton_dyer();
+}
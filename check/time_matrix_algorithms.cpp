@@ -0,0 +1,288 @@
+/** @file time_matrix_algorithms.cpp
+ *
+ *  Time the algorithms of matrix::determinant() and matrix::solve() on
+ *  random matrices of different size and density, next to the algorithm
+ *  chosen by determinant_algo::automatic and solve_algo::automatic.  The
+ *  crossover points of these heuristics are taken from these timings. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ginac.h"
+#include "timer.h"
+using namespace GiNaC;
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+using namespace std;
+
+enum { polynomial, transcendental, rational, generic };
+
+/// An algorithm which took longer than this is not run on larger matrices
+/// of the same density any more, and if it was the automatic choice, these
+/// matrices are skipped altogether.
+static const double time_limit = 0.5;
+
+/// Random rows x cols matrix where about percent % of the entries do not
+/// vanish, but never the ones on the diagonal.  The entries are linear
+/// polynomials in a and b, b is replaced by sin(a) for kind ==
+/// transcendental, and the polynomials are divided by a+k or b+k for kind
+/// == rational.  For kind == generic every entry is a multiple of a symbol
+/// of its own.
+static matrix random_matrix(unsigned rows, unsigned cols, unsigned percent,
+                            int kind, const symbol & a, const symbol & b)
+{
+	matrix M(rows, cols);
+	for (unsigned r=0; r<rows; ++r) {
+		for (unsigned c=0; c<cols; ++c) {
+			if (unsigned(rand()%100) >= percent && r != c)
+				continue;
+			ex e = rand()%7 - 3 + (rand()%7 - 3)*a + (rand()%7 - 3)*b;
+			if (e.is_zero())
+				e = 1;
+			if (kind == transcendental)
+				e = e.subs(b == sin(a));
+			else if (kind == rational)
+				e = e / ((rand()%2 ? a : b) + rand()%5 + 1);
+			else if (kind == generic)
+				e = (rand()%3 + 1)*symbol();
+			M(r, c) = e;
+		}
+	}
+	return M;
+}
+
+/// Records of the calls of determinant() and solve(), in the order in which
+/// they are finished.
+static vector<matrix_algo_record> records;
+
+static void record_algo(const matrix_algo_record & rec)
+{
+	records.push_back(rec);
+}
+
+/// Name of the algorithm in a record.
+static const char * algo_name(bool solve, unsigned algo)
+{
+	static const char * const det_names[] = {
+		"automatic", "gauss", "divfree", "laplace", "bareiss", "modular" };
+	static const char * const solve_names[] = {
+		"blocks", "gauss", "divfree", "bareiss", "markowitz", "dixon" };
+	return solve ? solve_names[algo] : det_names[algo];
+}
+
+/// Describe the choice made for the last call of determinant() or solve().
+/// A failed modular determinant is followed by the name of its fallback.
+static string automatic_choice()
+{
+	const matrix_algo_record & rec = records.back();
+	string name = algo_name(rec.solve, rec.algo);
+	if (!rec.solve && rec.algo == determinant_algo::modular && records.size() > 1)
+		name = name + ">" + algo_name(false, records[records.size() - 2].algo);
+	return name;
+}
+
+/// One section of the timings: the algorithms in algos and the automatic
+/// choice on matrices of all the sizes and densities.  The algorithm
+/// algos[i] is not run on matrices larger than max_sizes[i] at all.
+struct section {
+	const char * what;
+	bool solve;
+	int kind;
+	vector<unsigned> sizes, percents, algos, max_sizes;
+};
+
+/// Time the determinant (if rhs is empty) or the solution of M*x == rhs by
+/// the automatic choice and by all the algorithms of s whose skip flag is
+/// not set yet, and print a line of the table to report.  The flag of the
+/// automatic choice comes first in skip.
+static unsigned time_algorithms(const section & s, const matrix & M, const matrix & rhs,
+                                unsigned percent, vector<bool> & skip, ostream & report)
+{
+	unsigned result = 0;
+	matrix vars(M.cols(), 1);
+	for (unsigned i=0; i<M.cols(); ++i)
+		vars(i, 0) = symbol();
+	timer swatch;
+	matrix first;
+	const unsigned automatic = 0;
+
+	if (skip[0])
+		return result;
+	report << '\t' << M.rows() << '\t' << percent;
+	for (size_t a=0; a<=s.algos.size(); ++a) {
+		const unsigned algo = a ? s.algos[a - 1] : automatic;
+		if (skip[a]) {
+			report << "\t-";
+			continue;
+		}
+		matrix x(1, 1);
+		records.clear();
+		swatch.start();
+		if (s.solve)
+			x = M.solve(vars, rhs, algo);
+		else
+			x(0, 0) = M.determinant(algo);
+		const double time = swatch.read();
+		if (a == 0)
+			report << '\t' << automatic_choice();
+		report << '\t' << time;
+		if (time > time_limit)
+			skip[a] = true;
+		if (a == 0) {
+			first = x;
+			continue;
+		}
+		for (unsigned i=0; i<x.rows(); ++i) {
+			if (!(x(i, 0) - first(i, 0)).normal().is_zero()) {
+				clog << "algorithm " << algo << " for " << M << " and "
+				     << rhs << " gave " << x << " instead of " << first << endl;
+				++result;
+				break;
+			}
+		}
+	}
+	report << endl;
+	cout << '.' << flush;
+	return result;
+}
+
+static unsigned time_section(const section & s, ostream & report)
+{
+	unsigned result = 0;
+	const symbol a("a"), b("b");
+
+	report << "	" << s.what << endl << "	size	non-zero/%	automatic/s";
+	for (size_t i=0; i<s.algos.size(); ++i)
+		report << '\t' << algo_name(s.solve, s.algos[i]) << "/s";
+	report << endl;
+
+	vector<vector<bool> > skip(s.percents.size(), vector<bool>(s.algos.size() + 1));
+	for (size_t n=0; n<s.sizes.size(); ++n) {
+		for (size_t i=0; i<s.percents.size(); ++i) {
+			const unsigned size = s.sizes[n];
+			for (size_t a=0; a<s.algos.size(); ++a)
+				if (size > s.max_sizes[a])
+					skip[i][a + 1] = true;
+			const matrix M = random_matrix(size, size, s.percents[i], s.kind, a, b);
+			const matrix rhs = s.solve ? random_matrix(size, 1, 100, polynomial, a, b)
+			                           : matrix(0, 0);
+			result += time_algorithms(s, M, rhs, s.percents[i], skip[i], report);
+		}
+	}
+	return result;
+}
+
+static section make_section(const char * what, bool solve, int kind,
+                            const unsigned * sizes, size_t nsizes,
+                            const unsigned * percents, size_t npercents,
+                            unsigned algo1, unsigned max_size1,
+                            unsigned algo2, unsigned max_size2)
+{
+	section s;
+	s.what = what;
+	s.solve = solve;
+	s.kind = kind;
+	s.sizes.assign(sizes, sizes + nsizes);
+	s.percents.assign(percents, percents + npercents);
+	s.algos.push_back(algo1);
+	s.algos.push_back(algo2);
+	s.max_sizes.push_back(max_size1);
+	s.max_sizes.push_back(max_size2);
+	return s;
+}
+
+unsigned time_matrix_algorithms()
+{
+	unsigned result = 0;
+	ostringstream report;
+	report << setprecision(2) << showpoint;
+
+	cout << "timing determinant and solve algorithms on sparse matrices" << flush;
+
+	srand(1);
+	const matrix_algo_callback previous = set_matrix_algo_callback(record_algo);
+
+	// Polynomial matrices in few variables: the modular determinant wins
+	// at any size and density.
+	const unsigned det_poly_sizes[] = { 6, 10, 16, 20 };
+	const unsigned det_poly_percents[] = { 10, 40, 100 };
+	result += time_section(make_section("det, polynomial in a and b", false, polynomial,
+	                                    det_poly_sizes, 4, det_poly_percents, 3,
+	                                    determinant_algo::bareiss, 10,
+	                                    determinant_algo::modular, 20),
+	                       report);
+
+	// Other entries: minor expansion wins as long as the zero pattern
+	// leaves it fewer than about 3*row^3 products of entries and minors,
+	// three times the number of steps of Bareiss elimination.
+	const unsigned det_trans_sizes[] = { 6, 8, 10, 12 };
+	const unsigned det_trans_percents[] = { 20, 40, 70, 100 };
+	result += time_section(make_section("det, linear in a and sin(a)", false, transcendental,
+	                                    det_trans_sizes, 4, det_trans_percents, 4,
+	                                    determinant_algo::laplace, 12,
+	                                    determinant_algo::bareiss, 12),
+	                       report);
+
+	// Entries in row or more variables: the divisions of Bareiss
+	// elimination are too expensive, and the modular determinant gives up
+	// since the interpolation grid is too large.
+	const unsigned det_gen_sizes[] = { 6, 8, 10, 12 };
+	const unsigned det_gen_percents[] = { 10, 20, 30 };
+	result += time_section(make_section("det, symbol per entry", false, generic,
+	                                    det_gen_sizes, 4, det_gen_percents, 3,
+	                                    determinant_algo::laplace, 12,
+	                                    determinant_algo::bareiss, 8),
+	                       report);
+
+	// Symbolic systems: Markowitz elimination wins up to about 40%, and
+	// always for quotients of polynomials, where Bareiss elimination is
+	// hopeless beyond 4x4.
+	const unsigned solve_poly_sizes[] = { 6, 8, 12, 16 };
+	const unsigned solve_poly_percents[] = { 10, 30, 100 };
+	result += time_section(make_section("solve, polynomial in a and b", true, polynomial,
+	                                    solve_poly_sizes, 4, solve_poly_percents, 3,
+	                                    solve_algo::bareiss, 12,
+	                                    solve_algo::markowitz, 16),
+	                       report);
+	const unsigned solve_rat_sizes[] = { 4, 8, 12, 16 };
+	const unsigned solve_rat_percents[] = { 10, 20, 40 };
+	result += time_section(make_section("solve, quotients of polynomials", true, rational,
+	                                    solve_rat_sizes, 4, solve_rat_percents, 3,
+	                                    solve_algo::bareiss, 4,
+	                                    solve_algo::markowitz, 16),
+	                       report);
+
+	set_matrix_algo_callback(previous);
+
+	// print the report:
+	cout << endl << report.str();
+
+	return result;
+}
+
+extern void randomify_symbol_serials();
+
+int main(int argc, char** argv)
+{
+	randomify_symbol_serials();
+	cout << setprecision(2) << showpoint;
+	return time_matrix_algorithms();
+}
@@ -0,0 +1,118 @@
+/** @file time_sqrfree_multivariate.cpp
+ *
+ *  Time square-free decomposition of expanded denominators in six variables,
+ *  comparing Yun's algorithm over the integers with the modular variant. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ginac.h"
+#include "timer.h"
+using namespace GiNaC;
+
+#include <iostream>
+#include <vector>
+using namespace std;
+
+/// Expanded (1 + x_1 + ... + x_6)^d * (x_1*x_2 - x_3*x_4 + x_5*x_6 + 2)^2 *
+/// (x_1 - x_2^2 + x_3 + 3*x_6).
+static ex denominator(const exvector & x, unsigned d)
+{
+	ex s = 1;
+	for (unsigned i = 0; i < x.size(); ++i)
+		s += x[i];
+	const ex q = x[0]*x[1] - x[2]*x[3] + x[4]*x[5] + 2;
+	const ex l = x[0] - pow(x[1], 2) + x[2] + 3*x[5];
+	return expand(pow(s, d) * pow(q, 2) * l);
+}
+
+static unsigned check_sqrfree(const ex & p, const ex & f)
+{
+	if (!(expand(f) - p).is_zero()) {
+		clog << "sqrfree(" << p << ") erroneously returned " << f << endl;
+		return 1;
+	}
+	return 0;
+}
+
+unsigned time_sqrfree_multivariate()
+{
+	unsigned result = 0;
+
+	cout << "timing square-free decomposition of multivariate polynomials" << flush;
+
+	exvector x;
+	lst l;
+	for (unsigned i = 0; i < 6; ++i) {
+		x.push_back(symbol());
+		l.append(x[i]);
+	}
+
+	vector<unsigned> degrees;
+	vector<size_t> terms;
+	vector<double> times_yun, times_modular;
+	timer swatch;
+
+	degrees.push_back(1);
+	degrees.push_back(2);
+	degrees.push_back(3);
+	degrees.push_back(4);
+
+	for (size_t i=0; i<degrees.size(); ++i) {
+		const ex p = denominator(x, degrees[i]);
+		terms.push_back(p.nops());
+
+		swatch.start();
+		const ex f_yun = sqrfree(p, l, sqrfree_algo::yun);
+		times_yun.push_back(swatch.read());
+		result += check_sqrfree(p, f_yun);
+
+		swatch.start();
+		const ex f_modular = sqrfree(p, l, sqrfree_algo::modular);
+		times_modular.push_back(swatch.read());
+		result += check_sqrfree(p, f_modular);
+
+		cout << '.' << flush;
+	}
+
+	// print the report:
+	cout << endl << "	degree:";
+	for (size_t i=0; i<degrees.size(); ++i)
+		cout << '\t' << degrees[i] + 6;
+	cout << endl << "	terms:";
+	for (size_t i=0; i<terms.size(); ++i)
+		cout << '\t' << terms[i];
+	cout << endl << "	Yun/s:";
+	for (vector<double>::iterator i=times_yun.begin(); i!=times_yun.end(); ++i)
+		cout << '\t' << *i;
+	cout << endl << "	modular/s:";
+	for (vector<double>::iterator i=times_modular.begin(); i!=times_modular.end(); ++i)
+		cout << '\t' << *i;
+	cout << endl;
+
+	return result;
+}
+
+extern void randomify_symbol_serials();
+
+int main(int argc, char** argv)
+{
+	randomify_symbol_serials();
+	cout << setprecision(2) << showpoint;
+	return time_sqrfree_multivariate();
+}
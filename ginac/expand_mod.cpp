@@ -0,0 +1,334 @@
+/** @file expand_mod.cpp
+ *
+ *  Expansion of expressions with coefficients modulo an integer
+ *  (implementation).
+ *
+ *  The interface function expand_mod() at the end of this file is defined in
+ *  the GiNaC namespace. All other utility functions are defined in an
+ *  additional anonymous namespace.
+ *
+ *  The expression is converted to a sparse polynomial in its "atoms"
+ *  (symbols, functions, non-integer powers, inverses of sums, ...) with
+ *  packed exponent vectors and coefficients in [0, p). Every product of two
+ *  terms is reduced immediately, so the coefficients never grow beyond p^2,
+ *  no matter how large they would become over Z. The result is converted
+ *  back to an expression only once at the end.
+ */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "normal.h"
+#include "ex.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "numeric.h"
+#include "operators.h"
+#include "symbol.h"
+#include "utils.h"
+
+#include <cln/integer.h>
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace GiNaC {
+
+namespace {
+
+/** Z/pZ for p < 2^32, products fit into 64 bits. */
+struct word_mod_ring
+{
+	typedef unsigned long long value_type;
+	value_type p;
+
+	explicit word_mod_ring(const cln::cl_I & p_) : p(cln::cl_I_to_ulong(p_)) { }
+	value_type from_cl_I(const cln::cl_I & c) const { return cln::cl_I_to_ulong(cln::mod(c, cln::cl_I(p))); }
+	cln::cl_I to_cl_I(value_type c) const { return cln::cl_I(static_cast<unsigned long>(c)); }
+	cln::cl_I modulus() const { return to_cl_I(p); }
+	value_type add(value_type a, value_type b) const { value_type c = a + b; return c >= p ? c - p : c; }
+	value_type mul(value_type a, value_type b) const { return (a*b) % p; }
+	static bool is_zero(value_type a) { return a == 0; }
+};
+
+/** Z/pZ for arbitrary p. */
+struct big_mod_ring
+{
+	typedef cln::cl_I value_type;
+	cln::cl_I p;
+
+	explicit big_mod_ring(const cln::cl_I & p_) : p(p_) { }
+	value_type from_cl_I(const cln::cl_I & c) const { return cln::mod(c, p); }
+	cln::cl_I to_cl_I(const value_type & c) const { return c; }
+	cln::cl_I modulus() const { return p; }
+	value_type add(const value_type & a, const value_type & b) const { value_type c = a + b; return c >= p ? c - p : c; }
+	value_type mul(const value_type & a, const value_type & b) const { return cln::mod(a*b, p); }
+	static bool is_zero(const value_type & a) { return zerop(a); }
+};
+
+/** Atoms of an expression: everything expand() treats as indivisible. A
+ *  negative integer power of a sum is stored as a power of the atom 1/sum. */
+struct atom_table
+{
+	exvector atoms;
+	std::map<ex, size_t, ex_is_less> index;
+
+	size_t lookup(const ex & a)
+	{
+		std::map<ex, size_t, ex_is_less>::const_iterator i = index.find(a);
+		if (i != index.end())
+			return i->second;
+		index.insert(std::make_pair(a, atoms.size()));
+		atoms.push_back(a);
+		return atoms.size() - 1;
+	}
+};
+
+/** Sparse polynomial in the atoms. The exponents of term i are
+ *  exps[i*n], ..., exps[i*n+n-1] with n the number of atoms, the terms are
+ *  sorted by their exponents and all coefficients are non-zero. */
+template<typename R>
+struct mod_poly
+{
+	std::vector<int> exps;
+	std::vector<typename R::value_type> coeffs;
+
+	size_t size() const { return coeffs.size(); }
+};
+
+/** Order of the terms of a polynomial by their exponent vectors. */
+struct exps_less
+{
+	const std::vector<int> & exps;
+	const size_t n;
+
+	exps_less(const std::vector<int> & e, size_t n_) : exps(e), n(n_) { }
+	bool operator()(size_t i, size_t j) const
+	{
+		return std::lexicographical_compare(exps.begin() + i*n, exps.begin() + (i + 1)*n,
+		                                    exps.begin() + j*n, exps.begin() + (j + 1)*n);
+	}
+};
+
+/** Sort the (unsorted) terms of a and combine the ones with equal exponents. */
+template<typename R>
+void canonicalize(mod_poly<R> & a, size_t n, const R & ring)
+{
+	std::vector<size_t> perm(a.size());
+	for (size_t i = 0; i < perm.size(); ++i)
+		perm[i] = i;
+	std::sort(perm.begin(), perm.end(), exps_less(a.exps, n));
+
+	mod_poly<R> r;
+	r.exps.reserve(a.exps.size());
+	r.coeffs.reserve(a.size());
+	for (size_t k = 0; k < perm.size(); ) {
+		const size_t i = perm[k];
+		typename R::value_type c = a.coeffs[i];
+		for (++k; k < perm.size() &&
+		          std::equal(a.exps.begin() + i*n, a.exps.begin() + (i + 1)*n,
+		                     a.exps.begin() + perm[k]*n); ++k)
+			c = ring.add(c, a.coeffs[perm[k]]);
+		if (R::is_zero(c))
+			continue;
+		r.exps.insert(r.exps.end(), a.exps.begin() + i*n, a.exps.begin() + (i + 1)*n);
+		r.coeffs.push_back(c);
+	}
+	std::swap(a.exps, r.exps);
+	std::swap(a.coeffs, r.coeffs);
+}
+
+template<typename R>
+void mul_poly(mod_poly<R> & r, const mod_poly<R> & a, const mod_poly<R> & b, size_t n, const R & ring)
+{
+	mod_poly<R> c;
+	c.exps.resize(a.size()*b.size()*n);
+	c.coeffs.reserve(a.size()*b.size());
+	std::vector<int>::iterator e = c.exps.begin();
+	for (size_t i = 0; i < a.size(); ++i) {
+		for (size_t j = 0; j < b.size(); ++j) {
+			for (size_t k = 0; k < n; ++k)
+				*e++ = a.exps[i*n + k] + b.exps[j*n + k];
+			c.coeffs.push_back(ring.mul(a.coeffs[i], b.coeffs[j]));
+		}
+	}
+	// multiplication by a monomial keeps the order of the terms
+	if (a.size() > 1 && b.size() > 1)
+		canonicalize(c, n, ring);
+	else if (std::find_if(c.coeffs.begin(), c.coeffs.end(), R::is_zero) != c.coeffs.end())
+		canonicalize(c, n, ring);
+	std::swap(r.exps, c.exps);
+	std::swap(r.coeffs, c.coeffs);
+}
+
+template<typename R>
+void constant(mod_poly<R> & r, const typename R::value_type & c, size_t n)
+{
+	r.exps.assign(R::is_zero(c) ? 0 : n, 0);
+	r.coeffs.assign(R::is_zero(c) ? 0 : 1, c);
+}
+
+/** Map the rational number c to Z/pZ. */
+template<typename R>
+typename R::value_type to_mod(const numeric & c, const R & ring)
+{
+	if (!c.is_rational())
+		throw std::invalid_argument("expand_mod(): coefficients must be rational");
+	const cln::cl_I num = cln::the<cln::cl_I>(c.numer().to_cl_N());
+	if (c.is_integer())
+		return ring.from_cl_I(num);
+	const cln::cl_I den = cln::the<cln::cl_I>(c.denom().to_cl_N());
+	cln::cl_I u, v;
+	if (cln::xgcd(den, ring.modulus(), &u, &v) != 1)
+		throw std::invalid_argument("expand_mod(): denominator is not invertible modulo p");
+	return ring.mul(ring.from_cl_I(num), ring.from_cl_I(u));
+}
+
+/** Find the atoms of e (or convert e, if atoms is complete), the two passes
+ *  must treat all subexpressions in the same way. */
+template<typename R>
+void to_poly(mod_poly<R> * r, const ex & e, atom_table & t, const R & ring)
+{
+	const size_t n = t.atoms.size();
+	if (is_exactly_a<numeric>(e)) {
+		if (r)
+			constant(*r, to_mod(ex_to<numeric>(e), ring), n);
+	} else if (is_exactly_a<add>(e) || is_exactly_a<mul>(e)) {
+		const bool is_add = is_exactly_a<add>(e);
+		if (r)
+			constant(*r, ring.from_cl_I(is_add ? 0 : 1), n);
+		for (size_t i = 0; i < e.nops(); ++i) {
+			if (!r) {
+				to_poly<R>(0, e.op(i), t, ring);
+				continue;
+			}
+			mod_poly<R> f;
+			to_poly(&f, e.op(i), t, ring);
+			if (is_add) {
+				r->exps.insert(r->exps.end(), f.exps.begin(), f.exps.end());
+				r->coeffs.insert(r->coeffs.end(), f.coeffs.begin(), f.coeffs.end());
+			} else
+				mul_poly(*r, *r, f, n, ring);
+		}
+		if (r && is_add)
+			canonicalize(*r, n, ring);
+	} else if (is_exactly_a<power>(e) && e.op(1).info(info_flags::posint) &&
+	           !is_a<symbol>(e.op(0))) {
+		// repeated multiplication by the base is cheaper than squaring
+		// for sparse polynomials
+		if (!r) {
+			to_poly<R>(0, e.op(0), t, ring);
+			return;
+		}
+		const long k = ex_to<numeric>(e.op(1)).to_long();
+		mod_poly<R> base;
+		to_poly(&base, e.op(0), t, ring);
+		*r = base;
+		for (long j = 1; j < k; ++j)
+			mul_poly(*r, *r, base, n, ring);
+	} else {
+		// atoms and integer powers of them, 1/(a+b)^k = (1/(a+b))^k
+		ex a = e;
+		int k = 1;
+		if (is_exactly_a<power>(e) && e.op(1).info(info_flags::integer) &&
+		    (is_a<symbol>(e.op(0)) || !is_exactly_a<mul>(e.op(0)))) {
+			a = e.op(0);
+			k = ex_to<numeric>(e.op(1)).to_int();
+			if (is_exactly_a<add>(a)) {
+				// expand() expands the base of the power first
+				const ex b = a.expand();
+				if (!is_exactly_a<add>(b)) {
+					to_poly(r, pow(b, e.op(1)), t, ring);
+					return;
+				}
+				a = (new power(b, _ex_1))->setflag(status_flags::dynallocated);
+				k = -k;
+			}
+		} else {
+			const ex x = e.expand();
+			if (!x.is_equal(e) && (is_exactly_a<add>(x) || is_exactly_a<mul>(x) ||
+			                       is_exactly_a<numeric>(x) || is_exactly_a<power>(x))) {
+				to_poly(r, x, t, ring);
+				return;
+			}
+			a = x;
+		}
+		if (!r) {
+			t.lookup(a);
+			return;
+		}
+		constant(*r, ring.from_cl_I(1), n);
+		r->exps[t.index.find(a)->second] = k;
+	}
+}
+
+template<typename R>
+ex expand_mod(const ex & e, const numeric & p, const R & ring)
+{
+	atom_table t;
+	to_poly<R>(0, e, t, ring);
+	const size_t n = t.atoms.size();
+	mod_poly<R> a;
+	to_poly(&a, e, t, ring);
+
+	exvector terms;
+	terms.reserve(a.size());
+	exvector factors;
+	for (size_t i = 0; i < a.size(); ++i) {
+		factors.clear();
+		for (size_t k = 0; k < n; ++k) {
+			const int d = a.exps[i*n + k];
+			if (d == 1)
+				factors.push_back(t.atoms[k]);
+			else if (d != 0)
+				factors.push_back((new power(t.atoms[k], d))->setflag(status_flags::dynallocated));
+		}
+		factors.push_back(smod(numeric(ring.to_cl_I(a.coeffs[i])), p));
+		terms.push_back((new mul(factors))->setflag(status_flags::dynallocated));
+	}
+	return (new add(terms))->setflag(status_flags::dynallocated);
+}
+
+} // anonymous namespace
+
+
+/** Expand an expression with the coefficients reduced modulo p. The
+ *  coefficients are reduced after every multiplication of two terms, so
+ *  they stay small, and the result is the same as expand() followed by
+ *  smod(p), only much cheaper for large expansions. Rational coefficients
+ *  are mapped to Z/pZ by inverting their denominators.
+ *
+ *  @param e  expression to expand
+ *  @param p  modulus, usually a word-sized prime
+ *  @return expanded expression with coefficients in the symmetric range
+ *          of Z/pZ
+ *  @exception invalid_argument if p is not an integer > 1, a coefficient
+ *             is not rational or a denominator is not invertible modulo p */
+ex expand_mod(const ex & e, const numeric & p)
+{
+	if (!p.is_integer() || !(p > *_num1_p))
+		throw std::invalid_argument("expand_mod(): modulus must be an integer > 1");
+	const cln::cl_I q = cln::the<cln::cl_I>(p.to_cl_N());
+	if (q < cln::cl_I(1) << 32)
+		return expand_mod(e, p, word_mod_ring(q));
+	return expand_mod(e, p, big_mod_ring(q));
+}
+
+} // namespace GiNaC
@@ -0,0 +1,266 @@
+/** @file expand_truncated.cpp
+ *
+ *  Truncated expansion of expressions (implementation).
+ *
+ *  The interface function expand_truncated() at the end of this file is
+ *  defined in the GiNaC namespace. All other utility functions are defined
+ *  in an additional anonymous namespace.
+ *
+ *  The degree of a monomial is the sum of the exponents of the truncation
+ *  symbols in it, everything else (other symbols, functions, powers of sums,
+ *  ...) counts as part of the coefficient. Products and positive integer
+ *  powers of sums are multiplied out term by term, and products of terms
+ *  which cannot contribute to a result of degree <= N are never formed. To
+ *  decide this, every factor of a product gets a lower bound on the degree
+ *  of its terms, so negative powers of the truncation symbols are handled
+ *  correctly.
+ */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "normal.h"
+#include "ex.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "numeric.h"
+#include "operators.h"
+#include "symbol.h"
+#include "utils.h"
+
+#include <stdexcept>
+#include <vector>
+
+namespace GiNaC {
+
+namespace {
+
+/** Truncation symbols and the degree bound. */
+struct trunc_context
+{
+	exvector vars;
+	numeric order;
+
+	bool is_var(const ex & e) const
+	{
+		for (exvector::const_iterator i = vars.begin(); i != vars.end(); ++i)
+			if (i->is_equal(e))
+				return true;
+		return false;
+	}
+
+	bool has_var(const ex & e) const
+	{
+		for (exvector::const_iterator i = vars.begin(); i != vars.end(); ++i)
+			if (e.has(*i))
+				return true;
+		return false;
+	}
+};
+
+/** Degree of the power e of a truncation symbol, zero if e is something
+ *  else. */
+numeric factor_degree(const ex & e, const trunc_context & c)
+{
+	if (c.is_var(e))
+		return *_num1_p;
+	if (is_exactly_a<power>(e) && c.is_var(e.op(0))) {
+		if (!is_exactly_a<numeric>(e.op(1)) || !ex_to<numeric>(e.op(1)).is_real())
+			throw std::invalid_argument("expand_truncated(): non-numeric power of a truncation symbol");
+		return ex_to<numeric>(e.op(1));
+	}
+	return *_num0_p;
+}
+
+/** Degree of a monomial. */
+numeric term_degree(const ex & t, const trunc_context & c)
+{
+	if (is_exactly_a<mul>(t)) {
+		numeric d = *_num0_p;
+		for (size_t i = 0; i < t.nops(); ++i)
+			d += factor_degree(t.op(i), c);
+		return d;
+	}
+	return factor_degree(t, c);
+}
+
+/** Lower bound on the degrees of the terms of e after expansion. */
+numeric low_degree(const ex & e, const trunc_context & c)
+{
+	if (is_exactly_a<add>(e)) {
+		numeric d = low_degree(e.op(0), c);
+		for (size_t i = 1; i < e.nops(); ++i) {
+			const numeric di = low_degree(e.op(i), c);
+			if (di < d)
+				d = di;
+		}
+		return d;
+	}
+	if (is_exactly_a<mul>(e)) {
+		numeric d = *_num0_p;
+		for (size_t i = 0; i < e.nops(); ++i)
+			d += low_degree(e.op(i), c);
+		return d;
+	}
+	if (is_exactly_a<power>(e) && !c.is_var(e.op(0)) &&
+	    e.op(1).info(info_flags::posint))
+		return ex_to<numeric>(e.op(1)) * low_degree(e.op(0), c);
+	return factor_degree(e, c);
+}
+
+/** Sum of the terms of e with degree <= max_deg. */
+ex truncate(const ex & e, const numeric & max_deg, const trunc_context & c)
+{
+	if (!is_exactly_a<add>(e))
+		return term_degree(e, c) > max_deg ? _ex0 : e;
+
+	exvector terms;
+	terms.reserve(e.nops());
+	for (size_t i = 0; i < e.nops(); ++i) {
+		const ex t = e.op(i);
+		if (!(term_degree(t, c) > max_deg))
+			terms.push_back(t);
+	}
+	return (new add(terms))->setflag(status_flags::dynallocated);
+}
+
+/** Product of the expanded expressions a and b, without the terms of
+ *  degree > max_deg. */
+ex mul_truncated(const ex & a, const ex & b, const numeric & max_deg, const trunc_context & c)
+{
+	if (!is_exactly_a<add>(a) && !is_exactly_a<add>(b))
+		return truncate(a * b, max_deg, c);
+
+	exvector ta, tb;
+	std::vector<numeric> da, db;
+	const ex aa = is_exactly_a<add>(a) ? a : lst(a);
+	const ex bb = is_exactly_a<add>(b) ? b : lst(b);
+	ta.reserve(aa.nops());
+	da.reserve(aa.nops());
+	for (size_t i = 0; i < aa.nops(); ++i) {
+		ta.push_back(aa.op(i));
+		da.push_back(term_degree(ta.back(), c));
+	}
+	tb.reserve(bb.nops());
+	db.reserve(bb.nops());
+	for (size_t i = 0; i < bb.nops(); ++i) {
+		tb.push_back(bb.op(i));
+		db.push_back(term_degree(tb.back(), c));
+	}
+
+	exvector prod;
+	for (size_t i = 0; i < ta.size(); ++i) {
+		for (size_t j = 0; j < tb.size(); ++j) {
+			if (!(da[i] + db[j] > max_deg))
+				prod.push_back(ta[i] * tb[j]);
+		}
+	}
+	return (new add(prod))->setflag(status_flags::dynallocated);
+}
+
+/** Expansion of e without the terms of degree > max_deg. */
+ex truncated_expand(const ex & e, const numeric & max_deg, const trunc_context & c)
+{
+	if (!c.has_var(e))
+		return e.expand();
+
+	if (is_exactly_a<add>(e)) {
+		exvector terms;
+		terms.reserve(e.nops());
+		for (size_t i = 0; i < e.nops(); ++i)
+			terms.push_back(truncated_expand(e.op(i), max_deg, c));
+		return (new add(terms))->setflag(status_flags::dynallocated);
+	}
+
+	if (is_exactly_a<mul>(e)) {
+		// Every factor only needs the terms which can be combined with
+		// the lowest terms of the other factors
+		const size_t n = e.nops();
+		std::vector<numeric> low(n);
+		numeric low_sum = *_num0_p;
+		for (size_t i = 0; i < n; ++i) {
+			low[i] = low_degree(e.op(i), c);
+			low_sum += low[i];
+		}
+		if (low_sum > max_deg)
+			return _ex0;
+
+		ex result = _ex1;
+		numeric low_rest = low_sum;
+		for (size_t i = 0; i < n; ++i) {
+			low_rest -= low[i];
+			const ex f = truncated_expand(e.op(i), max_deg - low_sum + low[i], c);
+			result = mul_truncated(result, f, max_deg - low_rest, c);
+			if (result.is_zero())
+				break;
+		}
+		return result;
+	}
+
+	if (is_exactly_a<power>(e) && !c.is_var(e.op(0)) &&
+	    e.op(1).info(info_flags::posint)) {
+		const long n = ex_to<numeric>(e.op(1)).to_long();
+		const numeric low = low_degree(e.op(0), c);
+		if (n * low > max_deg)
+			return _ex0;
+		const ex b = truncated_expand(e.op(0), max_deg - (n - 1) * low, c);
+		if (!is_exactly_a<add>(b))
+			return truncate(pow(b, n).expand(), max_deg, c);
+		ex result = b;
+		for (long k = 2; k <= n; ++k)
+			result = mul_truncated(result, b, max_deg - (n - k) * low, c);
+		return result;
+	}
+
+	return truncate(e.expand(), max_deg, c);
+}
+
+} // anonymous namespace
+
+
+/** Expand an expression and discard all terms whose total degree in the
+ *  given symbols exceeds a bound. Terms of higher degree are not generated
+ *  in the first place, which is much cheaper than expand() followed by
+ *  series() or coeff(). The degree of a term is the sum of the exponents of
+ *  the symbols in it; anything else, e.g. 1/(1+eps) or sin(eps), is treated
+ *  as a coefficient.
+ *
+ *  @param e  expression to expand
+ *  @param l  symbol or lst of symbols
+ *  @param order  maximal degree of the terms which are kept
+ *  @return expanded expression without the terms of degree > order
+ *  @exception invalid_argument if a symbol appears with a non-numeric
+ *             exponent */
+ex expand_truncated(const ex & e, const ex & l, int order)
+{
+	trunc_context c;
+	if (is_a<lst>(l)) {
+		for (size_t i = 0; i < l.nops(); ++i)
+			c.vars.push_back(l.op(i));
+	} else
+		c.vars.push_back(l);
+	for (exvector::const_iterator i = c.vars.begin(); i != c.vars.end(); ++i)
+		if (!is_a<symbol>(*i))
+			throw std::invalid_argument("expand_truncated(): truncation variables must be symbols");
+	c.order = order;
+
+	return truncated_expand(e, c.order, c);
+}
+
+} // namespace GiNaC
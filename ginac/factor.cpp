@@ -11,8 +11,10 @@
  *  proceeds either in dedicated univariate or multivariate factorization code.
  *
  *  Univariate factorization does a modular factorization via Berlekamp's
- *  algorithm and distinct degree factorization. Hensel lifting is used at the
- *  end.
+ *  algorithm and distinct degree factorization. All modular factors are lifted
+ *  at once by quadratic Hensel lifting and then recombined, either by trying
+ *  all subsets of them or, if there are many, by van Hoeij's lattice based
+ *  algorithm [vH].
  *  
  *  Multivariate factorization uses the univariate factorization (applying a
  *  evaluation homomorphism first) and Hensel lifting raises the answer to the
@@ -26,10 +28,22 @@
  *    [GCL] Algorithms for Computer Algebra,
  *          K.O.Geddes, S.R.Czapor, G.Labahn,
  *          Springer Verlag, 1992.
+ *    [Coh] A Course in Computational Algebraic Number Theory,
+ *          H.Cohen,
+ *          Springer Verlag, 1993.
+ *    [GG]  Modern Computer Algebra,
+ *          J.von zur Gathen, J.Gerhard,
+ *          Cambridge University Press, 1999.
  *    [Mig] Some Useful Bounds,
  *          M.Mignotte, 
  *          In "Computer Algebra, Symbolic and Algebraic Computation" (B.Buchberger et al., eds.),
  *          pp. 259-263, Springer-Verlag, New York, 1982.
+ *    [Sho] A new polynomial factorization algorithm and its implementation,
+ *          V.Shoup,
+ *          Journal of Symbolic Computation, Vol. 20 (1995) 363--397.
+ *    [vH]  Factoring polynomials and the knapsack problem,
+ *          M.van Hoeij,
+ *          Journal of Number Theory, Vol. 95 (2002) 167--189.
  */
 
 /*
@@ -64,11 +78,13 @@
 #include "mul.h"
 #include "normal.h"
 #include "add.h"
+#include "utils.h"
 
 #include <algorithm>
 #include <cmath>
 #include <limits>
 #include <list>
+#include <map>
 #include <vector>
 #ifdef DEBUGFACTOR
 #include <ostream>
@@ -308,51 +324,164 @@ operator-(const T& a, const T& b)
 	}
 }
 
-static upoly operator*(const upoly& a, const upoly& b)
-{
-	upoly c;
-	if ( a.empty() || b.empty() ) return c;
+/// Polynomials with less than that many terms are multiplied by the classical
+/// algorithm, Karatsuba's algorithm is used otherwise.
+static const int karatsuba_threshold = 16;
 
-	int n = degree(a) + degree(b);
-	c.resize(n+1, 0);
-	for ( int i=0 ; i<=n; ++i ) {
-		for ( int j=0 ; j<=i; ++j ) {
-			if ( j > degree(a) || (i-j) > degree(b) ) continue;
-			c[i] = c[i] + a[j] * b[i-j];
+/// Multiply by Kronecker substitution if both factors have at least that many
+/// terms. The factors are converted to integer polynomials and packed into big
+/// integers, so the product is computed by the (asymptotically fast) integer
+/// multiplication of CLN.
+static const int kronecker_threshold = 48;
+
+/// Classical multiplication, c[0..na+nb-2] += a[0..na-1]*b[0..nb-1]
+template<typename T>
+static void mul_classical(const T* a, int na, const T* b, int nb, T* c)
+{
+	for ( int i=0; i<na; ++i ) {
+		if ( zerop(a[i]) ) continue;
+		for ( int j=0; j<nb; ++j ) {
+			c[i+j] = c[i+j] + a[i] * b[j];
 		}
 	}
-	canonicalize(c);
-	return c;
 }
 
-static umodpoly operator*(const umodpoly& a, const umodpoly& b)
+/// Karatsuba multiplication of polynomials having n terms each,
+/// c[0..2n-2] = a[0..n-1]*b[0..n-1]
+template<typename T>
+static void mul_karatsuba(const T* a, const T* b, int n, T* c, const T& zero)
 {
-	umodpoly c;
-	if ( a.empty() || b.empty() ) return c;
+	if ( n < karatsuba_threshold ) {
+		std::fill(c, c + 2*n - 1, zero);
+		mul_classical(a, n, b, n, c);
+		return;
+	}
+
+	// a = a0 + a1 x^m, b = b0 + b1 x^m, deg(a0) < m, deg(a1) < h
+	const int m = n/2;
+	const int h = n - m;
+	mul_karatsuba(a, b, m, c, zero);
+	c[2*m-1] = zero;
+	mul_karatsuba(a + m, b + m, h, c + 2*m, zero);
+
+	// (a0 + a1)(b0 + b1) - a0 b0 - a1 b1 = a0 b1 + a1 b0
+	vector<T> sa(a + m, a + n), sb(b + m, b + n);
+	for ( int i=0; i<m; ++i ) {
+		sa[i] = sa[i] + a[i];
+		sb[i] = sb[i] + b[i];
+	}
+	vector<T> mid(2*h - 1, zero);
+	mul_karatsuba(&sa[0], &sb[0], h, &mid[0], zero);
+	for ( int i=0; i<2*m-1; ++i ) {
+		mid[i] = mid[i] - c[i];
+	}
+	for ( int i=0; i<2*h-1; ++i ) {
+		mid[i] = mid[i] - c[2*m+i];
+	}
+	for ( int i=0; i<2*h-1; ++i ) {
+		c[m+i] = c[m+i] + mid[i];
+	}
+}
 
-	int n = degree(a) + degree(b);
-	c.resize(n+1, a[0].ring()->zero());
-	for ( int i=0 ; i<=n; ++i ) {
-		for ( int j=0 ; j<=i; ++j ) {
-			if ( j > degree(a) || (i-j) > degree(b) ) continue;
-			c[i] = c[i] + a[j] * b[i-j];
+/// c[0..na+nb-2] += a[0..na-1]*b[0..nb-1]. The longer factor is split into
+/// chunks of the length of the shorter one, which are multiplied by Karatsuba's
+/// algorithm.
+template<typename T>
+static void mul_unbalanced(const T* a, int na, const T* b, int nb, T* c, const T& zero)
+{
+	if ( na < nb ) {
+		std::swap(a, b);
+		std::swap(na, nb);
+	}
+	if ( nb < karatsuba_threshold ) {
+		mul_classical(a, na, b, nb, c);
+		return;
+	}
+	vector<T> tmp(2*nb - 1, zero);
+	for ( int k=0; k<na; k+=nb ) {
+		const int len = std::min(nb, na - k);
+		if ( len < nb ) {
+			mul_unbalanced(a + k, len, b, nb, c + k, zero);
+			break;
+		}
+		mul_karatsuba(a + k, b, nb, &tmp[0], zero);
+		for ( int i=0; i<2*nb-1; ++i ) {
+			c[k+i] = c[k+i] + tmp[i];
 		}
 	}
-	canonicalize(c);
-	return c;
 }
 
-static upoly operator*(const upoly& a, const cl_I& x)
+/// Evaluate a[lo..hi-1] at 2^bits (Kronecker substitution)
+static cl_I kronecker_pack(const upoly& a, size_t lo, size_t hi, uintC bits)
 {
-	if ( zerop(x) ) {
-		upoly r;
-		return r;
+	if ( hi - lo == 1 ) {
+		return a[lo];
 	}
-	upoly r(a.size());
+	const size_t mid = lo + (hi - lo)/2;
+	return kronecker_pack(a, lo, mid, bits) +
+	       (kronecker_pack(a, mid, hi, bits) << (bits*(mid - lo)));
+}
+
+/// Inverse of kronecker_pack, the coefficients c[lo..hi-1] must be less than
+/// 2^(bits-1) in absolute value.
+static void kronecker_unpack(upoly& c, size_t lo, size_t hi, const cl_I& x, uintC bits)
+{
+	if ( hi - lo == 1 ) {
+		c[lo] = x;
+		return;
+	}
+	const size_t mid = lo + (hi - lo)/2;
+	const uintC shift = bits*(mid - lo);
+	cl_I low = ldb(x, cl_byte(shift, 0));
+	if ( logbitp(shift - 1, low) ) {
+		low = low - (cl_I(1) << shift);
+	}
+	kronecker_unpack(c, lo, mid, low, bits);
+	kronecker_unpack(c, mid, hi, (x - low) >> shift, bits);
+}
+
+static uintC max_coeff_length(const upoly& a)
+{
+	uintC len = 0;
 	for ( size_t i=0; i<a.size(); ++i ) {
-		r[i] = a[i] * x;
+		len = std::max(len, integer_length(abs(a[i])));
 	}
-	return r;
+	return len;
+}
+
+static upoly mul_kronecker(const upoly& a, const upoly& b)
+{
+	// |c_i| <= min(na, nb)*max|a_i|*max|b_i|, plus one bit for the sign
+	const uintC bits = max_coeff_length(a) + max_coeff_length(b) +
+		integer_length(cl_I(std::min(a.size(), b.size()))) + 1;
+	const cl_I x = kronecker_pack(a, 0, a.size(), bits) *
+		       kronecker_pack(b, 0, b.size(), bits);
+	upoly c(a.size() + b.size() - 1);
+	kronecker_unpack(c, 0, c.size(), x, bits);
+	return c;
+}
+
+static umodpoly operator*(const umodpoly& a, const umodpoly& b)
+{
+	umodpoly c;
+	if ( a.empty() || b.empty() ) return c;
+
+	const int na = a.size();
+	const int nb = b.size();
+	const cl_modint_ring& R = a[0].ring();
+	if ( std::min(na, nb) >= kronecker_threshold ) {
+		upoly ia(na), ib(nb);
+		for ( int i=0; i<na; ++i ) ia[i] = R->retract(a[i]);
+		for ( int i=0; i<nb; ++i ) ib[i] = R->retract(b[i]);
+		const upoly ic = mul_kronecker(ia, ib);
+		c.resize(ic.size());
+		for ( size_t i=0; i<ic.size(); ++i ) c[i] = R->canonhom(ic[i]);
+	} else {
+		c.resize(na + nb - 1, R->zero());
+		mul_unbalanced(&a[0], na, &b[0], nb, &c[0], R->zero());
+	}
+	canonicalize(c);
+	return c;
 }
 
 static upoly operator/(const upoly& a, const cl_I& x)
@@ -436,24 +565,6 @@ static ex upoly_to_ex(const upoly& a, const ex& x)
 	return e;
 }
 
-static ex umodpoly_to_ex(const umodpoly& a, const ex& x)
-{
-	if ( a.empty() ) return 0;
-	cl_modint_ring R = a[0].ring();
-	cl_I mod = R->modulus;
-	cl_I halfmod = (mod-1) >> 1;
-	ex e;
-	for ( int i=degree(a); i>=0; --i ) {
-		cl_I n = R->retract(a[i]);
-		if ( n > halfmod ) {
-			e += numeric(n-mod) * pow(x, i);
-		} else {
-			e += numeric(n) * pow(x, i);
-		}
-	}
-	return e;
-}
-
 static upoly umodpoly_to_upoly(const umodpoly& a)
 {
 	upoly e(a.size());
@@ -1085,11 +1196,280 @@ static void distinct_degree_factor(const umodpoly& a_, vector<int>& degrees, upv
 	}
 }
 
+/** Fast arithmetic modulo a fixed monic polynomial f. The remainder is
+ *  computed by two multiplications, using the inverse of the reversal of f
+ *  modulo x^deg(f), see chapter 9 of [GG].
+ */
+struct umodpoly_modulus
+{
+	umodpoly f;
+	umodpoly rinv;
+	explicit umodpoly_modulus(const umodpoly& f_);
+};
+
+/** Truncates a polynomial modulo x^k. */
+static void truncate(umodpoly& a, size_t k)
+{
+	if ( a.size() > k ) {
+		a.resize(k);
+		canonicalize(a);
+	}
+}
+
+/** Reversal x^n a(1/x) of a polynomial, n >= deg(a). */
+static umodpoly reverse(const umodpoly& a, size_t n, const cl_MI& zero)
+{
+	umodpoly r(n+1, zero);
+	for ( size_t i=0; i<a.size(); ++i ) {
+		r[n-i] = a[i];
+	}
+	canonicalize(r);
+	return r;
+}
+
+umodpoly_modulus::umodpoly_modulus(const umodpoly& f_) : f(f_)
+{
+	const cl_MI zero = f[0].ring()->zero();
+	const size_t n = degree(f);
+	const umodpoly rf = reverse(f, n, zero);
+	// Newton iteration g <- 2g - rf g^2 (mod x^k), doubling k
+	rinv.assign(1, f[0].ring()->one());
+	size_t k = 1;
+	while ( k < n ) {
+		k = std::min(2*k, n);
+		umodpoly rfk = rf;
+		truncate(rfk, k);
+		umodpoly e = rfk * rinv;
+		truncate(e, k);
+		e = e * rinv;
+		truncate(e, k);
+		rinv = rinv + rinv - e;
+	}
+}
+
+/** Calculates remainder of a/M.f */
+static void rem(const umodpoly& a, const umodpoly_modulus& M, umodpoly& r)
+{
+	const int n = degree(M.f);
+	const int m = degree(a) - n;
+	if ( m < 0 ) {
+		r = a;
+		return;
+	}
+	if ( m >= n ) {
+		rem(a, M.f, r);
+		return;
+	}
+	const cl_MI zero = M.f[0].ring()->zero();
+	umodpoly ra = reverse(a, degree(a), zero);
+	truncate(ra, m+1);
+	umodpoly rinv = M.rinv;
+	truncate(rinv, m+1);
+	umodpoly rq = ra * rinv;
+	truncate(rq, m+1);
+	r = a - reverse(rq, m, zero) * M.f;
+}
+
+static umodpoly mulmod(const umodpoly& a, const umodpoly& b, const umodpoly_modulus& M)
+{
+	umodpoly r;
+	rem(a * b, M, r);
+	return r;
+}
+
+/** Calculates a^e mod M.f by repeated squaring. */
+static umodpoly powmod(const umodpoly& a, cl_I e, const umodpoly_modulus& M)
+{
+	umodpoly r(1, M.f[0].ring()->one());
+	umodpoly b = a;
+	while ( true ) {
+		if ( oddp(e) ) {
+			r = mulmod(r, b, M);
+		}
+		e = e >> 1;
+		if ( zerop(e) ) break;
+		b = mulmod(b, b, M);
+	}
+	return r;
+}
+
+/** Modular composition g(h) mod f by the baby-step/giant-step algorithm of
+ *  Brent and Kung, see chapter 12 of [GG]. The powers of h are computed once,
+ *  so it's cheap to compose many polynomials with the same h.
+ */
+class umodpoly_composer
+{
+public:
+	umodpoly_composer(const umodpoly& h, const umodpoly_modulus& M_) : M(M_)
+	{
+		k = 1;
+		while ( k*k < (size_t)degree(M.f) ) ++k;
+		hpow.resize(k+1);
+		hpow[0].assign(1, M.f[0].ring()->one());
+		for ( size_t i=1; i<=k; ++i ) {
+			hpow[i] = mulmod(hpow[i-1], h, M);
+		}
+	}
+	/** Returns g(h) mod f, deg(g) < deg(f) */
+	umodpoly operator()(const umodpoly& g) const
+	{
+		if ( g.empty() ) return g;
+		const cl_MI zero = M.f[0].ring()->zero();
+		const size_t n = degree(M.f);
+		umodpoly r;
+		for ( size_t j=(g.size()-1)/k+1; j-- > 0; ) {
+			// chunk g_j = \sum_i g[jk+i] x^i evaluated at h (baby steps)
+			umodpoly gj(n, zero);
+			for ( size_t i=0; i<k && j*k+i<g.size(); ++i ) {
+				const cl_MI& c = g[j*k+i];
+				if ( zerop(c) ) continue;
+				const umodpoly& hi = hpow[i];
+				for ( size_t t=0; t<hi.size(); ++t ) {
+					gj[t] = gj[t] + c * hi[t];
+				}
+			}
+			canonicalize(gj);
+			// Horner scheme in h^k (giant steps)
+			r = mulmod(r, hpow[k], M) + gj;
+		}
+		return r;
+	}
+private:
+	const umodpoly_modulus& M;
+	size_t k;
+	upvec hpow;
+};
+
+/** Use baby-step/giant-step distinct degree factorization and Cantor-Zassenhaus
+ *  equal degree factorization if degree times modulus is at least that large.
+ *  The cost of the naive algorithms grows linearly with the modulus, the cost
+ *  of the fast ones only logarithmically.
+ */
+static const int bsgs_ddf_threshold = 600;
+
+/** Distinct degree factorization, baby-step/giant-step variant due to Shoup.
+ *
+ *  With l ~ sqrt(n/2), the baby steps x^(q^i), i < l are computed by
+ *  repeated powering, the giant steps x^(q^(l*j)) by modular composition.
+ *  Factors of degree l*j-i divide x^(q^(l*j)) - x^(q^i), so a single gcd
+ *  with the product of these differences handles l degrees at once. See [Sho].
+ *
+ *  @param[in]  a          monic squarefree modular polynomial
+ *  @param[out] degrees    vector containing the degrees of the factors of the
+ *                         corresponding polynomials in ddfactors.
+ *  @param[out] ddfactors  vector containing polynomials which factors have the
+ *                         degree given in degrees.
+ */
+static void distinct_degree_factor_bsgs(const umodpoly& a, vector<int>& degrees, upvec& ddfactors)
+{
+	cl_modint_ring R = a[0].ring();
+	const cl_I q = R->modulus;
+	const int n = degree(a);
+	umodpoly_modulus M(a);
+
+	int l = 1;
+	while ( 2*l*l < n ) ++l;
+	const int m = (n + 2*l - 1)/(2*l);
+
+	// baby steps
+	upvec h(l+1);
+	h[0].resize(2, R->zero());
+	h[0][1] = R->one();
+	for ( int i=1; i<=l; ++i ) {
+		h[i] = powmod(h[i-1], q, M);
+	}
+
+	// giant steps and coarse splitting
+	umodpoly_composer compose(h[l], M);
+	umodpoly rest = a;
+	umodpoly H = h[l];
+	for ( int j=1; j<=m && 2*l*(j-1)+2 <= degree(rest); ++j ) {
+		if ( j > 1 ) {
+			H = compose(H);
+		}
+		umodpoly I(1, R->one());
+		for ( int i=0; i<l; ++i ) {
+			I = mulmod(I, H - h[i], M);
+		}
+		umodpoly g;
+		gcd(rest, I, g);
+		if ( !unequal_one(g) ) continue;
+		umodpoly buf;
+		div(rest, g, buf);
+		rest = buf;
+
+		// fine splitting, increasing degree
+		for ( int i=l-1; i>=0 && unequal_one(g); --i ) {
+			umodpoly gi;
+			gcd(g, H - h[i], gi);
+			if ( unequal_one(gi) ) {
+				degrees.push_back(l*j - i);
+				ddfactors.push_back(gi);
+				div(g, gi, buf);
+				g = buf;
+			}
+		}
+	}
+	if ( unequal_one(rest) ) {
+		degrees.push_back(degree(rest));
+		ddfactors.push_back(rest);
+	}
+}
+
+/** Equal degree factorization by the probabilistic algorithm of Cantor and
+ *  Zassenhaus, see chapter 14 of [GG]. Only for odd moduli.
+ *
+ *  @param[in]  a    monic squarefree modular polynomial with all irreducible
+ *                   factors of degree d
+ *  @param[in]  d    degree of the irreducible factors
+ *  @param[out] upv  vector containing modular factors. if upv was not empty the
+ *                   new elements are added at the end
+ */
+static void equal_degree_factor(const umodpoly& a, int d, upvec& upv)
+{
+	if ( degree(a) == d ) {
+		upv.push_back(a);
+		return;
+	}
+	cl_modint_ring R = a[0].ring();
+	const cl_I q = R->modulus;
+	const umodpoly one(1, R->one());
+	umodpoly_modulus M(a);
+	while ( true ) {
+		umodpoly r(degree(a));
+		for ( size_t i=0; i<r.size(); ++i ) {
+			r[i] = R->random();
+		}
+		canonicalize(r);
+		if ( degree(r) < 1 ) continue;
+
+		// b = r^((q^d-1)/2) = (r r^q ... r^(q^(d-1)))^((q-1)/2)
+		umodpoly t = r;
+		umodpoly rq = r;
+		for ( int k=1; k<d; ++k ) {
+			rq = powmod(rq, q, M);
+			t = mulmod(t, rq, M);
+		}
+		const umodpoly b = powmod(t, (q-1) >> 1, M) - one;
+		if ( b.empty() ) continue;
+		umodpoly g;
+		gcd(a, b, g);
+		if ( unequal_one(g) && degree(g) < degree(a) ) {
+			umodpoly cofactor;
+			div(a, g, cofactor);
+			equal_degree_factor(g, d, upv);
+			equal_degree_factor(cofactor, d, upv);
+			return;
+		}
+	}
+}
+
 /** Modular same degree factorization.
  *  Same degree factorization is a kind of misnomer. It performs distinct degree
- *  factorization, but instead of using the Cantor-Zassenhaus algorithm it
- *  (sub-optimally) uses Berlekamp's algorithm for the factors of the same
- *  degree.
+ *  factorization, and uses Berlekamp's algorithm for the factors of the same
+ *  degree. For polynomials of large degree, the baby-step/giant-step variant
+ *  of distinct degree factorization and the Cantor-Zassenhaus algorithm are
+ *  used instead.
  *
  *  @param[in]  a    modular polynomial
  *  @param[out] upv  vector containing modular factors. if upv was not empty the
@@ -1098,15 +1478,26 @@ static void distinct_degree_factor(const umodpoly& a_, vector<int>& degrees, upv
 static void same_degree_factor(const umodpoly& a, upvec& upv)
 {
 	cl_modint_ring R = a[0].ring();
+	const bool large = R->modulus * degree(a) >= bsgs_ddf_threshold;
 
 	vector<int> degrees;
 	upvec ddfactors;
-	distinct_degree_factor(a, degrees, ddfactors);
+	if ( large ) {
+		umodpoly monic = a;
+		normalize_in_field(monic);
+		distinct_degree_factor_bsgs(monic, degrees, ddfactors);
+	}
+	else {
+		distinct_degree_factor(a, degrees, ddfactors);
+	}
 
 	for ( size_t i=0; i<degrees.size(); ++i ) {
 		if ( degrees[i] == degree(ddfactors[i]) ) {
 			upv.push_back(ddfactors[i]);
 		}
+		else if ( large && oddp(R->modulus) ) {
+			equal_degree_factor(ddfactors[i], degrees[i], upv);
+		}
 		else {
 			berlekamp(ddfactors[i], upv);
 		}
@@ -1135,6 +1526,38 @@ static void factor_modular(const umodpoly& p, upvec& upv)
 #endif
 }
 
+/** Determines the degrees of the irreducible factors of a modular polynomial
+ *  without computing the factors themselves. Only the distinct degree
+ *  factorization is done, which is considerably cheaper than the full modular
+ *  factorization.
+ *
+ *  @param[in]  a        squarefree modular polynomial
+ *  @param[out] pattern  degrees of the irreducible factors of a (with
+ *                       repetitions)
+ */
+static void modular_degree_pattern(const umodpoly& a, vector<int>& pattern)
+{
+	cl_modint_ring R = a[0].ring();
+
+	umodpoly monic = a;
+	normalize_in_field(monic);
+
+	vector<int> degrees;
+	upvec ddfactors;
+	if ( R->modulus * degree(monic) >= bsgs_ddf_threshold ) {
+		distinct_degree_factor_bsgs(monic, degrees, ddfactors);
+	}
+	else {
+		distinct_degree_factor(monic, degrees, ddfactors);
+	}
+
+	for ( size_t i=0; i<degrees.size(); ++i ) {
+		for ( int k=degree(ddfactors[i])/degrees[i]; k>0; --k ) {
+			pattern.push_back(degrees[i]);
+		}
+	}
+}
+
 /** Calculates modular polynomials s and t such that a*s+b*t==1.
  *  Assertion: a and b are relatively prime and not zero.
  *
@@ -1185,20 +1608,6 @@ static void exteuclid(const umodpoly& a, const umodpoly& b, umodpoly& s, umodpol
 	canonicalize(t);
 }
 
-/** Replaces the leading coefficient in a polynomial by a given number.
- *
- *  @param[in] poly  polynomial to change
- *  @param[in] lc    new leading coefficient
- *  @return          changed polynomial
- */
-static upoly replace_lc(const upoly& poly, const cl_I& lc)
-{
-	if ( poly.empty() ) return poly;
-	upoly r = poly;
-	r.back() = lc;
-	return r;
-}
-
 /** Calculates the bound for the modulus.
  *  See [Mig].
  */
@@ -1233,92 +1642,158 @@ static inline cl_I calc_bound(const upoly& a, int maxdeg)
 	return ( B > maxcoeff ) ? B : maxcoeff;
 }
 
-/** Hensel lifting as used by factor_univariate().
+/** Factor tree used by the multifactor Hensel lifting. Each inner node holds
+ *  the product of the values of its children and the polynomials s, t with
+ *  s*left + t*right == 1. Nodes are stored in preorder, i.e. parents come
+ *  before their children.
+ */
+struct hensel_tree
+{
+	upvec value;
+	upvec s;
+	upvec t;
+	vector<int> left;   // -1 for leaves
+	vector<int> right;  // -1 for leaves
+	vector<size_t> leaf; // index of the modular factor (only used for leaves)
+};
+
+/** Builds the (sub-)tree for the factors [lo, hi), making the degrees of both
+ *  subtrees of a node as balanced as possible.
+ *
+ *  @return  index of the root of the subtree
+ */
+static int build_hensel_tree(hensel_tree& tree, const upvec& factors, size_t lo, size_t hi)
+{
+	const int node = tree.value.size();
+	tree.value.push_back(factors[lo]);
+	tree.s.push_back(umodpoly());
+	tree.t.push_back(umodpoly());
+	tree.left.push_back(-1);
+	tree.right.push_back(-1);
+	tree.leaf.push_back(lo);
+	if ( hi - lo == 1 ) {
+		return node;
+	}
+
+	int total = 0;
+	for ( size_t i=lo; i<hi; ++i ) {
+		total += degree(factors[i]);
+	}
+	size_t mid = lo + 1;
+	int deg = degree(factors[lo]);
+	while ( mid < hi - 1 && 2*(deg + degree(factors[mid])) <= total ) {
+		deg += degree(factors[mid]);
+		++mid;
+	}
+
+	const int l = build_hensel_tree(tree, factors, lo, mid);
+	const int r = build_hensel_tree(tree, factors, mid, hi);
+	tree.left[node] = l;
+	tree.right[node] = r;
+	tree.value[node] = tree.value[l] * tree.value[r];
+	exteuclid(tree.value[l], tree.value[r], tree.s[node], tree.t[node]);
+	return node;
+}
+
+/** Quadratic Hensel step, algorithm 15.10 of [GG].
  *
- *  The implementation follows the algorithm in chapter 6 of [GCL].
+ *  Given f == g*h mod m and s*g + t*h == 1 mod m, with g and h monic, compute
+ *  g, h, s, t fulfilling the same equations mod m^2. All polynomials must be
+ *  already defined over the ring of integers mod m^2.
+ */
+static void hensel_step(const umodpoly& f, umodpoly& g, umodpoly& h, umodpoly& s, umodpoly& t)
+{
+	const umodpoly one(1, f[0].ring()->one());
+	const umodpoly e = f - g * h;
+	umodpoly q, r;
+	remdiv(s * e, h, r, q);
+	g = g + t * e + q * g;
+	h = h + r;
+	const umodpoly b = s * g + t * h - one;
+	umodpoly c, d;
+	remdiv(s * b, h, d, c);
+	s = s - d;
+	t = t - t * b - c * g;
+}
+
+/** Multifactor Hensel lifting as used by factor_univariate().
  *
- *  @param[in]  a_   primitive univariate polynomials
- *  @param[in]  p    prime number that does not divide lcoeff(a)
- *  @param[in]  u1_  modular factor of a (mod p)
- *  @param[in]  w1_  modular factor of a (mod p), relatively prime to u1_,
- *                   fulfilling  u1_*w1_ == a mod p
- *  @param[out] u    lifted factor
- *  @param[out] w    lifted factor, u*w = a
- */
-static void hensel_univar(const upoly& a_, unsigned int p, const umodpoly& u1_, const umodpoly& w1_, upoly& u, upoly& w)
-{
-	upoly a = a_;
-	const cl_modint_ring& R = u1_[0].ring();
-
-	// calc bound B
-	int maxdeg = (degree(u1_) > degree(w1_)) ? degree(u1_) : degree(w1_);
-	cl_I maxmodulus = 2*calc_bound(a, maxdeg);
-
-	// step 1
-	cl_I alpha = lcoeff(a);
-	a = a * alpha;
-	umodpoly nu1 = u1_;
-	normalize_in_field(nu1);
-	umodpoly nw1 = w1_;
-	normalize_in_field(nw1);
-	upoly phi;
-	phi = umodpoly_to_upoly(nu1) * alpha;
-	umodpoly u1;
-	umodpoly_from_upoly(u1, phi, R);
-	phi = umodpoly_to_upoly(nw1) * alpha;
-	umodpoly w1;
-	umodpoly_from_upoly(w1, phi, R);
-
-	// step 2
-	umodpoly s;
-	umodpoly t;
-	exteuclid(u1, w1, s, t);
-
-	// step 3
-	u = replace_lc(umodpoly_to_upoly(u1), alpha);
-	w = replace_lc(umodpoly_to_upoly(w1), alpha);
-	upoly e = a - u * w;
+ *  All modular factors are lifted at once using a factor tree, the modulus is
+ *  squared in each step. The implementation follows chapter 15 of [GG].
+ *
+ *  @param[in]     a        primitive univariate polynomial
+ *  @param[in]     p        prime number that does not divide lcoeff(a)
+ *  @param[in]     bound    lower bound for the final modulus
+ *  @param[in,out] factors  monic, pairwise coprime factors of a (mod p), whose
+ *                          product is a/lcoeff(a) mod p. On return, the
+ *                          lifted factors (mod p^k >= bound).
+ */
+static void hensel_multifactor(const upoly& a, unsigned int p, const cl_I& bound, upvec& factors)
+{
+	hensel_tree tree;
+	build_hensel_tree(tree, factors, 0, factors.size());
+
 	cl_I modulus = p;
+	while ( modulus < bound ) {
+		modulus = modulus * modulus;
+		cl_modint_ring R = find_modint_ring(modulus);
+		for ( size_t i=1; i<tree.value.size(); ++i ) {
+			tree.value[i] = umodpoly_to_umodpoly(tree.value[i], R, 0);
+		}
+		for ( size_t i=0; i<tree.value.size(); ++i ) {
+			if ( tree.left[i] < 0 ) continue;
+			tree.s[i] = umodpoly_to_umodpoly(tree.s[i], R, 0);
+			tree.t[i] = umodpoly_to_umodpoly(tree.t[i], R, 0);
+		}
+		umodpoly_from_upoly(tree.value[0], a, R);
+		normalize_in_field(tree.value[0]);
 
-	// step 4
-	while ( !e.empty() && modulus < maxmodulus ) {
-		upoly c = e / modulus;
-		phi = umodpoly_to_upoly(s) * c;
-		umodpoly sigmatilde;
-		umodpoly_from_upoly(sigmatilde, phi, R);
-		phi = umodpoly_to_upoly(t) * c;
-		umodpoly tautilde;
-		umodpoly_from_upoly(tautilde, phi, R);
-		umodpoly r, q;
-		remdiv(sigmatilde, w1, r, q);
-		umodpoly sigma = r;
-		phi = umodpoly_to_upoly(tautilde) + umodpoly_to_upoly(q) * umodpoly_to_upoly(u1);
-		umodpoly tau;
-		umodpoly_from_upoly(tau, phi, R);
-		u = u + umodpoly_to_upoly(tau) * modulus;
-		w = w + umodpoly_to_upoly(sigma) * modulus;
-		e = a - u * w;
-		modulus = modulus * p;
+		// parents come before children, so every node is lifted after its
+		// value has been updated by the parent's step
+		for ( size_t i=0; i<tree.value.size(); ++i ) {
+			if ( tree.left[i] < 0 ) continue;
+			hensel_step(tree.value[i], tree.value[tree.left[i]], tree.value[tree.right[i]], tree.s[i], tree.t[i]);
+		}
 	}
 
-	// step 5
-	if ( e.empty() ) {
-		cl_I g = u[0];
-		for ( size_t i=1; i<u.size(); ++i ) {
-			g = gcd(g, u[i]);
-			if ( g == 1 ) break;
+	for ( size_t i=0; i<tree.value.size(); ++i ) {
+		if ( tree.left[i] < 0 ) {
+			factors[tree.leaf[i]] = tree.value[i];
 		}
-		if ( g != 1 ) {
-			u = u / g;
-			w = w * g;
-		}
-		if ( alpha != 1 ) {
-			w = w / alpha;
+	}
+}
+
+/** Exact division of polynomials over the integers.
+ *
+ *  @param[in]  a  dividend
+ *  @param[in]  b  divisor, not zero
+ *  @param[out] q  quotient a/b, if the division is exact
+ *  @return        true if b divides a, false otherwise
+ */
+static bool divide(const upoly& a, const upoly& b, upoly& q)
+{
+	const int n = degree(b);
+	int k = degree(a) - n;
+	if ( k < 0 ) return false;
+	// cheap test first
+	if ( !zerop(b[0]) && !zerop(rem(a[0], b[0])) ) return false;
+
+	upoly r = a;
+	q.resize(k+1);
+	const cl_I& lcb = lcoeff(b);
+	for ( ; k>=0; --k ) {
+		const cl_I_div_t qr = truncate2(r[n+k], lcb);
+		if ( !zerop(qr.remainder) ) return false;
+		q[k] = qr.quotient;
+		if ( zerop(q[k]) ) continue;
+		for ( int i=0; i<=n; ++i ) {
+			r[k+i] = r[k+i] - q[k] * b[i];
 		}
 	}
-	else {
-		u.clear();
+	for ( int i=0; i<n; ++i ) {
+		if ( !zerop(r[i]) ) return false;
 	}
+	return true;
 }
 
 /** Returns a new prime number.
@@ -1477,163 +1952,516 @@ private:
 	vector<int> k;
 };
 
-/** Contains a pair of univariate polynomial and its modular factors.
- *  Used by factor_univariate().
+/** Primitive integer polynomial corresponding to a product of lifted factors.
+ *
+ *  @param[in] a   product of monic lifted factors (mod p^k)
+ *  @param[in] lc  leading coefficient of the polynomial being factored
+ *  @return        primitive part of lc*a, using the symmetric representation
  */
-struct ModFactors
+static upoly lifted_to_upoly(const umodpoly& a, const cl_I& lc)
 {
-	upoly poly;
-	upvec factors;
-};
+	upoly g = umodpoly_to_upoly(a * a[0].ring()->canonhom(lc));
+	cl_I g_cont = g[0];
+	for ( size_t i=1; i<g.size() && g_cont!=1; ++i ) {
+		g_cont = gcd(g_cont, g[i]);
+	}
+	if ( g_cont != 1 ) {
+		g = g / g_cont;
+	}
+	return g;
+}
 
-/** Univariate polynomial factorization.
- *
- *  Modular factorization is tried for several primes to minimize the number of
- *  modular factors. Then, Hensel lifting is performed.
- *
- *  @param[in]     poly   expanded square free univariate polynomial
- *  @param[in]     x      symbol
- *  @param[in,out] prime  prime number to start trying modular factorization with,
- *                        output value is the prime number actually used
+/** Use lattice reduction for the recombination of the lifted factors if there
+ *  are at least that many of them, instead of trying all subsets.
  */
-static ex factor_univariate(const ex& poly, const ex& x, unsigned int& prime)
-{
-	ex unit, cont, prim_ex;
-	poly.unitcontprim(x, unit, cont, prim_ex);
-	upoly prim;
-	upoly_from_ex(prim, prim_ex, x);
+static const size_t lll_recombination_threshold = 12;
 
-	// determine proper prime and minimize number of modular factors
-	prime = 3;
-	unsigned int lastp = prime;
-	cl_modint_ring R;
-	unsigned int trials = 0;
-	unsigned int minfactors = 0;
+/** Number of power sums added to the lattice in each round of recombine_lll().
+ */
+static const size_t lll_traces_per_round = 2;
 
-	const numeric& cont_n = ex_to<numeric>(cont);
-	cl_I i_cont;
-	if (cont_n.is_integer()) {
-		i_cont = the<cl_I>(cont_n.to_cl_N());
-	} else {
-		// poly \in Q[x] => poly = q ipoly, ipoly \in Z[x], q \in Q
-		// factor(poly) \equiv q factor(ipoly)
-		i_cont = cl_I(1);
+static cl_I dot(const vector<cl_I>& a, const vector<cl_I>& b)
+{
+	cl_I r = 0;
+	for ( size_t i=0; i<a.size(); ++i ) {
+		if ( !zerop(a[i]) && !zerop(b[i]) ) {
+			r = r + a[i] * b[i];
+		}
 	}
-	cl_I lc = lcoeff(prim)*i_cont;
-	upvec factors;
-	while ( trials < 2 ) {
-		umodpoly modpoly;
-		while ( true ) {
-			prime = next_prime(prime);
-			if ( !zerop(rem(lc, prime)) ) {
-				R = find_modint_ring(prime);
-				umodpoly_from_upoly(modpoly, prim, R);
-				if ( squarefree(modpoly) ) break;
+	return r;
+}
+
+/** Size reduction step of the integral LLL algorithm (REDI in [Coh]). */
+static void lll_reduce_step(vector< vector<cl_I> >& b, vector< vector<cl_I> >& lambda, const vector<cl_I>& d, size_t k, size_t l)
+{
+	const cl_I& dl = d[l+1];
+	if ( 2*abs(lambda[k][l]) <= dl ) return;
+	const cl_I q = round1(lambda[k][l], dl);
+	for ( size_t i=0; i<b[k].size(); ++i ) {
+		if ( !zerop(b[l][i]) ) {
+			b[k][i] = b[k][i] - q * b[l][i];
+		}
+	}
+	lambda[k][l] = lambda[k][l] - q * dl;
+	for ( size_t i=0; i<l; ++i ) {
+		lambda[k][i] = lambda[k][i] - q * lambda[l][i];
+	}
+}
+
+/** Swap step of the integral LLL algorithm (SWAPI in [Coh]). */
+static void lll_swap_step(vector< vector<cl_I> >& b, vector< vector<cl_I> >& lambda, vector<cl_I>& d, size_t k, size_t kmax)
+{
+	b[k].swap(b[k-1]);
+	for ( size_t j=0; j+1<k; ++j ) {
+		std::swap(lambda[k][j], lambda[k-1][j]);
+	}
+	const cl_I lam = lambda[k][k-1];
+	const cl_I B = exquo(d[k-1] * d[k+1] + square(lam), d[k]);
+	for ( size_t i=k+1; i<=kmax; ++i ) {
+		const cl_I t = lambda[i][k];
+		lambda[i][k] = exquo(d[k+1] * lambda[i][k-1] - lam * t, d[k]);
+		lambda[i][k-1] = exquo(B * t + lam * lambda[i][k], d[k+1]);
+	}
+	d[k] = B;
+}
+
+/** LLL reduction of a lattice basis with exact integer arithmetic.
+ *  The implementation follows algorithm 2.6.7 of [Coh] (with delta = 3/4).
+ *
+ *  @param[in,out] b  linearly independent integer vectors, on return the
+ *                    reduced basis of the same lattice
+ *  @param[out]    d  d[i] is the Gram determinant of b[0], ..., b[i-1], such
+ *                    that the squared norm of the i-th Gram-Schmidt vector
+ *                    is d[i+1]/d[i]
+ */
+static void lll_reduce(vector< vector<cl_I> >& b, vector<cl_I>& d)
+{
+	const size_t n = b.size();
+	vector< vector<cl_I> > lambda(n, vector<cl_I>(n, cl_I(0)));
+	d.assign(n+1, cl_I(0));
+	d[0] = 1;
+	d[1] = dot(b[0], b[0]);
+	size_t k = 1;
+	size_t kmax = 0;
+	while ( k < n ) {
+		if ( k > kmax ) {
+			// incremental Gram-Schmidt
+			kmax = k;
+			for ( size_t j=0; j<=k; ++j ) {
+				cl_I u = dot(b[k], b[j]);
+				for ( size_t i=0; i<j; ++i ) {
+					u = exquo(d[i+1] * u - lambda[k][i] * lambda[j][i], d[i]);
+				}
+				if ( j < k ) {
+					lambda[k][j] = u;
+				}
+				else {
+					d[k+1] = u;
+				}
+			}
+		}
+		lll_reduce_step(b, lambda, d, k, k-1);
+		if ( 4 * d[k+1] * d[k-1] < 3 * square(d[k]) - 4 * square(lambda[k][k-1]) ) {
+			lll_swap_step(b, lambda, d, k, kmax);
+			if ( k > 1 ) --k;
+		}
+		else {
+			for ( size_t l=k-1; l-- > 0; ) {
+				lll_reduce_step(b, lambda, d, k, l);
 			}
+			++k;
 		}
+	}
+}
 
-		// do modular factorization
-		upvec trialfactors;
-		factor_modular(modpoly, trialfactors);
-		if ( trialfactors.size() <= 1 ) {
-			// irreducible for sure
-			return poly;
+/** Number of bits the first power sums of the roots of factors of a (times
+ *  lcoeff(a)^j) are bounded by. The bound is derived from Fujiwara's bound for
+ *  the absolute value of the roots.
+ *
+ *  @param[in]  a  squarefree polynomial
+ *  @param[in]  s  number of power sums
+ *  @param[out] bits  bits[j] bounds the (j+1)-th power sum
+ */
+static void trace_bounds(const upoly& a, size_t s, vector<uintC> &bits)
+{
+	const int n = degree(a);
+	const long lc_len = integer_length(abs(lcoeff(a)));
+	long root_len = 0;
+	for ( int i=1; i<=n; ++i ) {
+		const long num = (long)integer_length(abs(a[n-i])) - lc_len + 1;
+		if ( num > 0 ) {
+			root_len = std::max(root_len, (num + i - 1)/i);
 		}
+	}
+	++root_len;
+	bits.resize(s);
+	for ( size_t j=0; j<s; ++j ) {
+		bits[j] = integer_length(cl_I(n)) + (j+1)*(lc_len + root_len);
+	}
+}
 
-		if ( minfactors == 0 || trialfactors.size() < minfactors ) {
-			factors = trialfactors;
-			minfactors = trialfactors.size();
-			lastp = prime;
-			trials = 1;
+/** Modulus needed by recombine_lll() for r lifted factors. */
+static cl_I lll_modulus_bound(const upoly& a, size_t r)
+{
+	const size_t s = std::min<size_t>(degree(a), r);
+	vector<uintC> bits;
+	trace_bounds(a, s, bits);
+	const uintC extra = r + s + 2*integer_length(cl_I(r)) + integer_length(cl_I(s)) + 16;
+	return cl_I(1) << (bits.back() + extra);
+}
+
+/** Computes lc^j times the power sums p_j = \sum_{f(alpha) = 0} alpha^j, j = 1..s
+ *  of a monic modular polynomial f, using Newton's identities.
+ */
+static void modular_traces(const umodpoly& f, const cl_I& lc, size_t s, vector<cl_I>& traces)
+{
+	const cl_modint_ring& R = f[0].ring();
+	const int d = degree(f);
+	umodpoly p(s+1, R->zero());
+	traces.resize(s);
+	const cl_MI lcm = R->canonhom(lc);
+	cl_MI lcpow = R->one();
+	for ( size_t j=1; j<=s; ++j ) {
+		cl_MI sum = R->zero();
+		if ( (int)j <= d ) {
+			sum = R->canonhom(cl_I(j)) * f[d-j];
 		}
-		else {
-			++trials;
+		for ( size_t k=1; k<j && (int)k<=d; ++k ) {
+			sum = sum + f[d-k] * p[j-k];
 		}
+		p[j] = -sum;
+		lcpow = lcpow * lcm;
+		traces[j-1] = R->retract(lcpow * p[j]);
 	}
-	prime = lastp;
-	R = find_modint_ring(prime);
+}
 
-	// lift all factor combinations
-	stack<ModFactors> tocheck;
-	ModFactors mf;
-	mf.poly = prim;
-	mf.factors = factors;
-	tocheck.push(mf);
-	upoly f1, f2;
-	ex result = 1;
-	while ( tocheck.size() ) {
-		const size_t n = tocheck.top().factors.size();
-		factor_partition part(tocheck.top().factors);
-		while ( true ) {
-			// call Hensel lifting
-			hensel_univar(tocheck.top().poly, prime, part.left(), part.right(), f1, f2);
-			if ( !f1.empty() ) {
-				// successful, update the stack and the result
-				if ( part.size_left() == 1 ) {
-					if ( part.size_right() == 1 ) {
-						result *= upoly_to_ex(f1, x) * upoly_to_ex(f2, x);
-						tocheck.pop();
-						break;
-					}
-					result *= upoly_to_ex(f1, x);
-					tocheck.top().poly = f2;
-					for ( size_t i=0; i<n; ++i ) {
-						if ( part[i] == 0 ) {
-							tocheck.top().factors.erase(tocheck.top().factors.begin()+i);
-							break;
-						}
+/** Tries to recombine lifted modular factors into the true factors over the
+ *  integers by lattice reduction (van Hoeij's algorithm).
+ *
+ *  The power sums of the roots of a true factor are small integers, while the
+ *  power sums of other products of modular factors are (likely) not. Short
+ *  vectors of the lattice spanned by the 0/1-vectors of the modular factors
+ *  and their power sums (cut to the leading bits) therefore give the subsets
+ *  of modular factors which correspond to the true factors. The number of
+ *  power sums used is increased until the answer is confirmed by division.
+ *
+ *  @param[in]  a        primitive squarefree polynomial
+ *  @param[in]  factors  monic lifted factors of a mod p^k, where p^k is at
+ *                       least lll_modulus_bound()
+ *  @param[out] result   true factors of a
+ *  @return              true if the recombination succeeded
+ */
+static bool recombine_lll(const upoly& a, const upvec& factors, vector<upoly>& result)
+{
+	const size_t r = factors.size();
+	const cl_I modulus = factors.front()[0].ring()->modulus;
+	const cl_I& lc = lcoeff(a);
+	const size_t smax = std::min<size_t>(degree(a), r);
+
+	vector<uintC> bits;
+	trace_bounds(a, smax, bits);
+	vector< vector<cl_I> > traces(r);
+	for ( size_t i=0; i<r; ++i ) {
+		modular_traces(factors[i], lc, smax, traces[i]);
+	}
+
+	// the traces are cut to the bits above their bound
+	vector< vector<cl_I> > cut(r, vector<cl_I>(smax));
+	for ( size_t i=0; i<r; ++i ) {
+		for ( size_t j=0; j<smax; ++j ) {
+			cut[i][j] = ash(traces[i][j], -(long)bits[j]);
+		}
+	}
+
+	// Start with the lattice spanned by the unit vectors e_i (standing for
+	// the i-th modular factor) and add a few trace columns in each round.
+	// Only the part of the reduced basis which can contain the vectors
+	// corresponding to true factors is kept for the next round.
+	vector< vector<cl_I> > basis(r, vector<cl_I>(r, cl_I(0)));
+	for ( size_t i=0; i<r; ++i ) {
+		basis[i][i] = 1;
+	}
+	size_t s = 0;
+	while ( s < smax ) {
+		const size_t snew = std::min(s + lll_traces_per_round, smax);
+		const size_t n = basis.size() + snew - s;
+		vector< vector<cl_I> > b(n, vector<cl_I>(r + snew, cl_I(0)));
+		for ( size_t i=0; i<basis.size(); ++i ) {
+			std::copy(basis[i].begin(), basis[i].end(), b[i].begin());
+			for ( size_t j=s; j<snew; ++j ) {
+				cl_I c = 0;
+				for ( size_t k=0; k<r; ++k ) {
+					if ( !zerop(basis[i][k]) ) {
+						c = c + basis[i][k] * cut[k][j];
 					}
-					break;
 				}
-				else if ( part.size_right() == 1 ) {
-					if ( part.size_left() == 1 ) {
-						result *= upoly_to_ex(f1, x) * upoly_to_ex(f2, x);
-						tocheck.pop();
-						break;
-					}
-					result *= upoly_to_ex(f2, x);
-					tocheck.top().poly = f1;
-					for ( size_t i=0; i<n; ++i ) {
-						if ( part[i] == 1 ) {
-							tocheck.top().factors.erase(tocheck.top().factors.begin()+i);
-							break;
-						}
-					}
-					break;
+				b[i][r+j] = c;
+			}
+		}
+		for ( size_t j=s; j<snew; ++j ) {
+			b[basis.size()+j-s][r+j] = ash(modulus, -(long)bits[j]);
+		}
+		s = snew;
+		vector<cl_I> d;
+		lll_reduce(b, d);
+
+		// vectors corresponding to true factors have norm^2 <= bound, so they
+		// lie in the span of what remains after dropping the trailing basis
+		// vectors with Gram-Schmidt norm^2 above the bound
+		const cl_I bound = r + s*square(cl_I(2*r + 1));
+		size_t m = n;
+		while ( m > 1 && d[m] > bound * d[m-1] ) {
+			--m;
+		}
+		b.resize(m);
+		basis.swap(b);
+
+		// reduced row echelon form of the first r columns must consist of
+		// 0/1-vectors giving a partition of the factors
+		vector< vector<cl_RA> > e(m, vector<cl_RA>(r, cl_RA(0)));
+		for ( size_t i=0; i<m; ++i ) {
+			for ( size_t j=0; j<r; ++j ) {
+				e[i][j] = basis[i][j];
+			}
+		}
+		size_t row = 0;
+		for ( size_t col=0; col<r && row<m; ++col ) {
+			size_t piv = row;
+			while ( piv < m && zerop(e[piv][col]) ) ++piv;
+			if ( piv == m ) continue;
+			e[row].swap(e[piv]);
+			const cl_RA inv = recip(e[row][col]);
+			for ( size_t j=col; j<r; ++j ) {
+				e[row][j] = e[row][j] * inv;
+			}
+			for ( size_t i=0; i<m; ++i ) {
+				if ( i == row || zerop(e[i][col]) ) continue;
+				const cl_RA c = e[i][col];
+				for ( size_t j=col; j<r; ++j ) {
+					e[i][j] = e[i][j] - c * e[row][j];
 				}
-				else {
-					upvec newfactors1(part.size_left()), newfactors2(part.size_right());
-					upvec::iterator i1 = newfactors1.begin(), i2 = newfactors2.begin();
-					for ( size_t i=0; i<n; ++i ) {
-						if ( part[i] ) {
-							*i2++ = tocheck.top().factors[i];
-						}
-						else {
-							*i1++ = tocheck.top().factors[i];
-						}
+			}
+			++row;
+		}
+
+		bool partition = (row == m);
+		for ( size_t j=0; j<r && partition; ++j ) {
+			int ones = 0;
+			for ( size_t i=0; i<m; ++i ) {
+				if ( e[i][j] == 1 ) {
+					++ones;
+				}
+				else if ( !zerop(e[i][j]) ) {
+					partition = false;
+				}
+			}
+			if ( ones != 1 ) {
+				partition = false;
+			}
+		}
+
+		if ( partition ) {
+			// check the candidates
+			upoly rest = a;
+			result.clear();
+			for ( size_t i=0; i<m; ++i ) {
+				if ( i == m-1 ) {
+					result.push_back(rest);
+					return true;
+				}
+				umodpoly prod;
+				for ( size_t j=0; j<r; ++j ) {
+					if ( e[i][j] == 1 ) {
+						prod = prod.empty() ? factors[j] : prod * factors[j];
 					}
-					tocheck.top().factors = newfactors1;
-					tocheck.top().poly = f1;
-					ModFactors mf;
-					mf.factors = newfactors2;
-					mf.poly = f2;
-					tocheck.push(mf);
-					break;
 				}
+				const upoly g = lifted_to_upoly(prod, lcoeff(rest));
+				upoly q;
+				if ( !divide(rest, g, q) ) break;
+				result.push_back(g);
+				rest = q;
 			}
-			else {
-				// not successful
-				if ( !part.next() ) {
-					// if no more combinations left, return polynomial as
-					// irreducible
-					result *= upoly_to_ex(tocheck.top().poly, x);
-					tocheck.pop();
-					break;
+		}
+	}
+	return false;
+}
+
+/** factor_univariate() stops trying primes after this many primes in a row did
+ *  not yield fewer modular factors. More trials rarely find a better prime,
+ *  but their distinct degree factorizations are expensive for high degrees:
+ *  with 3 trials the factorization tests take 50% longer, with 5 trials
+ *  three times as long.
+ */
+static const unsigned int univariate_prime_trials = 1;
+
+/** Chooses a prime for the modular factorization of a univariate polynomial.
+ *
+ *  For each trial prime only the degree pattern of the modular factors is
+ *  computed, see modular_degree_pattern(), and the prime with the fewest
+ *  modular factors is chosen. The search stops after the given number of
+ *  primes in a row did not improve on the minimum.
+ *
+ *  The degree of a true factor has to be a sum of modular factor degrees for
+ *  every prime. Intersecting these sums over all trial primes often proves
+ *  irreducibility without any lifting.
+ *
+ *  @param[in]     a       squarefree primitive polynomial
+ *  @param[in]     lc      integer that must not be divisible by the prime
+ *  @param[in]     trials  number of unsuccessful primes before giving up
+ *  @param[in,out] prime   prime to start the search after, output value is the
+ *                         chosen prime
+ *  @return                number of modular factors for the chosen prime, 1 if
+ *                         the polynomial is irreducible for sure
+ */
+static size_t choose_prime(const upoly& a, const cl_I& lc, unsigned int trials, unsigned int& prime)
+{
+	const int n = degree(a);
+	if ( n < 2 ) {
+		return 1;
+	}
+	vector<bool> possible(n+1, true);
+	size_t minfactors = 0;
+	unsigned int bestp = prime;
+
+	unsigned int failed = 0;
+	while ( failed < trials ) {
+		umodpoly modpoly;
+		while ( true ) {
+			prime = next_prime(prime);
+			if ( !zerop(rem(lc, prime)) ) {
+				cl_modint_ring R = find_modint_ring(prime);
+				umodpoly_from_upoly(modpoly, a, R);
+				if ( squarefree(modpoly) ) break;
+			}
+		}
+
+		vector<int> pattern;
+		modular_degree_pattern(modpoly, pattern);
+		if ( pattern.size() <= 1 ) {
+			return 1;
+		}
+		if ( minfactors == 0 || pattern.size() < minfactors ) {
+			minfactors = pattern.size();
+			bestp = prime;
+			failed = 0;
+		}
+		else {
+			++failed;
+		}
+
+		// degrees of all products of modular factors
+		vector<bool> sums(n+1, false);
+		sums[0] = true;
+		for ( size_t i=0; i<pattern.size(); ++i ) {
+			for ( int d=n; d>=pattern[i]; --d ) {
+				if ( sums[d-pattern[i]] ) {
+					sums[d] = true;
 				}
 			}
 		}
+		bool reducible = false;
+		for ( int d=1; d<n; ++d ) {
+			possible[d] = possible[d] && sums[d];
+			reducible = reducible || possible[d];
+		}
+		if ( !reducible ) {
+			return 1;
+		}
 	}
 
+	prime = bestp;
+	return minfactors;
+}
+
+/** Univariate polynomial factorization.
+ *
+ *  Several primes are compared by the number of modular factors, see
+ *  choose_prime(), and the polynomial is factored modulo the best one. Then,
+ *  the modular factors are lifted and recombined.
+ *
+ *  @param[in]     poly   expanded square free univariate polynomial
+ *  @param[in]     x      symbol
+ *  @param[in,out] prime  prime number to start trying modular factorization with,
+ *                        output value is the prime number actually used
+ */
+static ex factor_univariate(const ex& poly, const ex& x, unsigned int& prime)
+{
+	ex unit, cont, prim_ex;
+	poly.unitcontprim(x, unit, cont, prim_ex);
+	upoly prim;
+	upoly_from_ex(prim, prim_ex, x);
+
+	const numeric& cont_n = ex_to<numeric>(cont);
+	cl_I i_cont;
+	if (cont_n.is_integer()) {
+		i_cont = the<cl_I>(cont_n.to_cl_N());
+	} else {
+		// poly \in Q[x] => poly = q ipoly, ipoly \in Z[x], q \in Q
+		// factor(poly) \equiv q factor(ipoly)
+		i_cont = cl_I(1);
+	}
+	cl_I lc = lcoeff(prim)*i_cont;
+
+	// determine proper prime and minimize number of modular factors
+	prime = 3;
+	if ( choose_prime(prim, lc, univariate_prime_trials, prime) <= 1 ) {
+		// irreducible for sure
+		return poly;
+	}
+
+	// do modular factorization
+	cl_modint_ring R = find_modint_ring(prime);
+	umodpoly modpoly;
+	umodpoly_from_upoly(modpoly, prim, R);
+	upvec factors;
+	factor_modular(modpoly, factors);
+
+	// lift all modular factors at once
+	for ( size_t i=0; i<factors.size(); ++i ) {
+		normalize_in_field(factors[i]);
+	}
+	cl_I bound = 2*abs(lcoeff(prim))*calc_bound(prim, degree(prim));
+	const bool use_lll = factors.size() >= lll_recombination_threshold;
+	if ( use_lll ) {
+		bound = std::max(bound, lll_modulus_bound(prim, factors.size()));
+	}
+	hensel_multifactor(prim, prime, bound, factors);
+
+	ex result = 1;
+	vector<upoly> truefactors;
+	if ( use_lll && recombine_lll(prim, factors, truefactors) ) {
+		for ( size_t i=0; i<truefactors.size(); ++i ) {
+			result *= upoly_to_ex(truefactors[i], x);
+		}
+		return unit * cont * result;
+	}
+
+	// recombine the lifted factors: try the products of all subsets of the
+	// factors (increasing in size), multiplied by the leading coefficient
+	while ( factors.size() > 1 ) {
+		bool found = false;
+		factor_partition part(factors);
+		do {
+			const upoly g = lifted_to_upoly(part.right(), lcoeff(prim));
+			upoly q;
+			if ( divide(prim, g, q) ) {
+				result *= upoly_to_ex(g, x);
+				prim = q;
+				upvec rest;
+				for ( size_t i=0; i<part.size(); ++i ) {
+					if ( part[i] == 0 ) {
+						rest.push_back(factors[i]);
+					}
+				}
+				factors.swap(rest);
+				found = true;
+				break;
+			}
+		} while ( part.next() );
+		if ( !found ) break;
+	}
+	result *= upoly_to_ex(prim, x);
+
 	return unit * cont * result;
 }
 
@@ -1664,8 +2492,243 @@ ostream& operator<<(ostream& o, const vector<EvalPoint>& v)
 }
 #endif // def DEBUGFACTOR
 
-// forward declaration
-static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex& c, const vector<EvalPoint>& I, unsigned int d, unsigned int p, unsigned int k);
+////////////////////////////////////////////////////////////////////////////////
+// modular multivariate polynomial code
+
+/** Sparse multivariate polynomial over Z/p^k, used by the multivariate Hensel
+ *  lifting. The variables are numbered: 0 is the main variable x, i > 0 is the
+ *  variable of the i-th evaluation point. The map takes exponent vectors (all
+ *  of the same length) to non-zero coefficients.
+ */
+typedef map<vector<int>, cl_MI> mmodpoly;
+
+static void add_term(mmodpoly& a, const vector<int>& e, const cl_MI& c)
+{
+	if ( zerop(c) ) return;
+	pair<mmodpoly::iterator, bool> i = a.insert(make_pair(e, c));
+	if ( !i.second ) {
+		i.first->second = i.first->second + c;
+		if ( zerop(i.first->second) ) {
+			a.erase(i.first);
+		}
+	}
+}
+
+static mmodpoly operator+(const mmodpoly& a, const mmodpoly& b)
+{
+	mmodpoly c = a;
+	for ( mmodpoly::const_iterator i=b.begin(); i!=b.end(); ++i ) {
+		add_term(c, i->first, i->second);
+	}
+	return c;
+}
+
+static mmodpoly operator-(const mmodpoly& a, const mmodpoly& b)
+{
+	mmodpoly c = a;
+	for ( mmodpoly::const_iterator i=b.begin(); i!=b.end(); ++i ) {
+		add_term(c, i->first, -i->second);
+	}
+	return c;
+}
+
+static mmodpoly operator*(const mmodpoly& a, const mmodpoly& b)
+{
+	mmodpoly c;
+	if ( a.empty() || b.empty() ) return c;
+	const size_t nvars = a.begin()->first.size();
+	vector<int> e(nvars);
+	for ( mmodpoly::const_iterator i=a.begin(); i!=a.end(); ++i ) {
+		for ( mmodpoly::const_iterator j=b.begin(); j!=b.end(); ++j ) {
+			for ( size_t v=0; v<nvars; ++v ) {
+				e[v] = i->first[v] + j->first[v];
+			}
+			add_term(c, e, i->second * j->second);
+		}
+	}
+	return c;
+}
+
+/** Returns the polynomial x_v - alpha.
+ */
+static mmodpoly linear_factor(size_t nvars, size_t v, int alpha, const cl_modint_ring& R)
+{
+	mmodpoly a;
+	vector<int> e(nvars, 0);
+	add_term(a, e, R->canonhom(-alpha));
+	e[v] = 1;
+	add_term(a, e, R->one());
+	return a;
+}
+
+static int degree(const mmodpoly& a, size_t v)
+{
+	int deg = 0;
+	for ( mmodpoly::const_iterator i=a.begin(); i!=a.end(); ++i ) {
+		deg = std::max(deg, i->first[v]);
+	}
+	return deg;
+}
+
+/** Substitutes x_v == alpha.
+ */
+static mmodpoly evaluate(const mmodpoly& a, size_t v, int alpha, const cl_modint_ring& R)
+{
+	mmodpoly b;
+	vector<cl_MI> pw(1, R->one());
+	const cl_MI malpha = R->canonhom(alpha);
+	for ( mmodpoly::const_iterator i=a.begin(); i!=a.end(); ++i ) {
+		const int n = i->first[v];
+		while ( pw.size() <= size_t(n) ) {
+			pw.push_back(pw.back() * malpha);
+		}
+		vector<int> e = i->first;
+		e[v] = 0;
+		add_term(b, e, i->second * pw[n]);
+	}
+	return b;
+}
+
+/** Returns the coefficient of (x_v - alpha)^k in the Taylor expansion of a,
+ *  i.e. the k-th derivative with respect to x_v at alpha divided by k!.
+ */
+static mmodpoly taylor_coeff(const mmodpoly& a, size_t v, int alpha, int k, const cl_modint_ring& R)
+{
+	mmodpoly b;
+	const int n = degree(a, v);
+	if ( n < k ) return b;
+
+	// binom[i] = binomial(k+i, k) * alpha^i
+	vector<cl_MI> binom(n-k+1);
+	cl_I bi = 1;
+	cl_I ai = 1;
+	for ( int i=0; i<=n-k; ++i ) {
+		binom[i] = R->canonhom(bi * ai);
+		bi = exquo(bi * (k+i+1), cl_I(i+1));
+		ai = ai * alpha;
+	}
+
+	for ( mmodpoly::const_iterator i=a.begin(); i!=a.end(); ++i ) {
+		if ( i->first[v] < k ) continue;
+		vector<int> e = i->first;
+		e[v] = 0;
+		add_term(b, e, i->second * binom[i->first[v]-k]);
+	}
+	return b;
+}
+
+/** Replaces the leading coefficient of a with respect to x (variable 0) by lc.
+ *  lc must not contain x.
+ */
+static void replace_lcoeff(mmodpoly& a, const mmodpoly& lc)
+{
+	const int deg = degree(a, 0);
+	mmodpoly::iterator i = a.begin();
+	while ( i != a.end() ) {
+		if ( i->first[0] == deg ) {
+			a.erase(i++);
+		}
+		else {
+			++i;
+		}
+	}
+	for ( mmodpoly::const_iterator j=lc.begin(); j!=lc.end(); ++j ) {
+		vector<int> e = j->first;
+		e[0] = deg;
+		add_term(a, e, j->second);
+	}
+}
+
+static mmodpoly mmodpoly_from_umodpoly(const umodpoly& a, size_t nvars)
+{
+	mmodpoly b;
+	vector<int> e(nvars, 0);
+	for ( int i=degree(a); i>=0; --i ) {
+		e[0] = i;
+		add_term(b, e, a[i]);
+	}
+	return b;
+}
+
+static umodpoly mmodpoly_to_umodpoly(const mmodpoly& a, const cl_modint_ring& R)
+{
+	umodpoly b;
+	if ( a.empty() ) return b;
+	b.resize(degree(a, 0)+1, R->zero());
+	for ( mmodpoly::const_iterator i=a.begin(); i!=a.end(); ++i ) {
+		b[i->first[0]] = i->second;
+	}
+	canonicalize(b);
+	return b;
+}
+
+static mmodpoly mmodpoly_from_ex(const ex& e, const vector<ex>& vars, const cl_modint_ring& R)
+{
+	// assert: e is in Z[vars]
+	mmodpoly a;
+	const ex ee = e.expand();
+	const size_t nterms = is_a<add>(ee) ? ee.nops() : 1;
+	vector<int> exps(vars.size());
+	for ( size_t i=0; i<nterms; ++i ) {
+		ex c = is_a<add>(ee) ? ee.op(i) : ee;
+		for ( size_t v=0; v<vars.size(); ++v ) {
+			exps[v] = c.degree(vars[v]);
+			if ( exps[v] ) {
+				c = c.coeff(vars[v], exps[v]);
+			}
+		}
+		add_term(a, exps, R->canonhom(the<cl_I>(ex_to<numeric>(c).to_cl_N())));
+	}
+	return a;
+}
+
+static ex mmodpoly_to_ex(const mmodpoly& a, const vector<ex>& vars)
+{
+	if ( a.empty() ) return 0;
+	cl_modint_ring R = a.begin()->second.ring();
+	cl_I mod = R->modulus;
+	cl_I halfmod = (mod-1) >> 1;
+	exvector terms;
+	terms.reserve(a.size());
+	for ( mmodpoly::const_iterator i=a.begin(); i!=a.end(); ++i ) {
+		cl_I n = R->retract(i->second);
+		ex t = numeric(n > halfmod ? n-mod : n);
+		for ( size_t v=0; v<vars.size(); ++v ) {
+			if ( i->first[v] ) {
+				t *= pow(vars[v], i->first[v]);
+			}
+		}
+		terms.push_back(t);
+	}
+	return (new add(terms))->setflag(status_flags::dynallocated);
+}
+
+// END modular multivariate polynomial code
+////////////////////////////////////////////////////////////////////////////////
+
+/** Solves univariate diophantine equations for the multivariate Hensel lifting.
+ *
+ *  For given a_1, ..., a_r the constructor computes the solution of
+ *    s_1*b_1 + ... + s_r*b_r == 1 mod p^k
+ *  with b_i = a_1 * ... * a_{i-1} * a_{i+1} * ... * a_r. Since the equation is
+ *  linear, the solution for another right hand side c is obtained by
+ *  multiplying with c and reducing modulo the a_i.
+ *
+ *  The implementation follows the algorithm in chapter 6 of [GCL].
+ */
+class univar_diophant
+{
+public:
+	univar_diophant(const upvec& a, unsigned int p, unsigned int k);
+	/** Returns the sigma_i with deg(sigma_i) < deg(a_i) that fulfill
+	 *    sigma_1*b_1 + ... + sigma_r*b_r == c mod p^k
+	 *  for deg(c) < deg(a_1*...*a_r).
+	 */
+	upvec operator()(const umodpoly& c) const;
+private:
+	upvec a;
+	upvec s;
+};
 
 /** Utility function for multivariate Hensel lifting.
  *
@@ -1677,12 +2740,11 @@ static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex&
  *  The implementation follows the algorithm in chapter 6 of [GCL].
  *
  *  @param[in]  a   vector of modular univariate polynomials
- *  @param[in]  x   symbol
  *  @param[in]  p   prime number
  *  @param[in]  k   p^k is modulus
  *  @return         vector of polynomials (s_i)
  */
-static upvec multiterm_eea_lift(const upvec& a, const ex& x, unsigned int p, unsigned int k)
+static upvec multiterm_eea_lift(const upvec& a, unsigned int p, unsigned int k)
 {
 	const size_t r = a.size();
 	cl_modint_ring R = find_modint_ring(expt_pos(cl_I(p),k));
@@ -1694,17 +2756,12 @@ static upvec multiterm_eea_lift(const upvec& a, const ex& x, unsigned int p, uns
 	umodpoly beta(1, R->one());
 	upvec s;
 	for ( size_t j=1; j<r; ++j ) {
-		vector<ex> mdarg(2);
-		mdarg[0] = umodpoly_to_ex(q[j-1], x);
-		mdarg[1] = umodpoly_to_ex(a[j-1], x);
-		vector<EvalPoint> empty;
-		vector<ex> exsigma = multivar_diophant(mdarg, x, umodpoly_to_ex(beta, x), empty, 0, p, k);
-		umodpoly sigma1;
-		umodpoly_from_ex(sigma1, exsigma[0], x, R);
-		umodpoly sigma2;
-		umodpoly_from_ex(sigma2, exsigma[1], x, R);
-		beta = sigma1;
-		s.push_back(sigma2);
+		upvec mdarg(2);
+		mdarg[0] = q[j-1];
+		mdarg[1] = a[j-1];
+		upvec sigma = univar_diophant(mdarg, p, k)(beta);
+		beta = sigma[0];
+		s.push_back(sigma[1]);
 	}
 	s.push_back(beta);
 	return s;
@@ -1734,13 +2791,12 @@ static void change_modulus(const cl_modint_ring& R, umodpoly& a)
  *
  *  @param[in]  a   polynomial
  *  @param[in]  b   polynomial
- *  @param[in]  x   symbol
  *  @param[in]  p   prime number
  *  @param[in]  k   p^k is modulus
  *  @param[out] s_  output polynomial
  *  @param[out] t_  output polynomial
  */
-static void eea_lift(const umodpoly& a, const umodpoly& b, const ex& x, unsigned int p, unsigned int k, umodpoly& s_, umodpoly& t_)
+static void eea_lift(const umodpoly& a, const umodpoly& b, unsigned int p, unsigned int k, umodpoly& s_, umodpoly& t_)
 {
 	cl_modint_ring R = find_modint_ring(p);
 	umodpoly amod = a;
@@ -1783,90 +2839,25 @@ static void eea_lift(const umodpoly& a, const umodpoly& b, const ex& x, unsigned
 	s_ = s; t_ = t;
 }
 
-/** Utility function for multivariate Hensel lifting.
- *
- *  Solves the equation
- *    s_1*b_1 + ... + s_r*b_r == x^m mod p^k
- *  with given b_1 = a_1 * ... * a_{i-1} * a_{i+1} * ... * a_r
- *
- *  The implementation follows the algorithm in chapter 6 of [GCL].
- *
- *  @param a  vector with univariate polynomials mod p^k
- *  @param x  symbol
- *  @param m  exponent of x^m in the equation to solve
- *  @param p  prime number
- *  @param k  p^k is modulus
- *  @return   vector of polynomials (s_i)
- */
-static upvec univar_diophant(const upvec& a, const ex& x, unsigned int m, unsigned int p, unsigned int k)
+univar_diophant::univar_diophant(const upvec& a_, unsigned int p, unsigned int k) : a(a_)
 {
-	cl_modint_ring R = find_modint_ring(expt_pos(cl_I(p),k));
-
-	const size_t r = a.size();
-	upvec result;
-	if ( r > 2 ) {
-		upvec s = multiterm_eea_lift(a, x, p, k);
-		for ( size_t j=0; j<r; ++j ) {
-			umodpoly bmod = umodpoly_to_umodpoly(s[j], R, m);
-			umodpoly buf;
-			rem(bmod, a[j], buf);
-			result.push_back(buf);
-		}
+	if ( a.size() > 2 ) {
+		s = multiterm_eea_lift(a, p, k);
 	}
 	else {
-		umodpoly s, t;
-		eea_lift(a[1], a[0], x, p, k, s, t);
-		umodpoly bmod = umodpoly_to_umodpoly(s, R, m);
-		umodpoly buf, q;
-		remdiv(bmod, a[0], buf, q);
-		result.push_back(buf);
-		umodpoly t1mod = umodpoly_to_umodpoly(t, R, m);
-		buf = t1mod + q * a[1];
-		result.push_back(buf);
+		s.resize(2);
+		eea_lift(a[1], a[0], p, k, s[0], s[1]);
 	}
-
-	return result;
 }
 
-/** Map used by function make_modular().
- *  Finds every coefficient in a polynomial and replaces it by is value in the
- *  given modular ring R (symmetric representation).
- */
-struct make_modular_map : public map_function {
-	cl_modint_ring R;
-	make_modular_map(const cl_modint_ring& R_) : R(R_) { }
-	ex operator()(const ex& e)
-	{
-		if ( is_a<add>(e) || is_a<mul>(e) ) {
-			return e.map(*this);
-		}
-		else if ( is_a<numeric>(e) ) {
-			numeric mod(R->modulus);
-			numeric halfmod = (mod-1)/2;
-			cl_MI emod = R->canonhom(the<cl_I>(ex_to<numeric>(e).to_cl_N()));
-			numeric n(R->retract(emod));
-			if ( n > halfmod ) {
-				return n-mod;
-			}
-			else {
-				return n;
-			}
-		}
-		return e;
-	}
-};
-
-/** Helps mimicking modular multivariate polynomial arithmetic.
- *
- *  @param e  expression of which to make the coefficients equal to their value
- *            in the modular ring R (symmetric representation)
- *  @param R  modular ring
- *  @return   resulting expression
- */
-static ex make_modular(const ex& e, const cl_modint_ring& R)
+upvec univar_diophant::operator()(const umodpoly& c) const
 {
-	make_modular_map map(R);
-	return map(e.expand());
+	upvec sigma(a.size());
+	if ( c.empty() ) return sigma;
+	for ( size_t j=0; j<a.size(); ++j ) {
+		rem(c * s[j], a[j], sigma[j]);
+	}
+	return sigma;
 }
 
 /** Utility function for multivariate Hensel lifting.
@@ -1877,122 +2868,83 @@ static ex make_modular(const ex& e, const cl_modint_ring& R)
  *
  *  The implementation follows the algorithm in chapter 6 of [GCL].
  *
- *  @param a_  vector of multivariate factors mod p^k
- *  @param x   symbol (equiv. x_1 in [GCL])
- *  @param c   polynomial mod p^k
- *  @param I   vector of evaluation points
- *  @param d   maximum total degree of result
- *  @param p   prime number
- *  @param k   p^k is modulus
- *  @return    vector of polynomials (s_i)
+ *  @param a      vector of multivariate factors mod p^k
+ *  @param c      polynomial mod p^k
+ *  @param I      vector of evaluation points, the i-th point belongs to
+ *                variable i+1
+ *  @param d      maximum total degree of result
+ *  @param solve  solver for the univariate equations, set up with the a_i
+ *                evaluated at all points of I
+ *  @param R      modular ring Z/p^k
+ *  @return       vector of polynomials (s_i)
  */
-static vector<ex> multivar_diophant(const vector<ex>& a_, const ex& x, const ex& c, const vector<EvalPoint>& I,
-                                    unsigned int d, unsigned int p, unsigned int k)
+static vector<mmodpoly> multivar_diophant(const vector<mmodpoly>& a, const mmodpoly& c, const vector<EvalPoint>& I,
+                                          unsigned int d, const univar_diophant& solve, const cl_modint_ring& R)
 {
-	vector<ex> a = a_;
-
-	const cl_modint_ring R = find_modint_ring(expt_pos(cl_I(p),k));
 	const size_t r = a.size();
 	const size_t nu = I.size() + 1;
+	const size_t nvars = a[0].begin()->first.size();
 
-	vector<ex> sigma;
+	vector<mmodpoly> sigma(r);
 	if ( nu > 1 ) {
-		ex xnu = I.back().x;
-		int alphanu = I.back().evalpoint;
+		const size_t xnu = nu - 1;
+		const int alphanu = I.back().evalpoint;
 
-		ex A = 1;
-		for ( size_t i=0; i<r; ++i ) {
-			A *= a[i];
-		}
-		vector<ex> b(r);
+		vector<mmodpoly> b(r);
 		for ( size_t i=0; i<r; ++i ) {
-			b[i] = normal(A / a[i]);
+			b[i] = a[i == 0 ? 1 : 0];
+			for ( size_t j=(i == 0 ? 2 : 1); j<r; ++j ) {
+				if ( j != i ) {
+					b[i] = b[i] * a[j];
+				}
+			}
 		}
 
-		vector<ex> anew = a;
+		vector<mmodpoly> anew(r);
 		for ( size_t i=0; i<r; ++i ) {
-			anew[i] = anew[i].subs(xnu == alphanu);
+			anew[i] = evaluate(a[i], xnu, alphanu, R);
 		}
-		ex cnew = c.subs(xnu == alphanu);
+		mmodpoly cnew = evaluate(c, xnu, alphanu, R);
 		vector<EvalPoint> Inew = I;
 		Inew.pop_back();
-		sigma = multivar_diophant(anew, x, cnew, Inew, d, p, k);
+		sigma = multivar_diophant(anew, cnew, Inew, d, solve, R);
 
-		ex buf = c;
+		mmodpoly e = c;
 		for ( size_t i=0; i<r; ++i ) {
-			buf -= sigma[i] * b[i];
-		}
-		ex e = make_modular(buf, R);
-
-		ex monomial = 1;
-		for ( size_t m=1; !e.is_zero() && e.has(xnu) && m<=d; ++m ) {
-			monomial *= (xnu - alphanu);
-			monomial = expand(monomial);
-			ex cm = e.diff(ex_to<symbol>(xnu), m).subs(xnu==alphanu) / factorial(m);
-			cm = make_modular(cm, R);
-			if ( !cm.is_zero() ) {
-				vector<ex> delta_s = multivar_diophant(anew, x, cm, Inew, d, p, k);
-				ex buf = e;
+			e = e - sigma[i] * b[i];
+		}
+
+		const mmodpoly lin = linear_factor(nvars, xnu, alphanu, R);
+		mmodpoly monomial;
+		monomial[vector<int>(nvars, 0)] = R->one();
+		for ( size_t m=1; !e.empty() && degree(e, xnu) > 0 && m<=d; ++m ) {
+			monomial = monomial * lin;
+			mmodpoly cm = taylor_coeff(e, xnu, alphanu, m, R);
+			if ( !cm.empty() ) {
+				vector<mmodpoly> delta_s = multivar_diophant(anew, cm, Inew, d, solve, R);
 				for ( size_t j=0; j<delta_s.size(); ++j ) {
-					delta_s[j] *= monomial;
-					sigma[j] += delta_s[j];
-					buf -= delta_s[j] * b[j];
+					delta_s[j] = delta_s[j] * monomial;
+					sigma[j] = sigma[j] + delta_s[j];
+					e = e - delta_s[j] * b[j];
 				}
-				e = make_modular(buf, R);
 			}
 		}
 	}
 	else {
-		upvec amod;
-		for ( size_t i=0; i<a.size(); ++i ) {
-			umodpoly up;
-			umodpoly_from_ex(up, a[i], x, R);
-			amod.push_back(up);
-		}
-
-		sigma.insert(sigma.begin(), r, 0);
-		size_t nterms;
-		ex z;
-		if ( is_a<add>(c) ) {
-			nterms = c.nops();
-			z = c.op(0);
-		}
-		else {
-			nterms = 1;
-			z = c;
-		}
-		for ( size_t i=0; i<nterms; ++i ) {
-			int m = z.degree(x);
-			cl_I cm = the<cl_I>(ex_to<numeric>(z.lcoeff(x)).to_cl_N());
-			upvec delta_s = univar_diophant(amod, x, m, p, k);
-			cl_MI modcm;
-			cl_I poscm = cm;
-			while ( poscm < 0 ) {
-				poscm = poscm + expt_pos(cl_I(p),k);
-			}
-			modcm = cl_MI(R, poscm);
-			for ( size_t j=0; j<delta_s.size(); ++j ) {
-				delta_s[j] = delta_s[j] * modcm;
-				sigma[j] = sigma[j] + umodpoly_to_ex(delta_s[j], x);
-			}
-			if ( nterms > 1 ) {
-				z = c.op(i+1);
-			}
+		upvec delta_s = solve(mmodpoly_to_umodpoly(c, R));
+		for ( size_t j=0; j<r; ++j ) {
+			sigma[j] = mmodpoly_from_umodpoly(delta_s[j], nvars);
 		}
 	}
 
-	for ( size_t i=0; i<sigma.size(); ++i ) {
-		sigma[i] = make_modular(sigma[i], R);
-	}
-
 	return sigma;
 }
 
 /** Multivariate Hensel lifting.
  *  The implementation follows the algorithm in chapter 6 of [GCL].
- *  Since we don't have a data type for modular multivariate polynomials, the
- *  respective operations are done in a GiNaC::ex and the function
- *  make_modular() is then called to make the coefficient modular p^l.
+ *  The lifting is done on sparse modular multivariate polynomials (mmodpoly),
+ *  the univariate diophantine equations are solved with one precomputed
+ *  solver per lifted variable.
  *
  *  @param a    multivariate polynomial primitive in x
  *  @param x    symbol (equiv. x_1 in [GCL])
@@ -2010,14 +2962,16 @@ static ex hensel_multivar(const ex& a, const ex& x, const vector<EvalPoint>& I,
 	const size_t nu = I.size() + 1;
 	const cl_modint_ring R = find_modint_ring(expt_pos(cl_I(p),l));
 
-	vector<ex> A(nu);
-	A[nu-1] = a;
+	vector<ex> vars(nu);
+	vars[0] = x;
+	for ( size_t i=1; i<nu; ++i ) {
+		vars[i] = I[i-1].x;
+	}
 
+	vector<mmodpoly> A(nu);
+	A[nu-1] = mmodpoly_from_ex(a, vars, R);
 	for ( size_t j=nu; j>=2; --j ) {
-		ex x = I[j-2].x;
-		int alpha = I[j-2].evalpoint;
-		A[j-2] = A[j-1].subs(x==alpha);
-		A[j-2] = make_modular(A[j-2], R);
+		A[j-2] = evaluate(A[j-1], j-1, I[j-2].evalpoint, R);
 	}
 
 	int maxdeg = a.degree(I.front().x);
@@ -2027,76 +2981,80 @@ static ex hensel_multivar(const ex& a, const ex& x, const vector<EvalPoint>& I,
 	}
 
 	const size_t n = u.size();
-	vector<ex> U(n);
+	vector<mmodpoly> U(n), LC(n);
 	for ( size_t i=0; i<n; ++i ) {
-		U[i] = umodpoly_to_ex(u[i], x);
+		U[i] = mmodpoly_from_umodpoly(u[i], nu);
+		if ( lcU[i] != 1 ) {
+			LC[i] = mmodpoly_from_ex(lcU[i], vars, R);
+		}
 	}
 
 	for ( size_t j=2; j<=nu; ++j ) {
-		vector<ex> U1 = U;
-		ex monomial = 1;
+		vector<mmodpoly> U1 = U;
 		for ( size_t m=0; m<n; ++m) {
 			if ( lcU[m] != 1 ) {
-				ex coef = lcU[m];
+				mmodpoly coef = LC[m];
 				for ( size_t i=j-1; i<nu-1; ++i ) {
-					coef = coef.subs(I[i].x == I[i].evalpoint);
+					coef = evaluate(coef, i+1, I[i].evalpoint, R);
 				}
-				coef = make_modular(coef, R);
-				int deg = U[m].degree(x);
-				U[m] = U[m] - U[m].lcoeff(x) * pow(x,deg) + coef * pow(x,deg);
+				replace_lcoeff(U[m], coef);
 			}
 		}
-		ex Uprod = 1;
+		mmodpoly Uprod = U[0];
+		for ( size_t i=1; i<n; ++i ) {
+			Uprod = Uprod * U[i];
+		}
+		mmodpoly e = A[j-1] - Uprod;
+
+		vector<EvalPoint> newI(I.begin(), I.begin()+(j-2));
+
+		// the univariate images of U1 are the same for all equations below
+		upvec U1uni(n);
 		for ( size_t i=0; i<n; ++i ) {
-			Uprod *= U[i];
-		}
-		ex e = expand(A[j-1] - Uprod);
-
-		vector<EvalPoint> newI;
-		for ( size_t i=1; i<=j-2; ++i ) {
-			newI.push_back(I[i-1]);
-		}
-
-		ex xj = I[j-2].x;
-		int alphaj = I[j-2].evalpoint;
-		size_t deg = A[j-1].degree(xj);
-		for ( size_t k=1; k<=deg; ++k ) {
-			if ( !e.is_zero() ) {
-				monomial *= (xj - alphaj);
-				monomial = expand(monomial);
-				ex dif = e.diff(ex_to<symbol>(xj), k);
-				ex c = dif.subs(xj==alphaj) / factorial(k);
-				if ( !c.is_zero() ) {
-					vector<ex> deltaU = multivar_diophant(U1, x, c, newI, maxdeg, p, cl_I_to_uint(l));
+			mmodpoly buf = U1[i];
+			for ( size_t v=1; v<j-1; ++v ) {
+				buf = evaluate(buf, v, I[v-1].evalpoint, R);
+			}
+			U1uni[i] = mmodpoly_to_umodpoly(buf, R);
+		}
+		const univar_diophant solve(U1uni, p, cl_I_to_uint(l));
+
+		const size_t xj = j-1;
+		const int alphaj = I[j-2].evalpoint;
+		const mmodpoly lin = linear_factor(nu, xj, alphaj, R);
+		mmodpoly monomial;
+		monomial[vector<int>(nu, 0)] = R->one();
+		const int deg = degree(A[j-1], xj);
+		for ( int k=1; k<=deg; ++k ) {
+			if ( !e.empty() ) {
+				monomial = monomial * lin;
+				mmodpoly c = taylor_coeff(e, xj, alphaj, k, R);
+				if ( !c.empty() ) {
+					vector<mmodpoly> deltaU = multivar_diophant(U1, c, newI, maxdeg, solve, R);
 					for ( size_t i=0; i<n; ++i ) {
-						deltaU[i] *= monomial;
-						U[i] += deltaU[i];
-						U[i] = make_modular(U[i], R);
+						U[i] = U[i] + deltaU[i] * monomial;
 					}
-					ex Uprod = 1;
-					for ( size_t i=0; i<n; ++i ) {
-						Uprod *= U[i];
+					Uprod = U[0];
+					for ( size_t i=1; i<n; ++i ) {
+						Uprod = Uprod * U[i];
 					}
 					e = A[j-1] - Uprod;
-					e = make_modular(e, R);
 				}
 			}
 		}
 	}
 
+	lst res;
 	ex acand = 1;
 	for ( size_t i=0; i<U.size(); ++i ) {
-		acand *= U[i];
+		ex f = mmodpoly_to_ex(U[i], vars);
+		res.append(f);
+		acand *= f;
 	}
 	if ( expand(a-acand).is_zero() ) {
-		lst res;
-		for ( size_t i=0; i<U.size(); ++i ) {
-			res.append(U[i]);
-		}
 		return res;
 	}
 	else {
-		lst res;
 		return lst();
 	}
 }
@@ -2237,6 +3195,34 @@ static void generate_set(const ex& u, const ex& vn, const exset& syms, const lst
 	}
 }
 
+/** Number of evaluation points compared by factor_multivariate().
+ */
+static const unsigned int multivariate_point_trials = 4;
+
+/** Like univariate_prime_trials, used to estimate the factor count of the
+ *  univariate images in factor_multivariate().
+ */
+static const unsigned int multivariate_prime_trials = 2;
+
+/** Returns an upper bound for the number of irreducible factors of a
+ *  univariate polynomial, the least number of modular factors found by
+ *  choose_prime().
+ *
+ *  @param[in] u  square free univariate polynomial
+ *  @param[in] x  symbol
+ *  @return       upper bound for the number of factors, 1 if u is irreducible
+ */
+static size_t estimate_factor_count(const ex& u, const ex& x)
+{
+	ex unit, cont, prim_ex;
+	u.unitcontprim(x, unit, cont, prim_ex);
+	upoly prim;
+	upoly_from_ex(prim, prim_ex, x);
+
+	unsigned int prime = 3;
+	return choose_prime(prim, lcoeff(prim), multivariate_prime_trials, prime);
+}
+
 // forward declaration
 static ex factor_sqrfree(const ex& poly);
 
@@ -2278,49 +3264,48 @@ static ex factor_multivariate(const ex& poly, const exset& syms)
 		vnlst = put_factors_into_lst(vnfactors);
 	}
 
-	const unsigned int maxtrials = 3;
 	numeric modulus = (vnlst.nops() > 3) ? vnlst.nops() : 3;
 	vector<numeric> a(syms.size()-1, 0);
 
 	// try now to factorize until we are successful
 	while ( true ) {
 
-		unsigned int trialcount = 0;
 		unsigned int prime;
 		int factor_count = 0;
-		int min_factor_count = -1;
 		ex u, delta;
 		ex ufac, ufaclst;
 
-		// try several evaluation points to reduce the number of factors
-		while ( trialcount < maxtrials ) {
+		// compare several evaluation points by the number of modular factors
+		// of the univariate image and factorize only the most promising one
+		size_t min_factor_count = 0;
+		vector<numeric> besta;
+		for ( unsigned int trial=0; trial<multivariate_point_trials; ++trial ) {
 
 			// generate a set of valid evaluation points
-			generate_set(pp, vn, syms, ex_to<lst>(vnlst), modulus, u, a);
-
-			ufac = factor_univariate(u, x, prime);
-			ufaclst = put_factors_into_lst(ufac);
-			factor_count = ufaclst.nops()-1;
-			delta = ufaclst.op(0);
+			ex ucand;
+			generate_set(pp, vn, syms, ex_to<lst>(vnlst), modulus, ucand, a);
 
-			if ( factor_count <= 1 ) {
+			const size_t count = estimate_factor_count(ucand, x);
+			if ( count <= 1 ) {
 				// irreducible
 				return poly;
 			}
-			if ( min_factor_count < 0 ) {
-				// first time here
-				min_factor_count = factor_count;
-			}
-			else if ( min_factor_count == factor_count ) {
-				// one less to try
-				++trialcount;
-			}
-			else if ( min_factor_count > factor_count ) {
-				// new minimum, reset trial counter
-				min_factor_count = factor_count;
-				trialcount = 0;
+			if ( min_factor_count == 0 || count < min_factor_count ) {
+				min_factor_count = count;
+				u = ucand;
+				besta = a;
 			}
 		}
+		a = besta;
+
+		ufac = factor_univariate(u, x, prime);
+		ufaclst = put_factors_into_lst(ufac);
+		factor_count = ufaclst.nops()-1;
+		delta = ufaclst.op(0);
+		if ( factor_count <= 1 ) {
+			// irreducible
+			return poly;
+		}
 
 		// determine true leading coefficients for the Hensel lifting
 		vector<ex> C(factor_count);
@@ -2608,6 +3593,104 @@ ex factor(const ex& poly, unsigned options)
 	return f;
 }
 
+/** Factorizes several polynomials at once, for inputs sharing many factors.
+ *  The square free parts of all polynomials are refined into a coprime basis
+ *  with gcd(), so a factor common to several inputs is factorized only once.
+ *  The factorized basis elements are then reassembled for every input.
+ */
+exvector factor_batch(const exvector& polys, unsigned options)
+{
+	exvector result(polys.size(), _ex1);
+
+	// square free polynomial parts of all inputs with the input they belong
+	// to and their exponent, anything else goes directly into the result
+	exvector parts, exponents;
+	vector<size_t> owner;
+	for ( size_t i=0; i<polys.size(); ++i ) {
+		const ex& poly = polys[i];
+		if ( !poly.info(info_flags::polynomial) ) {
+			result[i] = factor(poly, options);
+			continue;
+		}
+		find_symbols_map findsymbols;
+		findsymbols(poly);
+		if ( findsymbols.syms.size() == 0 ) {
+			result[i] = poly;
+			continue;
+		}
+		lst syms;
+		exset::const_iterator s=findsymbols.syms.begin(), end=findsymbols.syms.end();
+		for ( ; s!=end; ++s ) {
+			syms.append(*s);
+		}
+
+		ex sfpoly = sqrfree(poly.expand(), syms);
+		const size_t nfactors = is_a<mul>(sfpoly) ? sfpoly.nops() : 1;
+		for ( size_t j=0; j<nfactors; ++j ) {
+			const ex& t = is_a<mul>(sfpoly) ? sfpoly.op(j) : sfpoly;
+			const bool is_pow = is_a<power>(t);
+			const ex& base = is_pow ? t.op(0) : t;
+			if ( is_a<add>(base) ) {
+				parts.push_back(base);
+				exponents.push_back(is_pow ? t.op(1) : _ex1);
+				owner.push_back(i);
+			}
+			else {
+				result[i] *= t;
+			}
+		}
+	}
+
+	// refine the parts into pairwise coprime basis elements. All parts are
+	// square free, so a part and a basis element split into their gcd and
+	// two coprime cofactors.
+	exvector basis;
+	vector< vector<size_t> > contained_in;
+	for ( size_t k=0; k<parts.size(); ++k ) {
+		ex c = parts[k];
+		const size_t nbasis = basis.size();
+		for ( size_t j=0; j<nbasis && !is_a<numeric>(c); ++j ) {
+			ex cb, cc;
+			ex g = gcd(basis[j], c, &cb, &cc);
+			if ( is_a<numeric>(g) ) {
+				continue;
+			}
+			if ( !is_a<numeric>(cb) ) {
+				basis.push_back(cb.expand());
+				contained_in.push_back(contained_in[j]);
+			}
+			basis[j] = g.expand();
+			contained_in[j].push_back(k);
+			c = cc.expand();
+		}
+		if ( !is_a<numeric>(c) ) {
+			basis.push_back(c);
+			contained_in.push_back(vector<size_t>(1, k));
+		}
+	}
+
+	// factorize the basis elements and reassemble
+	exvector fparts(parts.size(), _ex1);
+	exvector prods(parts.size(), _ex1);
+	for ( size_t j=0; j<basis.size(); ++j ) {
+		const ex f = is_a<add>(basis[j]) ? factor_sqrfree(basis[j]) : basis[j];
+		for ( size_t i=0; i<contained_in[j].size(); ++i ) {
+			const size_t k = contained_in[j][i];
+			fparts[k] *= f;
+			prods[k] *= basis[j];
+		}
+	}
+	for ( size_t k=0; k<parts.size(); ++k ) {
+		ex unit;
+		if ( !divide(parts[k], prods[k].expand(), unit) ) {
+			throw logic_error("factor_batch: basis does not divide input.");
+		}
+		result[owner[k]] *= pow(unit * fparts[k], exponents[k]);
+	}
+
+	return result;
+}
+
 } // namespace GiNaC
 
 #ifdef DEBUGFACTOR
@@ -23,9 +23,9 @@
 #ifndef GINAC_FACTOR_H
 #define GINAC_FACTOR_H
 
-namespace GiNaC {
+#include "ex.h"
 
-class ex;
+namespace GiNaC {
 
 /** Factorizes univariate and multivariate polynomials.
  *  
@@ -41,6 +41,18 @@ class ex;
  */
 extern ex factor(const ex& poly, unsigned options = 0);
 
+/** Factorizes several polynomials which have many factors in common.
+ *
+ *  The square free parts of all polynomials are refined into a basis of
+ *  pairwise coprime polynomials first, and only the distinct basis elements
+ *  are factorized.
+ *
+ *  @param[in] polys   expressions to factorize
+ *  @param[in] option  options to influence the factorization, see factor()
+ *  @return            factorized expressions, in the order of polys
+ */
+extern exvector factor_batch(const exvector& polys, unsigned options = 0);
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_FACTOR_H
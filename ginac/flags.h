@@ -133,7 +133,18 @@ public:
 		 *  division.  The determinant can then be read of from the lower
 		 *  right entry.  This algorithm is rarely fast for computing
 		 *  determinants. */
-		bareiss
+		bareiss,
+		/** Evaluation/interpolation modulo primes.  For matrices of
+		 *  polynomials with rational coefficients the symbols are
+		 *  evaluated at the points of a grid, the determinants of the
+		 *  resulting numeric matrices are computed modulo word-sized
+		 *  primes, interpolated and combined by Chinese remaindering.
+		 *  Falls back to the automatic choice for other matrices or if
+		 *  the grid gets too large.  The primes are added until the
+		 *  result stabilizes, which is extremely unlikely (but not
+		 *  impossible) to happen before the coefficients are fully
+		 *  reconstructed. */
+		modular
 	};
 };
 
@@ -182,7 +193,22 @@ public:
 		 *  linear systems.  In contrast to division-free elimination it only
 		 *  has a linear expression swell.  For two-dimensional systems, the
 		 *  two algorithms are equivalent, however. */
-		bareiss
+		bareiss,
+		/** Sparse Gauss elimination.  Only the non-zero entries of the
+		 *  matrix are stored and the pivots are chosen by the Markowitz
+		 *  criterion, i.e. an entry is preferred if its row and column
+		 *  have few other non-zero entries, which keeps the fill-in low.
+		 *  This is the method of choice for large systems where each
+		 *  equation only involves a few unknowns. */
+		markowitz,
+		/** p-adic lifting (Dixon's algorithm).  The matrix is inverted
+		 *  modulo a word-sized prime once and the solution is lifted
+		 *  p-adically until it can be recovered by rational number
+		 *  reconstruction, so there is no coefficient growth and no GCD
+		 *  computation during the elimination.  It only applies to square
+		 *  non-singular systems with rational coefficients, otherwise Gauss
+		 *  elimination is used. */
+		dixon
 	};
 };
 
@@ -288,6 +314,25 @@ public:
 	};
 };
 
+/** Switch to control algorithm for square-free factorization. */
+class sqrfree_algo {
+public:
+	enum {
+		/** Let the system choose.  Large multivariate polynomials are
+		 *  decomposed by the modular algorithm, all others by Yun's
+		 *  algorithm over the integers. */
+		automatic,
+		/** Yun's algorithm.  The GCDs of the polynomial and its derivatives
+		 *  are computed over the integers. */
+		yun,
+		/** Yun's algorithm on images modulo several primes, combined by
+		 *  Chinese remaindering and checked by trial division.  This avoids
+		 *  the expensive GCDs over the integers for large multivariate
+		 *  polynomials.  Falls back to yun if no suitable primes are left. */
+		modular
+	};
+};
+
 /** Flags to control the polynomial factorization. */
 class factor_options {
 public:
@@ -0,0 +1,322 @@
+/** @file float_matrix.cpp
+ *
+ *  Implementation of the hardware floating point routines used for numeric
+ *  matrices of low precision. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "float_matrix.h"
+#include "numeric.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GiNaC {
+
+/** Columns per block of the LU decomposition.  One block of rows of U has
+ *  to stay in cache while the trailing submatrix is updated. */
+static const unsigned lu_block_size = 32;
+
+/** Largest value of Digits for which machine doubles are accurate enough. */
+static const long float_max_digits = 15;
+
+/** Infinities and NaNs are the only doubles which do not vanish when
+ *  subtracted from themselves. */
+static inline bool is_finite(double d)
+{
+	return d - d == 0;
+}
+
+/** Convert numeric entries to machine doubles.  This only succeeds if
+ *  Digits is low enough for hardware floating point to be accurate, all
+ *  entries are real numbers and none of them overflows or underflows when
+ *  converted.
+ *
+ *  @param v  entries to convert
+ *  @param d  the converted entries (returned)
+ *  @param inexact  set if any of the entries is a floating point number
+ *  @return true if all entries could be converted */
+bool to_doubles(const exvector & v, std::vector<double> & d, bool & inexact)
+{
+	if (long(Digits) > float_max_digits)
+		return false;
+	d.clear();
+	d.reserve(v.size());
+	for (exvector::const_iterator i = v.begin(); i != v.end(); ++i) {
+		if (!is_exactly_a<numeric>(*i))
+			return false;
+		const numeric & x = ex_to<numeric>(*i);
+		if (!x.is_real())
+			return false;
+		if (!x.is_rational())
+			inexact = true;
+		const double y = x.to_double();
+		if (!is_finite(y) || (y == 0 && !x.is_zero()))
+			return false;
+		d.push_back(y);
+	}
+	return true;
+}
+
+/** Factorize the n x n matrix a given in row-major order. */
+float_lu::float_lu(const std::vector<double> & a, unsigned n_)
+  : n(n_), lu(a), perm(n_), sign(1), singular(false)
+{
+	for (unsigned i=0; i<n; ++i)
+		perm[i] = i;
+	factor();
+}
+
+/** Right-looking blocked LU decomposition.  A panel of lu_block_size
+ *  columns is factorized column by column, with row interchanges applied to
+ *  whole rows.  Then the rows of U to the right of the panel are completed
+ *  and the trailing submatrix gets the rank-k update from the panel.  Every
+ *  innermost loop runs along a row, which the compiler can vectorize. */
+void float_lu::factor()
+{
+	for (unsigned k0=0; k0<n; k0+=lu_block_size) {
+		const unsigned k1 = std::min(k0+lu_block_size, n);
+
+		// factorize the panel
+		for (unsigned k=k0; k<k1; ++k) {
+			unsigned p = k;
+			double pmax = std::fabs(lu[k*n+k]);
+			for (unsigned i=k+1; i<n; ++i) {
+				const double t = std::fabs(lu[i*n+k]);
+				if (t > pmax) {
+					pmax = t;
+					p = i;
+				}
+			}
+			if (pmax == 0) {
+				singular = true;
+				continue;
+			}
+			if (p != k) {
+				std::swap_ranges(lu.begin()+p*n, lu.begin()+(p+1)*n, lu.begin()+k*n);
+				std::swap(perm[p], perm[k]);
+				sign = -sign;
+			}
+			const double * uk = &lu[k*n];
+			const double inv = 1/uk[k];
+			for (unsigned i=k+1; i<n; ++i) {
+				double * ai = &lu[i*n];
+				if (ai[k] == 0)
+					continue;
+				const double l = ai[k] *= inv;
+				for (unsigned j=k+1; j<k1; ++j)
+					ai[j] -= l*uk[j];
+			}
+		}
+		if (k1 == n)
+			break;
+
+		// rows of U to the right of the panel
+		for (unsigned k=k0; k<k1; ++k) {
+			const double * uk = &lu[k*n];
+			for (unsigned i=k+1; i<k1; ++i) {
+				double * ai = &lu[i*n];
+				const double l = ai[k];
+				if (l == 0)
+					continue;
+				for (unsigned j=k1; j<n; ++j)
+					ai[j] -= l*uk[j];
+			}
+		}
+
+		// update of the trailing submatrix
+		for (unsigned i=k1; i<n; ++i) {
+			double * ai = &lu[i*n];
+			for (unsigned k=k0; k<k1; ++k) {
+				const double l = ai[k];
+				if (l == 0)
+					continue;
+				const double * uk = &lu[k*n];
+				for (unsigned j=k1; j<n; ++j)
+					ai[j] -= l*uk[j];
+			}
+		}
+	}
+}
+
+/** The number mant*2^e as a numeric, also if it is outside the range of
+ *  doubles. */
+static numeric scaled_numeric(double mant, long e)
+{
+	const double d = std::ldexp(mant, e);
+	if (is_finite(d) && (d != 0 || mant == 0))
+		return numeric(d);
+	return numeric(mant).mul(numeric(2).power(e));
+}
+
+/** Determinant of the factorized matrix.  The product of the pivots is
+ *  accumulated with a separate binary exponent, so it does not overflow
+ *  even if it is outside the range of doubles. */
+ex float_lu::determinant() const
+{
+	if (singular)
+		return numeric(0);
+	double mant = sign;
+	long e = 0;
+	for (unsigned i=0; i<n; ++i) {
+		int k;
+		mant = std::frexp(mant*lu[i*n+i], &k);
+		e += k;
+	}
+	return scaled_numeric(mant, e);
+}
+
+/** Solve for q right hand sides at once.
+ *
+ *  @param b  the n x q right hand side in row-major order, overwritten by
+ *  the solution
+ *  @return false if the matrix is singular or the solution is not finite */
+bool float_lu::solve(std::vector<double> & b, unsigned q) const
+{
+	if (singular)
+		return false;
+
+	std::vector<double> x(n*q);
+	for (unsigned i=0; i<n; ++i)
+		std::copy(b.begin()+perm[i]*q, b.begin()+(perm[i]+1)*q, x.begin()+i*q);
+
+	// forward substitution with L
+	for (unsigned i=1; i<n; ++i) {
+		double * xi = &x[i*q];
+		for (unsigned k=0; k<i; ++k) {
+			const double l = lu[i*n+k];
+			if (l == 0)
+				continue;
+			const double * xk = &x[k*q];
+			for (unsigned j=0; j<q; ++j)
+				xi[j] -= l*xk[j];
+		}
+	}
+
+	// back substitution with U
+	for (unsigned i=n; i-- != 0; ) {
+		double * xi = &x[i*q];
+		for (unsigned k=i+1; k<n; ++k) {
+			const double u = lu[i*n+k];
+			if (u == 0)
+				continue;
+			const double * xk = &x[k*q];
+			for (unsigned j=0; j<q; ++j)
+				xi[j] -= u*xk[j];
+		}
+		const double inv = 1/lu[i*n+i];
+		for (unsigned j=0; j<q; ++j)
+			xi[j] *= inv;
+	}
+
+	for (std::vector<double>::const_iterator i = x.begin(); i != x.end(); ++i)
+		if (!is_finite(*i))
+			return false;
+	b.swap(x);
+	return true;
+}
+
+/** Characteristic polynomial of a matrix of doubles, coefficients of
+ *  det(lambda*1 - M) in increasing powers of lambda.  This is the same
+ *  reduction to upper Hessenberg form with partial pivoting as for numeric
+ *  matrices, done in hardware floating point.  The coefficients easily
+ *  leave the range of doubles, so the matrix is first scaled by a power of
+ *  two to eigenvalues of order one.
+ *
+ *  @param H  entries of the matrix in row-major order, overwritten
+ *  @param n  dimension of the matrix
+ *  @param c  the coefficients (returned)
+ *  @return false if a coefficient is not finite */
+bool charpoly_float(std::vector<double> & H, unsigned n, std::vector<numeric> & c)
+{
+	// The root mean square of the rows estimates the size of the
+	// eigenvalues.
+	double norm = 0;
+	for (std::vector<double>::const_iterator i = H.begin(); i != H.end(); ++i)
+		norm += *i * *i;
+	int scale = 0;
+	if (norm > 0) {
+		std::frexp(std::sqrt(norm/n), &scale);
+		for (std::vector<double>::iterator i = H.begin(); i != H.end(); ++i)
+			*i = std::ldexp(*i, -scale);
+	}
+
+	for (unsigned col=0; col+2<n; ++col) {
+		unsigned p = col+1;
+		for (unsigned r=col+2; r<n; ++r)
+			if (std::fabs(H[r*n+col]) > std::fabs(H[p*n+col]))
+				p = r;
+		if (H[p*n+col] == 0)
+			continue;
+		if (p != col+1) {
+			std::swap_ranges(H.begin()+p*n, H.begin()+(p+1)*n, H.begin()+(col+1)*n);
+			for (unsigned i=0; i<n; ++i)
+				std::swap(H[i*n+p], H[i*n+col+1]);
+		}
+		const double * hp = &H[(col+1)*n];
+		const double inv = 1/hp[col];
+		for (unsigned r=col+2; r<n; ++r) {
+			double * hr = &H[r*n];
+			if (hr[col] == 0)
+				continue;
+			const double u = hr[col]*inv;
+			for (unsigned j=col; j<n; ++j)
+				hr[j] -= u*hp[j];
+			for (unsigned i=0; i<n; ++i)
+				H[i*n+col+1] += u*H[i*n+r];
+		}
+	}
+
+	// p[k] holds the characteristic polynomial of the leading k x k
+	// submatrix, coefficients in increasing powers of lambda.
+	std::vector<std::vector<double> > p(n+1);
+	p[0].push_back(1);
+	for (unsigned k=1; k<=n; ++k) {
+		std::vector<double> & pk = p[k];
+		const std::vector<double> & pk1 = p[k-1];
+		pk.resize(k+1);
+		for (unsigned j=0; j<k; ++j) {
+			pk[j+1] += pk1[j];
+			pk[j] -= H[(k-1)*n+k-1]*pk1[j];
+		}
+		double t = 1;
+		for (unsigned i=1; i<k; ++i) {
+			t *= H[(k-i)*n+k-i-1];
+			if (t == 0)
+				break;
+			const double h = H[(k-i-1)*n+k-1]*t;
+			if (h == 0)
+				continue;
+			const std::vector<double> & pki = p[k-i-1];
+			for (unsigned j=0; j<pki.size(); ++j)
+				pk[j] -= h*pki[j];
+		}
+	}
+
+	c.clear();
+	c.reserve(n+1);
+	for (unsigned k=0; k<=n; ++k) {
+		if (!is_finite(p[n][k]))
+			return false;
+		c.push_back(scaled_numeric(p[n][k], long(scale)*(n-k)));
+	}
+	return true;
+}
+
+} // namespace GiNaC
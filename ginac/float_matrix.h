@@ -0,0 +1,63 @@
+/** @file float_matrix.h
+ *
+ *  Interface to the hardware floating point routines used for numeric
+ *  matrices of low precision. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_FLOAT_MATRIX_H
+#define GINAC_FLOAT_MATRIX_H
+
+#include "ex.h"
+
+#include <vector>
+
+namespace GiNaC {
+
+class numeric;
+
+/** LU decomposition with partial pivoting of a square matrix of machine
+ *  doubles, P*A == L*U with unit lower triangular L.  The factorization is
+ *  done block by block so that the bulk of the work is a rank-k update
+ *  running along contiguous rows.  This is not a GiNaC class, it is only
+ *  used internally by class matrix. */
+class float_lu {
+public:
+	float_lu(const std::vector<double> & a, unsigned n);
+
+	bool is_singular() const { return singular; }
+	ex determinant() const;
+	bool solve(std::vector<double> & b, unsigned q) const;
+
+private:
+	void factor();
+
+	unsigned n;
+	std::vector<double> lu;        ///< L below and U on and above the diagonal
+	std::vector<unsigned> perm;    ///< row i of P*A is row perm[i] of A
+	int sign;                      ///< sign of the permutation
+	bool singular;
+};
+
+extern bool to_doubles(const exvector & v, std::vector<double> & d, bool & inexact);
+extern bool charpoly_float(std::vector<double> & H, unsigned n, std::vector<numeric> & c);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_FLOAT_MATRIX_H
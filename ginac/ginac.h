@@ -37,6 +37,7 @@
 #include "integral.h"
 #include "lst.h"
 #include "matrix.h"
+#include "lu_decomposition.h"
 #include "numeric.h"
 #include "power.h"
 #include "relational.h"
@@ -30,10 +30,13 @@
 #include "operators.h"
 #include "relational.h"
 #include "pseries.h"
+#include "sparse_matrix.h"
 #include "symbol.h"
 #include "symmetry.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <map>
 #include <stdexcept>
 #include <vector>
 
@@ -1020,35 +1023,103 @@ ex lsolve(const ex &eqns, const ex &symbols, unsigned options)
 		}
 	}
 	
-	// build matrix from equation system
-	matrix sys(eqns.nops(),symbols.nops());
-	matrix rhs(eqns.nops(),1);
-	matrix vars(symbols.nops(),1);
+	// build the rows of the augmented matrix from the equation system,
+	// the right hand side goes into column n
+	const unsigned m = eqns.nops(), n = symbols.nops();
+	std::vector<sparse_matrix::row_type> rows(m);
+	matrix vars(n,1);
 	
-	for (size_t r=0; r<eqns.nops(); r++) {
+	// In large systems every equation usually only contains a few of the
+	// unknowns, so only the coefficients of these are computed
+	std::map<ex, size_t, ex_is_less> symbol_index;
+	for (size_t i=0; i<n; i++) {
+		symbol_index[symbols.op(i)] = i;
+		vars(i,0) = symbols.op(i);
+	}
+	std::vector<size_t> cols;
+	for (size_t r=0; r<m; r++) {
 		const ex eq = eqns.op(r).op(0)-eqns.op(r).op(1); // lhs-rhs==0
+		cols.clear();
+		for (const_preorder_iterator i=eq.preorder_begin(); i!=eq.preorder_end(); ++i) {
+			std::map<ex, size_t, ex_is_less>::const_iterator s = symbol_index.find(*i);
+			if (s != symbol_index.end())
+				cols.push_back(s->second);
+		}
+		std::sort(cols.begin(), cols.end());
+		cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
 		ex linpart = eq;
-		for (size_t c=0; c<symbols.nops(); c++) {
-			const ex co = eq.coeff(ex_to<symbol>(symbols.op(c)),1);
-			linpart -= co*symbols.op(c);
-			sys(r,c) = co;
+		for (std::vector<size_t>::const_iterator c=cols.begin(); c!=cols.end(); ++c) {
+			const ex co = eq.coeff(ex_to<symbol>(symbols.op(*c)),1);
+			linpart -= co*symbols.op(*c);
+			rows[r].push_back(sparse_matrix::entry(*c, co));
 		}
 		linpart = linpart.expand();
-		rhs(r,0) = -linpart;
+		rows[r].push_back(sparse_matrix::entry(n, -linpart));
 	}
 	
-	// test if system is linear and fill vars matrix
-	for (size_t i=0; i<symbols.nops(); i++) {
-		vars(i,0) = symbols.op(i);
-		if (sys.has(symbols.op(i)))
-			throw(std::logic_error("lsolve: system is not linear"));
-		if (rhs.has(symbols.op(i)))
-			throw(std::logic_error("lsolve: system is not linear"));
+	// test if system is linear and gather the same statistical
+	// information as matrix::solve() does
+	bool numeric_flag = true;
+	bool normal_flag = false;
+	unsigned sparse_count = 0;  // counts non-zero coefficients
+	for (size_t r=0; r<m; r++) {
+		for (sparse_matrix::row_type::const_iterator i=rows[r].begin(); i!=rows[r].end(); ++i) {
+			const ex & e = i->second;
+			if (i->first < n && !e.is_zero())
+				++sparse_count;
+			if (e.info(info_flags::numeric))
+				continue;
+			numeric_flag = false;
+			for (const_preorder_iterator j=e.preorder_begin(); j!=e.preorder_end(); ++j)
+				if (symbol_index.find(*j) != symbol_index.end())
+					throw(std::logic_error("lsolve: system is not linear"));
+			if (i->first < n && !normal_flag) {
+				exmap srl;  // symbol replacement list
+				ex rtest = e.to_rational(srl);
+				if (!rtest.info(info_flags::crational_polynomial) &&
+				     rtest.info(info_flags::rational_function))
+					normal_flag = true;
+			}
+		}
+	}
+	
+	// Square systems which decompose into smaller subsystems are left to
+	// matrix::solve(), which solves them block by block.
+	bool decomposes = false;
+	if (options == solve_algo::automatic && m == n && m > 3) {
+		std::vector<std::vector<unsigned> > adj(m);
+		for (size_t r=0; r<m; r++)
+			for (sparse_matrix::row_type::const_iterator i=rows[r].begin(); i!=rows[r].end(); ++i)
+				if (i->first < n && !i->second.is_zero())
+					adj[r].push_back(i->first);
+		std::vector<matrix_block> blocks;
+		decomposes = block_triangular_form(adj, blocks) && blocks.size() > 1;
 	}
 	
 	matrix solution;
 	try {
-		solution = sys.solve(vars,rhs,options);
+		// Other symbolic systems which matrix::solve() would hand to
+		// sparse elimination anyway are eliminated right away, without
+		// setting up the dense matrix first.
+		if (options == solve_algo::markowitz ||
+		    (options == solve_algo::automatic && !numeric_flag && !decomposes &&
+		     prefer_sparse_elimination(m, n, sparse_count, numeric_flag, normal_flag))) {
+			sparse_matrix sparse(n, 1, rows);
+			sparse.eliminate();
+			solution = sparse.solve(vars);
+		} else {
+			matrix sys(m,n);
+			matrix rhs(m,1);
+			for (size_t r=0; r<m; r++) {
+				for (sparse_matrix::row_type::const_iterator i=rows[r].begin(); i!=rows[r].end(); ++i) {
+					if (i->first < n)
+						sys(r,i->first) = i->second;
+					else
+						rhs(r,0) = i->second;
+				}
+			}
+			solution = sys.solve(vars,rhs,options);
+		}
 	} catch (const std::runtime_error & e) {
 		// Probably singular matrix or otherwise overdetermined system:
 		// It is consistent to return an empty list
@@ -0,0 +1,340 @@
+/** @file lu_decomposition.cpp
+ *
+ *  Implementation of the triangular decomposition of matrices. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "lu_decomposition.h"
+#include "matrix.h"
+#include "numeric.h"
+#include "normal.h"
+#include "operators.h"
+#include "archive.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace GiNaC {
+
+GINAC_IMPLEMENT_REGISTERED_CLASS_OPT(lu_decomposition, basic,
+  print_func<print_context>(&lu_decomposition::do_print))
+
+//////////
+// default constructor
+//////////
+
+lu_decomposition::lu_decomposition() : row(0), col(0), algo(solve_algo::gauss)
+{
+}
+
+//////////
+// other constructors
+//////////
+
+/** Decompose a matrix.  Numeric matrices are eliminated by Gauss'
+ *  algorithm, others by Bareiss' fraction-free algorithm; the other
+ *  algorithms of matrix::solve() do not produce a decomposition and are
+ *  treated like solve_algo::automatic.
+ *
+ *  @param a     the coefficient matrix
+ *  @param algo  solve_algo::gauss, solve_algo::bareiss or
+ *               solve_algo::automatic */
+lu_decomposition::lu_decomposition(const matrix & a, unsigned algo_)
+  : row(a.rows()), col(a.cols()), algo(algo_), u(row*col), l(row*row, _ex0), perm(row)
+{
+	bool numeric_flag = true;
+	bool polynomial_flag = true;
+	for (unsigned r=0; r<row; ++r) {
+		for (unsigned c=0; c<col; ++c) {
+			const ex & e = a(r,c);
+			if (!e.info(info_flags::numeric))
+				numeric_flag = false;
+			if (polynomial_flag && !e.info(info_flags::rational_polynomial))
+				polynomial_flag = false;
+			u[r*col+c] = e;
+		}
+		perm[r] = r;
+	}
+	if (algo != solve_algo::gauss && algo != solve_algo::bareiss)
+		algo = numeric_flag ? solve_algo::gauss : solve_algo::bareiss;
+
+	// entries of U are kept expanded if they are polynomials and normalized
+	// otherwise, so that a test for zero is reliable
+	for (exvector::iterator i = u.begin(); i != u.end(); ++i) {
+		if (i->info(info_flags::numeric))
+			continue;
+		*i = polynomial_flag ? i->expand() : i->normal();
+	}
+
+	ex divisor = _ex1;  // previous pivot for Bareiss elimination
+	for (unsigned c0=0; c0<col && pivot_cols.size()<row; ++c0) {
+		const unsigned r0 = pivot_cols.size();
+		unsigned indx = r0;
+		while (indx<row && u[indx*col+c0].is_zero())
+			++indx;
+		if (indx == row)
+			continue;
+		if (indx > r0) {
+			for (unsigned c=0; c<col; ++c)
+				u[indx*col+c].swap(u[r0*col+c]);
+			for (unsigned k=0; k<r0; ++k)
+				l[indx*row+k].swap(l[r0*row+k]);
+			std::swap(perm[indx], perm[r0]);
+		}
+		pivot_cols.push_back(c0);
+		const ex & pivot = u[r0*col+c0];
+		for (unsigned r2=r0+1; r2<row; ++r2) {
+			if (algo == solve_algo::gauss) {
+				if (u[r2*col+c0].is_zero())
+					continue;
+				ex f = u[r2*col+c0] / pivot;
+				if (!f.info(info_flags::numeric))
+					f = f.normal();
+				for (unsigned c=c0+1; c<col; ++c) {
+					if (u[r0*col+c].is_zero())
+						continue;
+					ex & e = u[r2*col+c];
+					e -= f * u[r0*col+c];
+					if (!e.info(info_flags::numeric))
+						e = e.normal();
+				}
+				l[r2*row+r0] = f;
+			} else {
+				const ex f = u[r2*col+c0];
+				for (unsigned c=c0+1; c<col; ++c) {
+					ex & e = u[r2*col+c];
+					const ex dividend = pivot*e - f*u[r0*col+c];
+					if (polynomial_flag) {
+						if (!divide(dividend.expand(), divisor, e, false))
+							throw (std::logic_error("lu_decomposition: inexact division"));
+					} else
+						e = (dividend/divisor).normal();
+				}
+				l[r2*row+r0] = f;
+			}
+			u[r2*col+c0] = _ex0;
+		}
+		divisor = pivot;
+	}
+}
+
+//////////
+// archiving
+//////////
+
+void lu_decomposition::read_archive(const archive_node &n, lst &sym_lst)
+{
+	inherited::read_archive(n, sym_lst);
+
+	if (!(n.find_unsigned("row", row)) || !(n.find_unsigned("col", col)) ||
+	    !(n.find_unsigned("algo", algo)))
+		throw (std::runtime_error("unknown lu_decomposition dimensions in archive"));
+	u.resize(row*col);
+	for (unsigned i=0; i<row*col; ++i)
+		n.find_ex("u", u[i], sym_lst, i);
+	l.resize(row*row);
+	for (unsigned i=0; i<row*row; ++i)
+		n.find_ex("l", l[i], sym_lst, i);
+	perm.resize(row);
+	for (unsigned i=0; i<row; ++i)
+		n.find_unsigned("perm", perm[i], i);
+	pivot_cols.clear();
+	unsigned c;
+	while (n.find_unsigned("pivot", c, pivot_cols.size()))
+		pivot_cols.push_back(c);
+}
+GINAC_BIND_UNARCHIVER(lu_decomposition);
+
+void lu_decomposition::archive(archive_node &n) const
+{
+	inherited::archive(n);
+	n.add_unsigned("row", row);
+	n.add_unsigned("col", col);
+	n.add_unsigned("algo", algo);
+	for (exvector::const_iterator i = u.begin(); i != u.end(); ++i)
+		n.add_ex("u", *i);
+	for (exvector::const_iterator i = l.begin(); i != l.end(); ++i)
+		n.add_ex("l", *i);
+	for (std::vector<unsigned>::const_iterator i = perm.begin(); i != perm.end(); ++i)
+		n.add_unsigned("perm", *i);
+	for (std::vector<unsigned>::const_iterator i = pivot_cols.begin(); i != pivot_cols.end(); ++i)
+		n.add_unsigned("pivot", *i);
+}
+
+//////////
+// functions overriding virtual functions from base classes
+//////////
+
+int lu_decomposition::compare_same_type(const basic & other) const
+{
+	GINAC_ASSERT(is_exactly_a<lu_decomposition>(other));
+	const lu_decomposition &o = static_cast<const lu_decomposition &>(other);
+
+	if (row != o.row)
+		return row < o.row ? -1 : 1;
+	if (col != o.col)
+		return col < o.col ? -1 : 1;
+	if (algo != o.algo)
+		return algo < o.algo ? -1 : 1;
+	if (perm != o.perm)
+		return perm < o.perm ? -1 : 1;
+	if (pivot_cols != o.pivot_cols)
+		return pivot_cols < o.pivot_cols ? -1 : 1;
+	for (unsigned i=0; i<u.size(); ++i) {
+		int cmpval = u[i].compare(o.u[i]);
+		if (cmpval)
+			return cmpval;
+	}
+	for (unsigned i=0; i<l.size(); ++i) {
+		int cmpval = l[i].compare(o.l[i]);
+		if (cmpval)
+			return cmpval;
+	}
+	return 0;
+}
+
+void lu_decomposition::do_print(const print_context & c, unsigned level) const
+{
+	c.s << class_name() << '(' << row << 'x' << col << ", rank " << rank() << ')';
+}
+
+//////////
+// non-virtual functions in this class
+//////////
+
+/** Solve the linear system A*X == rhs with the decomposed matrix A.  The
+ *  result is the same as that of A.solve(vars, rhs), in particular free
+ *  parameters of underdetermined systems are taken from vars.
+ *
+ *  @param vars  n x p matrix, all elements must be symbols
+ *  @param rhs   m x p matrix
+ *  @return n x p solution matrix
+ *  @exception logic_error (incompatible matrices)
+ *  @exception invalid_argument (1st argument must be matrix of symbols)
+ *  @exception runtime_error (inconsistent linear system)
+ *  @see       matrix::solve() */
+matrix lu_decomposition::solve(const matrix & vars, const matrix & rhs) const
+{
+	const unsigned p = rhs.cols();
+	if ((rhs.rows() != row) || (vars.rows() != col) || (vars.cols() != p))
+		throw (std::logic_error("lu_decomposition::solve(): incompatible matrices"));
+	for (unsigned ro=0; ro<col; ++ro)
+		for (unsigned co=0; co<p; ++co)
+			if (!vars(ro,co).info(info_flags::symbol))
+				throw (std::invalid_argument("lu_decomposition::solve(): 1st argument must be matrix of symbols"));
+
+	// Polynomial systems eliminated by Bareiss' algorithm are solved without
+	// fractions: all divisions in the row operations are exact and the
+	// back substitution computes D*x, with D the last pivot, which is again
+	// a polynomial by Cramer's rule.  Only the final quotients are
+	// normalized.
+	bool polynomial_flag = (algo == solve_algo::bareiss);
+	for (exvector::const_iterator i = u.begin(); i != u.end() && polynomial_flag; ++i)
+		if (!i->info(info_flags::rational_polynomial))
+			polynomial_flag = false;
+	for (unsigned r=0; r<row && polynomial_flag; ++r)
+		for (unsigned co=0; co<p && polynomial_flag; ++co)
+			if (!rhs(r,co).info(info_flags::rational_polynomial))
+				polynomial_flag = false;
+
+	const unsigned rk = rank();
+	matrix sol(col,p);
+	exvector b(row), y(col);
+	for (unsigned co=0; co<p; ++co) {
+		for (unsigned r=0; r<row; ++r)
+			b[r] = polynomial_flag ? rhs(perm[r],co).expand() : rhs(perm[r],co);
+
+		// apply the row operations of the elimination
+		ex divisor = _ex1;
+		for (unsigned k=0; k<rk; ++k) {
+			const ex & pivot = u[k*col+pivot_cols[k]];
+			for (unsigned r=k+1; r<row; ++r) {
+				const ex & f = l[r*row+k];
+				ex & e = b[r];
+				if (algo == solve_algo::gauss) {
+					if (f.is_zero() || b[k].is_zero())
+						continue;
+					e -= f*b[k];
+				} else if (polynomial_flag) {
+					ex q;
+					if (!divide((pivot*e - f*b[k]).expand(), divisor, q, false))
+						throw (std::logic_error("lu_decomposition::solve(): inexact division"));
+					e = q;
+					continue;
+				} else
+					e = (pivot*e - f*b[k])/divisor;
+				if (!e.info(info_flags::numeric))
+					e = e.normal();
+			}
+			divisor = pivot;
+		}
+
+		// rows of zeros must have a vanishing right hand side
+		for (unsigned r=rk; r<row; ++r)
+			if (!b[r].is_zero())
+				throw (std::runtime_error("lu_decomposition::solve(): inconsistent linear system"));
+
+		// fraction-free back substitution
+		bool done = false;
+		if (polynomial_flag && rk > 0) {
+			const ex & D = u[(rk-1)*col+pivot_cols[rk-1]];
+			std::vector<bool> is_pivot(col, false);
+			for (unsigned k=0; k<rk; ++k)
+				is_pivot[pivot_cols[k]] = true;
+			for (unsigned c=0; c<col; ++c)
+				if (!is_pivot[c])
+					y[c] = D*vars(c,co);
+			done = true;
+			for (int k=int(rk)-1; k>=0 && done; --k) {
+				const unsigned c0 = pivot_cols[k];
+				ex e = D*b[k];
+				for (unsigned c=c0+1; c<col; ++c)
+					if (!u[k*col+c].is_zero())
+						e -= u[k*col+c]*y[c];
+				done = divide(e.expand(), u[k*col+c0], y[c0], false);
+			}
+			if (done)
+				for (unsigned c=0; c<col; ++c)
+					sol(c,co) = is_pivot[c] ? (y[c]/D).normal() : vars(c,co);
+		}
+		if (done)
+			continue;
+
+		// back substitution, unknowns without pivot are free parameters
+		unsigned next_pivot = col;
+		for (int k=int(rk)-1; k>=-1; --k) {
+			const unsigned c0 = k>=0 ? pivot_cols[k] : 0;
+			for (unsigned c=(k>=0 ? c0+1 : 0); c<next_pivot; ++c)
+				sol(c,co) = vars(c,co);
+			if (k < 0)
+				break;
+			ex e = b[k];
+			for (unsigned c=c0+1; c<col; ++c)
+				if (!u[k*col+c].is_zero())
+					e -= u[k*col+c]*sol(c,co);
+			sol(c0,co) = (e/u[k*col+c0]).normal();
+			next_pivot = c0;
+		}
+	}
+	return sol;
+}
+
+} // namespace GiNaC
@@ -0,0 +1,93 @@
+/** @file lu_decomposition.h
+ *
+ *  Interface to the triangular decomposition of matrices. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_LU_DECOMPOSITION_H
+#define GINAC_LU_DECOMPOSITION_H
+
+#include "basic.h"
+#include "ex.h"
+#include "archive.h"
+#include "flags.h"
+
+#include <vector>
+
+namespace GiNaC {
+
+class matrix;
+
+/** Triangular decomposition P*A = L*U of a matrix A, for solving linear
+ *  systems with the same coefficient matrix and many different right hand
+ *  sides.  The elimination is done only once when the object is
+ *  constructed, every call of solve() then just applies the recorded row
+ *  operations to the right hand side and substitutes back, which goes as
+ *  n^2 instead of n^3.  Like other GiNaC objects it can be archived. */
+class lu_decomposition : public basic
+{
+	GINAC_DECLARE_REGISTERED_CLASS(lu_decomposition, basic)
+
+	// other constructors
+public:
+	lu_decomposition(const matrix & a, unsigned algo = solve_algo::automatic);
+
+	// functions overriding virtual functions from base classes
+public:
+	/** Save (a.k.a. serialize) object into archive. */
+	void archive(archive_node& n) const;
+	/** Read (a.k.a. deserialize) object from archive. */
+	void read_archive(const archive_node& n, lst& syms);
+
+	// non-virtual functions in this class
+public:
+	unsigned rows() const        /// Get number of rows.
+		{ return row; }
+	unsigned cols() const        /// Get number of columns.
+		{ return col; }
+	unsigned rank() const        /// Get rank of the matrix.
+		{ return pivot_cols.size(); }
+	unsigned get_algo() const    /// Get the elimination algorithm used.
+		{ return algo; }
+	matrix solve(const matrix & vars, const matrix & rhs) const;
+protected:
+	void do_print(const print_context & c, unsigned level) const;
+
+	// member variables
+private:
+	unsigned row;             ///< number of rows
+	unsigned col;             ///< number of columns
+	unsigned algo;            ///< solve_algo::gauss or solve_algo::bareiss
+	/** Echelon form U, row*col elements. */
+	exvector u;
+	/** Row operations of the elimination, row*row elements.  In step k
+	 *  row r>k is replaced by row r - l(r,k)*row k for Gauss elimination
+	 *  and by (u(k,c_k)*row r - l(r,k)*row k)/u(k-1,c_{k-1}) for Bareiss
+	 *  elimination. */
+	exvector l;
+	/** Row r of U stems from row perm[r] of the original matrix. */
+	std::vector<unsigned> perm;
+	/** Column of the pivot in every non-zero row of U. */
+	std::vector<unsigned> pivot_cols;
+};
+GINAC_DECLARE_UNARCHIVER(lu_decomposition);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_LU_DECOMPOSITION_H
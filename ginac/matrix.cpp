@@ -32,8 +32,15 @@
 #include "normal.h"
 #include "archive.h"
 #include "utils.h"
+#include "polynomial/chinrem_determinant.h"
+#include "polynomial/chinrem_charpoly.h"
+#include "polynomial/padic_solve.h"
+#include "sparse_matrix.h"
+#include "float_matrix.h"
 
 #include <algorithm>
+#include <ctime>
+#include <exception>
 #include <iostream>
 #include <map>
 #include <sstream>
@@ -596,14 +603,39 @@ matrix matrix::mul(const matrix & other) const
 		throw std::logic_error("matrix::mul(): incompatible matrices");
 	
 	exvector prod(this->rows()*other.cols());
-	
+
+	// The terms of a whole row of the product are collected first, running
+	// along the rows of both factors, and every entry is then built as one
+	// sum instead of by repeated addition.  Numeric terms are summed up
+	// right away.
+	std::vector<exvector> terms(other.cols());
+	std::vector<numeric> nums(other.cols());
 	for (unsigned r1=0; r1<this->rows(); ++r1) {
 		for (unsigned c=0; c<this->cols(); ++c) {
 			// Quick test: can we shortcut?
-			if (m[r1*col+c].is_zero())
+			const ex & a = m[r1*col+c];
+			if (a.is_zero())
 				continue;
-			for (unsigned r2=0; r2<other.cols(); ++r2)
-				prod[r1*other.col+r2] += (m[r1*col+c] * other.m[c*other.col+r2]);
+			const bool a_numeric = is_exactly_a<numeric>(a);
+			for (unsigned r2=0; r2<other.cols(); ++r2) {
+				const ex & b = other.m[c*other.col+r2];
+				if (b.is_zero())
+					continue;
+				if (a_numeric && is_exactly_a<numeric>(b))
+					nums[r2] += ex_to<numeric>(a).mul(ex_to<numeric>(b));
+				else
+					terms[r2].push_back(a * b);
+			}
+		}
+		for (unsigned r2=0; r2<other.cols(); ++r2) {
+			if (terms[r2].empty()) {
+				prod[r1*other.col+r2] = nums[r2];
+			} else {
+				terms[r2].push_back(nums[r2]);
+				prod[r1*other.col+r2] = (new GiNaC::add(terms[r2]))->setflag(status_flags::dynallocated);
+				terms[r2].clear();
+			}
+			nums[r2] = *_num0_p;
 		}
 	}
 	return matrix(row, other.col, prod);
@@ -724,6 +756,116 @@ matrix matrix::transpose() const
 	return matrix(this->cols(),this->rows(),trans);
 }
 
+static matrix_algo_callback algo_callback = 0;
+
+matrix_algo_callback set_matrix_algo_callback(matrix_algo_callback callback)
+{
+	const matrix_algo_callback previous = algo_callback;
+	algo_callback = callback;
+	return previous;
+}
+
+/** Reports a call of determinant() or solve() to the algo_callback, if
+ *  there is one, when it goes out of scope.  Calls ending with an exception
+ *  are not reported. */
+class algo_report {
+public:
+	algo_report(bool solve, const exvector & m, unsigned rows, unsigned cols, unsigned requested)
+	  : active(algo_callback != 0), start(0)
+	{
+		rec.solve = solve;
+		rec.requested = rec.algo = requested;
+		rec.rows = rows;
+		rec.cols = cols;
+		rec.nonzero = rec.terms = 0;
+		rec.numeric = true;
+		rec.quotients = false;
+		rec.seconds = 0;
+		if (!active)
+			return;
+		for (exvector::const_iterator r = m.begin(); r != m.end(); ++r) {
+			if (r->is_zero())
+				continue;
+			++rec.nonzero;
+			rec.terms += is_exactly_a<add>(*r) ? r->nops() : 1;
+			if (!r->info(info_flags::numeric))
+				rec.numeric = false;
+			exmap srl;  // symbol replacement list
+			const ex rtest = r->to_rational(srl);
+			if (!rtest.info(info_flags::crational_polynomial) &&
+			     rtest.info(info_flags::rational_function))
+				rec.quotients = true;
+		}
+		start = std::clock();
+	}
+	~algo_report()
+	{
+		if (!active || std::uncaught_exception())
+			return;
+		rec.seconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+		algo_callback(rec);
+	}
+	void selected(unsigned algo) { rec.algo = algo; }
+private:
+	const bool active;
+	std::clock_t start;
+	matrix_algo_record rec;
+};
+
+
+/** Estimate the work of minor expansion by determinant_minor(), without
+ *  doing any arithmetic.  Only the zero pattern of the matrix is followed
+ *  through the expansion, with the columns sorted as in determinant().
+ *
+ *  @param m  entries of the n x n matrix in row-major order
+ *  @param limit  the counting stops as soon as this is exceeded
+ *  @return number of products of an element with a minor, or limit+1 if
+ *  there are more than limit of them */
+static std::size_t laplace_products(const exvector & m, unsigned n, std::size_t limit)
+{
+	// sets of rows are represented as bit masks
+	typedef unsigned long long row_set;
+	if (n > 8*sizeof(row_set))
+		return limit+1;
+
+	std::vector<std::pair<unsigned,unsigned> > c_zeros;
+	for (unsigned c=0; c<n; ++c) {
+		unsigned acc = 0;
+		for (unsigned r=0; r<n; ++r)
+			if (m[r*n+c].is_zero())
+				++acc;
+		c_zeros.push_back(std::make_pair(acc, c));
+	}
+	std::sort(c_zeros.begin(), c_zeros.end());
+
+	std::vector<row_set> minors, next;
+	unsigned c = c_zeros[n-1].second;
+	for (unsigned r=0; r<n; ++r)
+		if (!m[r*n+c].is_zero())
+			minors.push_back(row_set(1) << r);
+	std::size_t products = 0;
+	for (int k=n-2; k>=0 && !minors.empty(); --k) {
+		c = c_zeros[k].second;
+		next.clear();
+		for (unsigned r=0; r<n; ++r) {
+			if (m[r*n+c].is_zero())
+				continue;
+			for (std::vector<row_set>::const_iterator i=minors.begin(); i!=minors.end(); ++i) {
+				if (*i & (row_set(1) << r))
+					continue;
+				next.push_back(*i | (row_set(1) << r));
+				if (++products > limit)
+					return products;
+			}
+		}
+		std::sort(next.begin(), next.end());
+		next.erase(std::unique(next.begin(), next.end()), next.end());
+		minors.swap(next);
+	}
+	return products;
+}
+
+
 /** Determinant of square matrix.  This routine doesn't actually calculate the
  *  determinant, it only implements some heuristics about which algorithm to
  *  run.  If all the elements of the matrix are elements of an integral domain
@@ -743,38 +885,65 @@ ex matrix::determinant(unsigned algo) const
 	if (row!=col)
 		throw (std::logic_error("matrix::determinant(): matrix not square"));
 	GINAC_ASSERT(row*col==m.capacity());
+	algo_report report(false, m, row, col, algo);
 	
 	// Gather some statistical information about this matrix:
 	bool numeric_flag = true;
 	bool normal_flag = false;
-	unsigned sparse_count = 0;  // counts non-zero elements
+	bool polynomial_flag = true;
 	exvector::const_iterator r = m.begin(), rend = m.end();
 	while (r != rend) {
 		if (!r->info(info_flags::numeric))
 			numeric_flag = false;
 		exmap srl;  // symbol replacement list
 		ex rtest = r->to_rational(srl);
-		if (!rtest.is_zero())
-			++sparse_count;
 		if (!rtest.info(info_flags::crational_polynomial) &&
 			 rtest.info(info_flags::rational_function))
 			normal_flag = true;
+		if (polynomial_flag && !r->info(info_flags::rational_polynomial))
+			polynomial_flag = false;
 		++r;
 	}
 	
 	// Here is the heuristics in case this routine has to decide:
+	// Minor expansion is generally a good guess.  It never touches
+	// vanishing minors, so how sparse a matrix has to be for it is best
+	// told by following the zero pattern through the expansion.  Timings
+	// (see check/time_matrix_algorithms.cpp) show that Bareiss
+	// elimination takes over when there are more than about 3*row^3
+	// products of elements and minors, three times the number of steps
+	// of the elimination.  Quotients of polynomials are an exception since
+	// the divisions of Bareiss' algorithm need expensive normalizations,
+	// and so are entries in row or more variables since the minors which
+	// are divided then have too many terms.
+	unsigned fallback_algo = determinant_algo::laplace;
+	if (row>3 && !normal_flag && !numeric_flag) {
+		exmap srl;  // common symbol replacement list
+		exset syms;
+		for (r = m.begin(); r != rend && syms.size() < row; ++r)
+			collect_entry_symbols(r->to_rational(srl), syms);
+		const std::size_t laplace_limit = 3*std::size_t(row)*row*row;
+		if (syms.size() < row &&
+		    laplace_products(m, row, laplace_limit) > laplace_limit)
+			fallback_algo = determinant_algo::bareiss;
+	}
+	// Purely numeric matrix can be handled by Gauss elimination.
+	// This overrides any prior decisions.
+	if (numeric_flag)
+		fallback_algo = determinant_algo::gauss;
+	// Polynomial matrices in few variables are best done modulo primes,
+	// whether they are dense or sparse.  With many variables (e.g. a
+	// generic symbolic matrix) the interpolation grid gets large and we
+	// fall back to the other methods.
+	std::size_t modular_max_points = chinrem_determinant_max_points;
 	if (algo == determinant_algo::automatic) {
-		// Minor expansion is generally a good guess:
-		algo = determinant_algo::laplace;
-		// Does anybody know when a matrix is really sparse?
-		// Maybe <~row/2.236 nonzero elements average in a row?
-		if (row>3 && 5*sparse_count<=row*col)
-			algo = determinant_algo::bareiss;
-		// Purely numeric matrix can be handled by Gauss elimination.
-		// This overrides any prior decisions.
-		if (numeric_flag)
-			algo = determinant_algo::gauss;
+		algo = fallback_algo;
+		if (polynomial_flag && !numeric_flag && row>3) {
+			algo = determinant_algo::modular;
+			modular_max_points = 4096;
+		}
 	}
+	report.selected(algo);
 	
 	// Trap the trivial case here, since some algorithms don't like it
 	if (this->row==1) {
@@ -787,7 +956,23 @@ ex matrix::determinant(unsigned algo) const
 
 	// Compute the determinant
 	switch(algo) {
+		case determinant_algo::modular: {
+			if (polynomial_flag) {
+				try {
+					return chinrem_determinant(m, row, modular_max_points);
+				} catch (const chinrem_determinant_failed &) {
+					// grid too large
+				}
+			}
+			return determinant(fallback_algo);
+		}
 		case determinant_algo::gauss: {
+			// Floating point matrices of low precision are decomposed
+			// in hardware floating point:
+			std::vector<double> a;
+			bool inexact = false;
+			if (numeric_flag && to_doubles(m, a, inexact) && inexact)
+				return float_lu(a, row).determinant();
 			ex det = 1;
 			matrix tmp(*this);
 			int sign = tmp.gauss_elimination(true);
@@ -887,6 +1072,143 @@ ex matrix::trace() const
 }
 
 
+/** Characteristic polynomial of a numeric matrix, coefficients of
+ *  det(lambda*1 - M) in increasing powers of lambda.  The matrix is first
+ *  brought into upper Hessenberg form by a similarity transformation and
+ *  the polynomial is then read off by the usual recurrence over the leading
+ *  principal submatrices.  This goes as n^3 and never involves lambda.
+ *
+ *  @param H  entries of the matrix in row-major order, overwritten
+ *  @param n  dimension of the matrix */
+static std::vector<numeric> charpoly_hessenberg(std::vector<numeric> & H, unsigned n)
+{
+	// Exact entries are pivoted on the first non-zero element so as to
+	// keep the zero pattern, floating point ones on the largest element.
+	bool exact = true;
+	for (std::vector<numeric>::const_iterator i = H.begin(); i != H.end(); ++i)
+		if (!i->is_crational()) {
+			exact = false;
+			break;
+		}
+
+	for (unsigned c=0; c+2<n; ++c) {
+		unsigned p = c+1;
+		for (unsigned r=c+1; r<n; ++r) {
+			if (H[r*n+c].is_zero())
+				continue;
+			if (H[p*n+c].is_zero()) {
+				p = r;
+				if (exact)
+					break;
+			} else if (!exact && abs(H[r*n+c]) > abs(H[p*n+c]))
+				p = r;
+		}
+		if (H[p*n+c].is_zero())
+			continue;
+		if (p != c+1) {
+			for (unsigned j=0; j<n; ++j)
+				std::swap(H[p*n+j], H[(c+1)*n+j]);
+			for (unsigned i=0; i<n; ++i)
+				std::swap(H[i*n+p], H[i*n+c+1]);
+		}
+		const numeric piv = H[(c+1)*n+c];
+		for (unsigned r=c+2; r<n; ++r) {
+			if (H[r*n+c].is_zero())
+				continue;
+			const numeric u = H[r*n+c] / piv;
+			for (unsigned j=c; j<n; ++j)
+				if (!H[(c+1)*n+j].is_zero())
+					H[r*n+j] -= u*H[(c+1)*n+j];
+			for (unsigned i=0; i<n; ++i)
+				if (!H[i*n+r].is_zero())
+					H[i*n+c+1] += u*H[i*n+r];
+		}
+	}
+
+	// p[k] holds the characteristic polynomial of the leading k x k
+	// submatrix, coefficients in increasing powers of lambda.
+	std::vector<std::vector<numeric> > p(n+1);
+	p[0].push_back(*_num1_p);
+	for (unsigned k=1; k<=n; ++k) {
+		std::vector<numeric> & pk = p[k];
+		const std::vector<numeric> & pk1 = p[k-1];
+		pk.resize(k+1);
+		for (unsigned j=0; j<k; ++j) {
+			pk[j+1] += pk1[j];
+			pk[j] -= H[(k-1)*n+k-1]*pk1[j];
+		}
+		numeric t = *_num1_p;
+		for (unsigned i=1; i<k; ++i) {
+			t *= H[(k-i)*n+k-i-1];
+			if (t.is_zero())
+				break;
+			const numeric h = H[(k-i-1)*n+k-1]*t;
+			if (h.is_zero())
+				continue;
+			const std::vector<numeric> & pki = p[k-i-1];
+			for (unsigned j=0; j<pki.size(); ++j)
+				pk[j] -= h*pki[j];
+		}
+	}
+	return p[n];
+}
+
+
+/** Characteristic polynomial by Berkowitz' division-free algorithm,
+ *  coefficients of det(lambda*1 - M) in decreasing powers of lambda.  The
+ *  polynomial of every leading principal submatrix is obtained from the
+ *  previous one by multiplication with a Toeplitz matrix built from the new
+ *  row and column.  Only ring operations are used, so entries stay
+ *  polynomial, and the work goes as n^4.
+ *
+ *  @param M  entries of the matrix in row-major order
+ *  @param n  dimension of the matrix */
+static exvector charpoly_berkowitz(const exvector & M, unsigned n)
+{
+	exvector v(1, _ex1);
+	for (unsigned k=0; k<n; ++k) {
+		// First column of the Toeplitz matrix: 1, -a, -R*C, -R*A*C, ...
+		// where A is the leading k x k submatrix, R and C the new row and
+		// column below and to the right of it and a the new diagonal entry.
+		exvector q(k+2);
+		q[0] = _ex1;
+		q[1] = (-M[k*n+k]).expand();
+		exvector C(k);
+		for (unsigned i=0; i<k; ++i)
+			C[i] = M[i*n+k];
+		for (unsigned j=2; j<k+2; ++j) {
+			exvector s;
+			s.reserve(k);
+			for (unsigned i=0; i<k; ++i)
+				if (!C[i].is_zero() && !M[k*n+i].is_zero())
+					s.push_back(M[k*n+i]*C[i]);
+			q[j] = (-(new GiNaC::add(s))->setflag(status_flags::dynallocated)).expand();
+			if (j == k+1)
+				break;
+			exvector AC(k);
+			for (unsigned i=0; i<k; ++i) {
+				s.clear();
+				for (unsigned l=0; l<k; ++l)
+					if (!C[l].is_zero() && !M[i*n+l].is_zero())
+						s.push_back(M[i*n+l]*C[l]);
+				AC[i] = (new GiNaC::add(s))->setflag(status_flags::dynallocated).expand();
+			}
+			C.swap(AC);
+		}
+		exvector w(k+2);
+		for (unsigned i=0; i<k+2; ++i) {
+			exvector s;
+			for (unsigned j=0; j<=k && j<=i; ++j)
+				if (!q[i-j].is_zero() && !v[j].is_zero())
+					s.push_back(q[i-j]*v[j]);
+			w[i] = (new GiNaC::add(s))->setflag(status_flags::dynallocated).expand();
+		}
+		v.swap(w);
+	}
+	return v;
+}
+
+
 /** Characteristic Polynomial.  Following mathematica notation the
  *  characteristic polynomial of a matrix M is defined as the determiant of
  *  (M - lambda * 1) where 1 stands for the unit matrix of the same dimension
@@ -904,32 +1226,68 @@ ex matrix::charpoly(const ex & lambda) const
 		throw (std::logic_error("matrix::charpoly(): matrix not square"));
 	
 	bool numeric_flag = true;
+	bool rational_flag = true;
+	bool normal_flag = false;
+	bool polynomial_flag = true;
+	unsigned sparse_count = 0;  // counts non-zero elements
 	exvector::const_iterator r = m.begin(), rend = m.end();
-	while (r!=rend && numeric_flag==true) {
+	while (r != rend) {
 		if (!r->info(info_flags::numeric))
 			numeric_flag = false;
+		if (!r->info(info_flags::rational))
+			rational_flag = false;
+		exmap srl;  // symbol replacement list
+		ex rtest = r->to_rational(srl);
+		if (!rtest.is_zero())
+			++sparse_count;
+		if (!rtest.info(info_flags::crational_polynomial) &&
+			 rtest.info(info_flags::rational_function))
+			normal_flag = true;
+		if (polynomial_flag && !r->info(info_flags::rational_polynomial))
+			polynomial_flag = false;
 		++r;
 	}
 	
 	// The pure numeric case is traditionally rather common.  Hence, it is
-	// trapped and we use Leverrier's algorithm which goes as row^3 for
-	// every coefficient.  The expensive part is the matrix multiplication.
+	// trapped and we reduce the matrix to Hessenberg form which goes as
+	// row^3 altogether.  Rational matrices are reduced modulo primes since
+	// the entries of the Hessenberg form tend to grow badly.
 	if (numeric_flag) {
 
-		matrix B(*this);
-		ex c = B.trace();
-		ex poly = power(lambda, row) - c*power(lambda, row-1);
-		for (unsigned i=1; i<row; ++i) {
-			for (unsigned j=0; j<row; ++j)
-				B.m[j*col+j] -= c;
-			B = this->mul(B);
-			c = B.trace() / ex(i+1);
-			poly -= c*power(lambda, row-i-1);
+		std::vector<numeric> c;
+		if (rational_flag)
+			c = chinrem_charpoly(m, row);
+		else {
+			std::vector<double> a;
+			bool inexact = false;
+			if (!to_doubles(m, a, inexact) || !charpoly_float(a, row, c)) {
+				std::vector<numeric> H;
+				H.reserve(m.size());
+				for (r = m.begin(); r != rend; ++r)
+					H.push_back(ex_to<numeric>(*r));
+				c = charpoly_hessenberg(H, row);
+			}
 		}
-		if (row%2)
-			return -poly;
-		else
-			return poly;
+		exvector terms;
+		terms.reserve(row+1);
+		for (unsigned k=0; k<=row; ++k)
+			if (!c[k].is_zero())
+				terms.push_back((row%2 ? -c[k] : c[k])*power(lambda, k));
+		return (new GiNaC::add(terms))->setflag(status_flags::dynallocated);
+
+	} else if (!normal_flag && !polynomial_flag && 5*sparse_count>row*col) {
+
+		// Polynomials with rational coefficients are best left to the
+		// modular determinant and sparse matrices to Bareiss elimination.
+		// Other dense matrices without denominators are handled by
+		// Berkowitz' algorithm which does not need any divisions at all.
+		exvector c = charpoly_berkowitz(m, row);
+		exvector terms;
+		terms.reserve(row+1);
+		for (unsigned k=0; k<=row; ++k)
+			if (!c[k].is_zero())
+				terms.push_back(row%2 ? -c[k]*power(lambda, row-k) : c[k]*power(lambda, row-k));
+		return ex((new GiNaC::add(terms))->setflag(status_flags::dynallocated)).expand().collect(lambda);
 
 	} else {
 	
@@ -981,6 +1339,88 @@ matrix matrix::inverse() const
 }
 
 
+/** Solve the square linear system a*x == rhs block by block, using the block
+ *  triangular form of a.  Every block is solved with the unknowns from
+ *  earlier blocks as additional right hand sides, which keeps the entries
+ *  polynomial if those of a and rhs are.  Then the already known values of
+ *  these unknowns are inserted.
+ *
+ *  @param sol solution of the system (returned)
+ *  @return false if a does not decompose into several blocks or if a block
+ *  does not have a unique solution.  The whole system has to be eliminated
+ *  in this case. */
+static bool solve_block_triangular(const matrix & a, const matrix & vars,
+                                   const matrix & rhs, matrix & sol)
+{
+	const unsigned n = a.rows();
+	const unsigned p = rhs.cols();
+	std::vector<matrix_block> blocks;
+	if (!block_triangular_form(a, blocks) || blocks.size() < 2)
+		return false;
+
+	sol = matrix(n, p);
+	std::vector<unsigned> col_block(n);
+	for (unsigned b=0; b<blocks.size(); ++b)
+		for (unsigned i=0; i<blocks[b].cols.size(); ++i)
+			col_block[blocks[b].cols[i]] = b;
+
+	for (unsigned b=0; b<blocks.size(); ++b) {
+		const std::vector<unsigned> & rows = blocks[b].rows;
+		const std::vector<unsigned> & cols = blocks[b].cols;
+		const unsigned k = rows.size();
+
+		// unknowns from earlier blocks which appear in this one
+		std::vector<unsigned> known;
+		for (unsigned i=0; i<k; ++i)
+			for (unsigned c=0; c<n; ++c)
+				if (col_block[c] < b && !a(rows[i], c).is_zero())
+					known.push_back(c);
+		std::sort(known.begin(), known.end());
+		known.erase(std::unique(known.begin(), known.end()), known.end());
+
+		const unsigned q = p + known.size();
+		matrix ba(k, k), bvars(k, q), brhs(k, q), bsol;
+		for (unsigned i=0; i<k; ++i) {
+			for (unsigned j=0; j<k; ++j)
+				ba(i, j) = a(rows[i], cols[j]);
+			for (unsigned co=0; co<q; ++co)
+				bvars(i, co) = vars(cols[i], co<p ? co : 0);
+			for (unsigned co=0; co<p; ++co)
+				brhs(i, co) = rhs(rows[i], co);
+			for (unsigned j=0; j<known.size(); ++j)
+				brhs(i, p+j) = -a(rows[i], known[j]);
+		}
+		if (k == 1) {
+			if (ba(0, 0).normal().is_zero())
+				return false;
+			bsol = brhs.mul_scalar(power(ba(0, 0), _ex_1));
+		} else {
+			try {
+				bsol = ba.solve(bvars, brhs);
+			} catch (const std::runtime_error &) {
+				return false;
+			}
+			// a free parameter means the block is singular
+			for (unsigned i=0; i<k; ++i)
+				for (unsigned co=0; co<q; ++co)
+					if (bsol(i, co).is_equal(bvars(i, co)))
+						return false;
+		}
+
+		for (unsigned i=0; i<k; ++i) {
+			for (unsigned co=0; co<p; ++co) {
+				exvector terms;
+				terms.push_back(bsol(i, co));
+				for (unsigned j=0; j<known.size(); ++j)
+					terms.push_back(bsol(i, p+j) * sol(known[j], co));
+				sol(cols[i], co) = ex((new add(terms))->setflag(status_flags::dynallocated)).normal();
+			}
+		}
+	}
+	return true;
+}
+
+
 /** Solve a linear system consisting of a m x n matrix and a m x p right hand
  *  side by applying an elimination scheme to the augmented matrix.
  *
@@ -1007,23 +1447,56 @@ matrix matrix::solve(const matrix & vars,
 		for (unsigned co=0; co<p; ++co)
 			if (!vars(ro,co).info(info_flags::symbol))
 				throw (std::invalid_argument("matrix::solve(): 1st argument must be matrix of symbols"));
+	algo_report report(true, this->m, m, n, algo);
 	
-	// build the augmented matrix of *this with rhs attached to the right
-	matrix aug(m,n+p);
-	for (unsigned r=0; r<m; ++r) {
-		for (unsigned c=0; c<n; ++c)
-			aug.m[r*(n+p)+c] = this->m[r*n+c];
-		for (unsigned c=0; c<p; ++c)
-			aug.m[r*(n+p)+c+n] = rhs.m[r*p+c];
+	// Square floating point systems of low precision are solved in
+	// hardware floating point, unless the matrix is singular:
+	if ((algo == solve_algo::automatic || algo == solve_algo::gauss) && m == n) {
+		std::vector<double> a, b;
+		bool inexact = false;
+		if (to_doubles(this->m, a, inexact) && to_doubles(rhs.m, b, inexact) && inexact) {
+			if (float_lu(a, n).solve(b, p)) {
+				report.selected(solve_algo::gauss);
+				exvector x;
+				x.reserve(b.size());
+				for (std::vector<double>::const_iterator i = b.begin(); i != b.end(); ++i)
+					x.push_back(numeric(*i));
+				return matrix(n, p, x);
+			}
+		}
+	}
+	
+	// Square systems which decompose into smaller subsystems are solved
+	// one subsystem after the other:
+	if (algo == solve_algo::automatic && m == n && m > 3) {
+		matrix sol;
+		if (solve_block_triangular(*this, vars, rhs, sol))
+			return sol;
 	}
 	
 	// Gather some statistical information about the augmented matrix:
 	bool numeric_flag = true;
-	exvector::const_iterator r = aug.m.begin(), rend = aug.m.end();
-	while (r!=rend && numeric_flag==true) {
+	bool normal_flag = false;
+	unsigned sparse_count = 0;  // counts non-zero elements
+	for (exvector::const_iterator r = this->m.begin(); r != this->m.end(); ++r) {
+		if (!r->is_zero())
+			++sparse_count;
+		if (numeric_flag && !r->info(info_flags::numeric))
+			numeric_flag = false;
+	}
+	for (exvector::const_iterator r = rhs.m.begin(); r != rhs.m.end() && numeric_flag; ++r)
 		if (!r->info(info_flags::numeric))
 			numeric_flag = false;
-		++r;
+	if (!numeric_flag && algo == solve_algo::automatic) {
+		for (exvector::const_iterator r = this->m.begin(); r != this->m.end(); ++r) {
+			exmap srl;  // symbol replacement list
+			ex rtest = r->to_rational(srl);
+			if (!rtest.info(info_flags::crational_polynomial) &&
+				 rtest.info(info_flags::rational_function)) {
+				normal_flag = true;
+				break;
+			}
+		}
 	}
 	
 	// Here is the heuristics in case this routine has to decide:
@@ -1037,6 +1510,39 @@ matrix matrix::solve(const matrix & vars,
 		// This overrides any prior decisions.
 		if (numeric_flag)
 			algo = solve_algo::gauss;
+		// Larger square numeric systems are lifted p-adically (this falls
+		// back to Gauss elimination if the entries are not rational):
+		if (numeric_flag && m == n && m>8)
+			algo = solve_algo::dixon;
+		// Large sparse systems are best eliminated without touching
+		// the zeros.
+		if (prefer_sparse_elimination(m, n, sparse_count, numeric_flag, normal_flag))
+			algo = solve_algo::markowitz;
+	}
+	report.selected(algo);
+	
+	if (algo == solve_algo::markowitz) {
+		sparse_matrix sparse(*this, rhs);
+		sparse.eliminate();
+		return sparse.solve(vars);
+	}
+	
+	if (algo == solve_algo::dixon) {
+		exvector x;
+		if (m == n && padic_solve(this->m, rhs.m, n, p, x))
+			return matrix(n, p, x);
+		// not applicable or singular, let Gauss elimination sort it out
+		algo = solve_algo::gauss;
+		report.selected(algo);
+	}
+	
+	// build the augmented matrix of *this with rhs attached to the right
+	matrix aug(m,n+p);
+	for (unsigned r=0; r<m; ++r) {
+		for (unsigned c=0; c<n; ++c)
+			aug.m[r*(n+p)+c] = this->m[r*n+c];
+		for (unsigned c=0; c<p; ++c)
+			aug.m[r*(n+p)+c+n] = rhs.m[r*p+c];
 	}
 	
 	// Eliminate the augmented matrix:
@@ -1166,70 +1672,69 @@ ex matrix::determinant_minor() const
 	// right to left.  At each column c we only need to retrieve the minors
 	// calculated in step c-1.  We therefore only have to store at most 
 	// 2*binomial(n,n/2) minors.
+	// Instead of computing every minor of column c from the minors of column
+	// c+1, each non-vanishing minor of column c+1 contributes to the minors
+	// of column c obtained by adding a row with a non-zero element in column
+	// c.  Vanishing minors and elements are thus never touched, which makes
+	// a big difference for sparse matrices.  The contributions are collected
+	// and summed up at once.
 	
-	// Unique flipper counter for partitioning into minors
-	std::vector<unsigned> Pkey;
-	Pkey.reserve(n);
-	// key for minor determinant (a subpartition of Pkey)
-	std::vector<unsigned> Mkey;
-	Mkey.reserve(n-1);
 	// we store our subminors in maps, keys being the rows they arise from
 	typedef std::map<std::vector<unsigned>,class ex> Rmap;
 	typedef std::map<std::vector<unsigned>,class ex>::value_type Rmap_value;
+	typedef std::map<std::vector<unsigned>,exvector> Tmap;
 	Rmap A;
 	Rmap B;
-	ex det;
+	Tmap terms;
+	std::vector<unsigned> Pkey;
+	Pkey.reserve(n);
 	// initialize A with last column:
 	for (unsigned r=0; r<n; ++r) {
-		Pkey.erase(Pkey.begin(),Pkey.end());
-		Pkey.push_back(r);
+		if (m[n*(r+1)-1].is_zero())
+			continue;
+		Pkey.assign(1, r);
 		A.insert(Rmap_value(Pkey,m[n*(r+1)-1]));
 	}
 	// proceed from right to left through matrix
-	for (int c=n-2; c>=0; --c) {
-		Pkey.erase(Pkey.begin(),Pkey.end());  // don't change capacity
-		Mkey.erase(Mkey.begin(),Mkey.end());
-		for (unsigned i=0; i<n-c; ++i)
-			Pkey.push_back(i);
-		unsigned fc = 0;  // controls logic for our strange flipper counter
-		do {
-			det = _ex0;
-			for (unsigned r=0; r<n-c; ++r) {
-				// maybe there is nothing to do?
-				if (m[Pkey[r]*n+c].is_zero())
+	std::vector<unsigned> nonzero_rows;
+	for (int c=n-2; c>=0 && !A.empty(); --c) {
+		nonzero_rows.clear();
+		for (unsigned r=0; r<n; ++r)
+			if (!m[r*n+c].is_zero())
+				nonzero_rows.push_back(r);
+		for (Rmap::const_iterator a=A.begin(); a!=A.end(); ++a) {
+			const std::vector<unsigned> & Mkey = a->first;
+			for (std::vector<unsigned>::const_iterator r=nonzero_rows.begin(); r!=nonzero_rows.end(); ++r) {
+				std::vector<unsigned>::const_iterator pos = std::lower_bound(Mkey.begin(), Mkey.end(), *r);
+				if (pos != Mkey.end() && *pos == *r)
 					continue;
-				// create the sorted key for all possible minors
-				Mkey.erase(Mkey.begin(),Mkey.end());
-				for (unsigned i=0; i<n-c; ++i)
-					if (i!=r)
-						Mkey.push_back(Pkey[i]);
-				// Fetch the minors and compute the new determinant
-				if (r%2)
-					det -= m[Pkey[r]*n+c]*A[Mkey];
+				// the position of the row in the sorted key gives the sign
+				Pkey.assign(Mkey.begin(), pos);
+				Pkey.push_back(*r);
+				Pkey.insert(Pkey.end(), pos, Mkey.end());
+				if ((pos-Mkey.begin())%2)
+					terms[Pkey].push_back(-m[*r*n+c]*a->second);
 				else
-					det += m[Pkey[r]*n+c]*A[Mkey];
+					terms[Pkey].push_back(m[*r*n+c]*a->second);
 			}
+		}
+		for (Tmap::iterator t=terms.begin(); t!=terms.end(); ++t) {
 			// prevent build-up of deep nesting of expressions saves time:
-			det = det.expand();
+			const ex det = ex((new GiNaC::add(t->second))->setflag(status_flags::dynallocated)).expand();
 			// store the new determinant at its place in B:
 			if (!det.is_zero())
-				B.insert(Rmap_value(Pkey,det));
-			// increment our strange flipper counter
-			for (fc=n-c; fc>0; --fc) {
-				++Pkey[fc-1];
-				if (Pkey[fc-1]<fc+c)
-					break;
-			}
-			if (fc<n-c && fc>0)
-				for (unsigned j=fc; j<n-c; ++j)
-					Pkey[j] = Pkey[j-1]+1;
-		} while(fc);
+				B.insert(B.end(), Rmap_value(t->first,det));
+		}
+		terms.clear();
 		// next column, so change the role of A and B:
 		A.swap(B);
 		B.clear();
 	}
 	
-	return det;
+	if (A.empty())
+		return _ex0;
+	GINAC_ASSERT(A.size()==1 && A.begin()->first.size()==n);
+	return A.begin()->second;
 }
 
 
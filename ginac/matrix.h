@@ -248,6 +248,33 @@ extern ex sub_matrix(const matrix&m, unsigned r, unsigned nr, unsigned c, unsign
 inline ex symbolic_matrix(unsigned r, unsigned c, const std::string & base_name)
 { return symbolic_matrix(r, c, base_name, base_name); }
 
+/** What matrix::determinant() and matrix::solve() report to a
+ *  matrix_algo_callback after every call. */
+struct matrix_algo_record {
+	bool solve;          ///< solve() if true, determinant() otherwise
+	unsigned requested;  ///< algorithm asked for by the caller
+	unsigned algo;       ///< algorithm run (determinant_algo or solve_algo)
+	unsigned rows;       ///< rows of the matrix
+	unsigned cols;       ///< columns of the matrix
+	unsigned nonzero;    ///< number of non-zero entries
+	unsigned terms;      ///< number of terms of all the entries together
+	bool numeric;        ///< all entries are numbers
+	bool quotients;      ///< some entries are quotients of polynomials
+	double seconds;      ///< processor time used
+};
+
+/** Function pointer to watch the automatic choice of the determinant and
+ *  solve algorithms, e.g. to check the crossovers on the local machine. */
+typedef void (* matrix_algo_callback)(const matrix_algo_record &);
+
+/** Install a callback that is informed about every determinant and every
+ *  solution of a linear system, 0 (the default) removes it.  Nested calls
+ *  (the fallback of a failed modular determinant, the blocks of a system
+ *  which decomposes) are reported on their own, a system solved block by
+ *  block as a whole with solve_algo::automatic.  Returns the previous
+ *  callback. */
+extern matrix_algo_callback set_matrix_algo_callback(matrix_algo_callback callback);
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_MATRIX_H
@@ -42,6 +42,9 @@
 #include "symbol.h"
 #include "utils.h"
 #include "polynomial/chinrem_gcd.h"
+#include "polynomial/chinrem_sqrfree.h"
+#include "polynomial/chinrem_resultant.h"
+#include "polynomial/normal_uvar.h"
 
 #include <algorithm>
 #include <map>
@@ -1815,11 +1818,37 @@ static exvector sqrfree_yun(const ex &a, const symbol &x)
 }
 
 
+/** Polynomials with at least this many terms in at least two variables are
+ *  decomposed by the modular algorithm if sqrfree_algo::automatic is given.
+ *  Yun's algorithm over the integers is faster up to about 1000 terms, both
+ *  take the same time at about 1700 terms, and the modular algorithm is
+ *  ahead at 3500 terms (see check/time_sqrfree_multivariate.cpp). */
+static const size_t sqrfree_modular_threshold = 2000;
+
+/** Decides whether sqrfree() uses the modular algorithm for a. */
+static bool sqrfree_use_modular(const ex &a, unsigned algo)
+{
+	switch (algo) {
+		case sqrfree_algo::yun:
+			return false;
+		case sqrfree_algo::modular:
+			return true;
+	}
+	if (!is_exactly_a<add>(a) || a.nops() < sqrfree_modular_threshold)
+		return false;
+	sym_desc_vec sdv;
+	get_symbol_stats(a, _ex0, sdv);
+	return sdv.size() >= 2;
+}
+
+
 /** Compute a square-free factorization of a multivariate polynomial in Q[X].
  *
- *  @param a  multivariate polynomial over Q[X]
- *  @param l  lst of variables to factor in, may be left empty for autodetection
- *  @return   a square-free factorization of \p a.
+ *  @param a     multivariate polynomial over Q[X]
+ *  @param l     lst of variables to factor in, may be left empty for
+ *               autodetection
+ *  @param algo  allows to choose the algorithm, see sqrfree_algo
+ *  @return      a square-free factorization of \p a.
  *
  * \note
  * A polynomial \f$p(X) \in C[X]\f$ is said <EM>square-free</EM>
@@ -1850,7 +1879,7 @@ static exvector sqrfree_yun(const ex &a, const symbol &x)
  * Observe also that the factors \f$p_i(X)\f$ need not be irreducible
  * polynomials.
  */
-ex sqrfree(const ex &a, const lst &l)
+ex sqrfree(const ex &a, const lst &l, unsigned algo)
 {
 	if (is_exactly_a<numeric>(a) ||     // algorithm does not trap a==0
 	    is_a<symbol>(a))        // shortcut
@@ -1882,7 +1911,16 @@ ex sqrfree(const ex &a, const lst &l)
 	const ex tmp = multiply_lcm(a,lcm);
 
 	// find the factors
-	exvector factors = sqrfree_yun(tmp, x);
+	exvector factors;
+	if (sqrfree_use_modular(tmp, algo)) {
+		try {
+			factors = chinrem_sqrfree_yun(tmp, x);
+		} catch (const chinrem_sqrfree_failed&) {
+			factors = sqrfree_yun(tmp, x);
+		}
+	} else {
+		factors = sqrfree_yun(tmp, x);
+	}
 
 	// construct the next list of symbols with the first element popped
 	lst newargs = args;
@@ -1892,7 +1930,7 @@ ex sqrfree(const ex &a, const lst &l)
 	if (newargs.nops()>0) {
 		exvector::iterator i = factors.begin();
 		while (i != factors.end()) {
-			*i = sqrfree(*i, newargs);
+			*i = sqrfree(*i, newargs, algo);
 			++i;
 		}
 	}
@@ -1908,7 +1946,7 @@ ex sqrfree(const ex &a, const lst &l)
 	// inserting what has been lost back into the result.  For completeness
 	// we'll also have to recurse down that factor in the remaining variables.
 	if (newargs.nops()>0)
-		result *= sqrfree(quo(tmp, result, x), newargs);
+		result *= sqrfree(quo(tmp, result, x), newargs, algo);
 	else
 		result *= quo(tmp, result, x);
 
@@ -2173,48 +2211,54 @@ ex add::normal(exmap & repl, exmap & rev_lookup, int level) const
 	else if (level == -max_recursion_level)
 		throw(std::runtime_error("max recursion level reached"));
 
-	// Normalize children and split each one into numerator and denominator
-	exvector nums, dens;
-	nums.reserve(seq.size()+1);
-	dens.reserve(seq.size()+1);
+	// Normalize children and split each one into numerator and denominator.
+	// Fractions with identical denominators are added trivially right away.
+	typedef std::map<ex, ex, ex_is_less> den_num_map;
+	den_num_map fracs;
 	epvector::const_iterator it = seq.begin(), itend = seq.end();
 	while (it != itend) {
 		ex n = ex_to<basic>(recombine_pair_to_ex(*it)).normal(repl, rev_lookup, level-1);
-		nums.push_back(n.op(0));
-		dens.push_back(n.op(1));
+		fracs[n.op(1)] += n.op(0);
 		it++;
 	}
 	ex n = ex_to<numeric>(overall_coeff).normal(repl, rev_lookup, level-1);
-	nums.push_back(n.op(0));
-	dens.push_back(n.op(1));
-	GINAC_ASSERT(nums.size() == dens.size());
+	fracs[n.op(1)] += n.op(0);
+
+	exvector nums, dens;
+	nums.reserve(fracs.size());
+	dens.reserve(fracs.size());
+	for (den_num_map::const_iterator i = fracs.begin(); i != fracs.end(); ++i) {
+		nums.push_back(i->second);
+		dens.push_back(i->first);
+	}
 
 	// Now, nums is a vector of all numerators and dens is a vector of
 	// all denominators
 //std::clog << "add::normal uses " << nums.size() << " summands:\n";
 
-	// Add fractions sequentially
-	exvector::const_iterator num_it = nums.begin(), num_itend = nums.end();
-	exvector::const_iterator den_it = dens.begin(), den_itend = dens.end();
-//std::clog << " num = " << *num_it << ", den = " << *den_it << std::endl;
-	ex num = *num_it++, den = *den_it++;
-	while (num_it != num_itend) {
-//std::clog << " num = " << *num_it << ", den = " << *den_it << std::endl;
-		ex next_num = *num_it++, next_den = *den_it++;
-
-		// Trivially add sequences of fractions with identical denominators
-		while ((den_it != den_itend) && next_den.is_equal(*den_it)) {
-			next_num += *num_it;
-			num_it++; den_it++;
+	// Add fractions pairwise in a balanced tree rather than sequentially,
+	// so that every denominator in a sum of many fractions is not merged
+	// into one ever growing common denominator (with ever larger GCDs)
+	while (nums.size() > 1) {
+		size_t j = 0;
+		for (size_t i = 0; i + 1 < nums.size(); i += 2, ++j) {
+//std::clog << " num = " << nums[i] << ", den = " << dens[i] << std::endl;
+			// Addition of two fractions, taking advantage of the fact that
+			// the heuristic GCD algorithm computes the cofactors at no extra cost
+			ex co_den1, co_den2;
+			ex g = gcd(dens[i], dens[i+1], &co_den1, &co_den2, false);
+			nums[j] = ((nums[i] * co_den2) + (nums[i+1] * co_den1)).expand();
+			dens[j] = dens[i] * co_den2;	// this is the lcm(den1, den2)
 		}
-
-		// Additiion of two fractions, taking advantage of the fact that
-		// the heuristic GCD algorithm computes the cofactors at no extra cost
-		ex co_den1, co_den2;
-		ex g = gcd(den, next_den, &co_den1, &co_den2, false);
-		num = ((num * co_den2) + (next_num * co_den1)).expand();
-		den *= co_den2;		// this is the lcm(den, next_den)
+		if (nums.size() % 2) {
+			nums[j] = nums.back();
+			dens[j] = dens.back();
+			++j;
+		}
+		nums.resize(j);
+		dens.resize(j);
 	}
+	const ex num = nums[0].expand(), den = dens[0];
 //std::clog << " common denominator = " << den << std::endl;
 
 	// Cancel common factors from num/den
@@ -2341,6 +2385,11 @@ ex pseries::normal(exmap & repl, exmap & rev_lookup, int level) const
  *  @return normalized expression */
 ex ex::normal(int level) const
 {
+	// Rational functions in one symbol are normalized on dense polynomials
+	ex num, den;
+	if (level == 0 && normal_uvar(num, den, *this))
+		return num / den;
+
 	exmap repl, rev_lookup;
 
 	ex e = bp->normal(repl, rev_lookup, level);
@@ -2362,6 +2411,10 @@ ex ex::normal(int level) const
  *  @return numerator */
 ex ex::numer() const
 {
+	ex num, den;
+	if (normal_uvar(num, den, *this))
+		return num;
+
 	exmap repl, rev_lookup;
 
 	ex e = bp->normal(repl, rev_lookup, 0);
@@ -2382,6 +2435,10 @@ ex ex::numer() const
  *  @return denominator */
 ex ex::denom() const
 {
+	ex num, den;
+	if (normal_uvar(num, den, *this))
+		return den;
+
 	exmap repl, rev_lookup;
 
 	ex e = bp->normal(repl, rev_lookup, 0);
@@ -2402,6 +2459,10 @@ ex ex::denom() const
  *  @return a list [numerator, denominator] */
 ex ex::numer_denom() const
 {
+	ex num, den;
+	if (normal_uvar(num, den, *this))
+		return (new lst(num, den))->setflag(status_flags::dynallocated);
+
 	exmap repl, rev_lookup;
 
 	ex e = bp->normal(repl, rev_lookup, 0);
@@ -2714,8 +2775,87 @@ ex collect_common_factors(const ex & e)
 }
 
 
+/** Resultants of polynomials of at most this total degree in the main
+ *  variable are computed by the subresultant PRS, larger ones by the
+ *  modular algorithm. */
+static const int resultant_modular_threshold = 3;
+
+/** Resultant of two polynomials a, b in Z[x, ...] of positive degree in x
+ *  by the subresultant PRS (H. Cohen, A Course in Computational Algebraic
+ *  Number Theory, Algorithm 3.3.7, without the content removal).
+ *
+ *  @param a  first expanded polynomial
+ *  @param b  second expanded polynomial
+ *  @param x  variable to eliminate
+ *  @return resultant of a and b with respect to x */
+static ex sr_resultant(const ex &a, const ex &b, const ex &x)
+{
+	ex c = a, d = b;
+	int cdeg = c.degree(x), ddeg = d.degree(x);
+	int sign = 1;
+	if (cdeg < ddeg) {
+		std::swap(c, d);
+		std::swap(cdeg, ddeg);
+		if (cdeg & ddeg & 1)
+			sign = -1;
+	}
+
+	ex g = _ex1, h = _ex1;
+	do {
+		const int delta = cdeg - ddeg;
+		if (cdeg & ddeg & 1)
+			sign = -sign;
+		const ex r = prem(c, d, x, false).expand();
+		if (r.is_zero())
+			return _ex0;
+		c = d;
+		cdeg = ddeg;
+		if (!divide(r, g * pow(h, delta), d, false))
+			throw(std::runtime_error("invalid expression in sr_resultant(), division failed"));
+		ddeg = d.degree(x);
+		g = c.lcoeff(x);
+		if (delta == 1)
+			h = g;
+		else if (delta)
+			divide(pow(g, delta).expand(), pow(h, delta-1).expand(), h, false);
+	} while (ddeg > 0);
+
+	// d is the last non-zero element of the sequence, of degree 0 in x
+	ex res = d;
+	if (cdeg > 1)
+		divide(pow(d, cdeg).expand(), pow(h, cdeg-1).expand(), res, false);
+	return sign * res;
+}
+
+/** Resultant of two polynomials e1, e2 with rational coefficients and
+ *  positive degrees h1, h2 in the symbol s.  The denominators are cleared
+ *  first, res(e1/c1, e2/c2) = res(e1, e2)/(c1^h2 c2^h1). */
+static ex resultant_rational(const ex &e1, const ex &e2, const symbol &s,
+                             const int h1, const int h2)
+{
+	const numeric c1 = lcm_of_coefficients_denominators(e1);
+	const numeric c2 = lcm_of_coefficients_denominators(e2);
+	const ex a = multiply_lcm(e1, c1).expand();
+	const ex b = multiply_lcm(e2, c2).expand();
+
+	ex res;
+	if (h1 + h2 <= resultant_modular_threshold)
+		res = sr_resultant(a, b, s);
+	else {
+		try {
+			res = chinrem_resultant(a, b, s);
+		} catch (const chinrem_resultant_failed&) {
+			res = sr_resultant(a, b, s);
+		}
+	}
+	return (res / (pow(c1, h2) * pow(c2, h1))).expand();
+}
+
 /** Resultant of two expressions e1,e2 with respect to symbol s.
- *  Method: Compute determinant of Sylvester matrix of e1,e2,s.  */
+ *  Method: For polynomials with rational coefficients use the subresultant
+ *  PRS if the degrees in s are small and a modular algorithm otherwise.
+ *  In all other cases compute the determinant of the Sylvester matrix of
+ *  e1,e2,s.  */
 ex resultant(const ex & e1, const ex & e2, const ex & s)
 {
 	const ex ee1 = e1.expand();
@@ -2729,6 +2869,11 @@ ex resultant(const ex & e1, const ex & e2, const ex & s)
 	const int h2 = ee2.degree(s);
 	const int l2 = ee2.ldegree(s);
 
+	if (h1 > 0 && h2 > 0 && is_a<symbol>(s) &&
+	    ee1.info(info_flags::rational_polynomial) &&
+	    ee2.info(info_flags::rational_polynomial))
+		return resultant_rational(ee1, ee2, ex_to<symbol>(s), h1, h2);
+
 	const int msize = h1 + h2;
 	matrix m(msize, msize);
 
@@ -65,6 +65,7 @@ struct gcd_options
 
 class ex;
 class symbol;
+class numeric;
 
 // Quotient q(x) of polynomials a(x) and b(x) in Q[x], so that a(x)=b(x)*q(x)+r(x)
 extern ex quo(const ex &a, const ex &b, const ex &x, bool check_args = true);
@@ -92,7 +93,7 @@ extern ex gcd(const ex &a, const ex &b, ex *ca = NULL, ex *cb = NULL,
 extern ex lcm(const ex &a, const ex &b, bool check_args = true);
 
 // Square-free factorization of a polynomial a(x)
-extern ex sqrfree(const ex &a, const lst &l = lst());
+extern ex sqrfree(const ex &a, const lst &l = lst(), unsigned algo = sqrfree_algo::automatic);
 
 // Square-free partial fraction decomposition of a rational function a(x)
 extern ex sqrfree_parfrac(const ex & a, const symbol & x);
@@ -100,9 +101,18 @@ extern ex sqrfree_parfrac(const ex & a, const symbol & x);
 // Collect common factors in sums.
 extern ex collect_common_factors(const ex & e);
 
+// Expansion without the terms of degree > order in the symbols l.
+extern ex expand_truncated(const ex & e, const ex & l, int order);
+
+// Expansion with the coefficients reduced modulo p.
+extern ex expand_mod(const ex & e, const numeric & p);
+
 // Resultant of two polynomials e1,e2 with respect to symbol s.
 extern ex resultant(const ex & e1, const ex & e2, const ex & s);
 
+// Probabilistic test whether e is zero as a rational function.
+extern bool is_zero_probabilistic(const ex & e, unsigned confidence = 64, double * error = 0, bool exact_fallback = false, unsigned long seed = 0);
+
 } // namespace GiNaC
 
 #endif // ndef GINAC_NORMAL_H
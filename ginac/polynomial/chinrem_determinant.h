@@ -0,0 +1,46 @@
+/** @file chinrem_determinant.h
+ *
+ *  Interface to the modular determinant of polynomial matrices. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_CHINREM_DETERMINANT_H
+#define GINAC_CHINREM_DETERMINANT_H
+
+#include "ex.h"
+
+namespace GiNaC {
+
+/// Default limit on the number of evaluation points.
+const std::size_t chinrem_determinant_max_points = 1 << 16;
+
+extern ex chinrem_determinant(const exvector& m, const unsigned n,
+			      const std::size_t max_points = chinrem_determinant_max_points);
+
+/// Insert all symbols occurring in the matrix entry e into syms.
+extern void collect_entry_symbols(const ex& e, exset& syms);
+
+struct chinrem_determinant_failed
+{
+	virtual ~chinrem_determinant_failed() { }
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_CHINREM_DETERMINANT_H
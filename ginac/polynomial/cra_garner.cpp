@@ -1,6 +1,7 @@
 /** @file cra_garner.cpp
  *
- *  Garner's algorithm. */
+ *  Chinese remainder algorithm (Garner's algorithm and product tree based
+ *  algorithm for many moduli) and rational number reconstruction. */
 
 /*
  *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
@@ -25,6 +26,7 @@
 
 #include <cln/integer.h>
 #include <cln/modinteger.h>
+#include <cln/rational.h>
 #include <cstddef>
 #include <vector>
 
@@ -94,12 +96,101 @@ mixed_radix_2_ordinary(const vector<cl_I>& mixed_radix_coeffs,
 	return u;
 }
 
+/// Use the product tree based algorithm if there are at least that many
+/// moduli. Garner's algorithm needs O(k^2) operations with small numbers
+/// and is faster for a few moduli.
+static const size_t cra_tree_threshold = 24;
+
+/// Product tree of the moduli: level 0 contains the moduli themselves,
+/// each next level contains the products of adjacent pairs of the previous
+/// one (an odd element is carried over to the next level unchanged). The
+/// last level consists of the product of all moduli.
+typedef vector< vector<cl_I> > product_tree;
+
+static void
+build_product_tree(product_tree& tree, const vector<cl_I>& moduli)
+{
+	tree.clear();
+	tree.push_back(moduli);
+	while (tree.back().size() > 1) {
+		const size_t n = tree.back().size();
+		vector<cl_I> next((n + 1) >> 1);
+		for (size_t i = 0; i + 1 < n; i += 2)
+			next[i >> 1] = tree.back()[i]*tree.back()[i+1];
+		if (n & 1)
+			next.back() = tree.back().back();
+		tree.push_back(next);
+	}
+}
+
+/// Compute c_i = (M/m_i)^{-1} mod m_i, where M is the product of all moduli.
+/// (M/m_i) mod m_i is obtained as (M mod m_i^2)/m_i. The remainders
+/// M mod m_i^2 are computed by reducing M down the tree modulo the squared
+/// products of the nodes (remainder tree).
+static void
+compute_tree_recips(vector<cl_I>& dst, const product_tree& tree)
+{
+	vector<cl_I> rems(1, tree.back()[0]);
+	for (size_t level = tree.size() - 1; level-- != 0; ) {
+		const vector<cl_I>& nodes = tree[level];
+		vector<cl_I> next(nodes.size());
+		for (size_t i = 0; i < nodes.size(); ++i)
+			next[i] = mod(rems[i >> 1], square(nodes[i]));
+		rems.swap(next);
+	}
+
+	const vector<cl_I>& moduli = tree[0];
+	dst.resize(moduli.size());
+	for (size_t i = 0; i < moduli.size(); ++i) {
+		cl_modint_ring R = find_modint_ring(moduli[i]);
+		dst[i] = R->retract(recip(R->canonhom(exquo(rems[i], moduli[i]))));
+	}
+}
+
+/// Combine the residues going up the product tree:
+/// x = \sum_i (r_i c_i mod m_i) M/m_i.
+/// The result is in the symmetric representation.
+static cl_I
+tree_cra(const vector<cl_I>& residues, const product_tree& tree,
+	 const vector<cl_I>& recips)
+{
+	const vector<cl_I>& moduli = tree[0];
+	vector<cl_I> vals(moduli.size());
+	for (size_t i = 0; i < moduli.size(); ++i)
+		vals[i] = mod(residues[i]*recips[i], moduli[i]);
+
+	for (size_t level = 0; level + 1 < tree.size(); ++level) {
+		const vector<cl_I>& nodes = tree[level];
+		const size_t n = nodes.size();
+		vector<cl_I> next((n + 1) >> 1);
+		for (size_t i = 0; i + 1 < n; i += 2)
+			next[i >> 1] = vals[i]*nodes[i+1] + vals[i+1]*nodes[i];
+		if (n & 1)
+			next.back() = vals.back();
+		vals.swap(next);
+	}
+
+	const cl_I& modulus = tree.back()[0];
+	cl_I result = mod(vals[0], modulus);
+	if (result > (modulus >> 1))
+		result = result - modulus;
+	return result;
+}
+
 cl_I integer_cra(const vector<cl_I>& residues,
 	         const vector<cl_I>& moduli)
 {
 	if (unlikely(moduli.size() < 2))
 		throw std::invalid_argument("integer_cra: need at least 2 moduli");
 
+	if (moduli.size() >= cra_tree_threshold) {
+		product_tree tree;
+		build_product_tree(tree, moduli);
+		vector<cl_I> recips;
+		compute_tree_recips(recips, tree);
+		return tree_cra(residues, tree, recips);
+	}
+
 	vector<cl_MI> recips(moduli.size() - 1);
 	compute_recips(recips, moduli);
 
@@ -110,4 +201,57 @@ cl_I integer_cra(const vector<cl_I>& residues,
 	return result;
 }
 
+vector<cl_I> integer_cra(const vector< vector<cl_I> >& residues,
+			 const vector<cl_I>& moduli)
+{
+	if (unlikely(moduli.size() < 2))
+		throw std::invalid_argument("integer_cra: need at least 2 moduli");
+
+	vector<cl_I> result(residues.size());
+	if (moduli.size() >= cra_tree_threshold) {
+		product_tree tree;
+		build_product_tree(tree, moduli);
+		vector<cl_I> recips;
+		compute_tree_recips(recips, tree);
+		for (size_t j = 0; j < residues.size(); ++j)
+			result[j] = tree_cra(residues[j], tree, recips);
+		return result;
+	}
+
+	vector<cl_MI> recips(moduli.size() - 1);
+	compute_recips(recips, moduli);
+
+	vector<cl_I> coeffs(moduli.size());
+	for (size_t j = 0; j < residues.size(); ++j) {
+		compute_mix_radix_coeffs(coeffs, residues[j], moduli, recips);
+		result[j] = mixed_radix_2_ordinary(coeffs, moduli);
+	}
+	return result;
+}
+
+bool rational_reconstruction(cl_RA& result, const cl_I& a, const cl_I& m)
+{
+	// Wang's algorithm: run the extended Euclidean algorithm on m and a
+	// until the remainder drops below sqrt(m/2), the cofactor of a is
+	// then the denominator.
+	const cl_I bound = isqrt(m >> 1);
+	cl_I r0 = m, r1 = mod(a, m);
+	cl_I s0 = 0, s1 = 1;
+	while (r1 > bound) {
+		const cl_I_div_t qr = floor2(r0, r1);
+		r0 = r1;
+		r1 = qr.remainder;
+		const cl_I tmp = s0 - qr.quotient*s1;
+		s0 = s1;
+		s1 = tmp;
+	}
+	if (abs(s1) > bound || gcd(r1, s1) != 1)
+		return false;
+	if (minusp(s1))
+		result = -r1/(-s1);
+	else
+		result = r1/s1;
+	return true;
+}
+
 } // namespace cln
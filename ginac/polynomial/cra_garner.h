@@ -1,6 +1,6 @@
 /** @file cra_garner.h
  *
- *  Interface to Garner's algorithm. */
+ *  Interface to Chinese remainder algorithm and rational reconstruction. */
 
 /*
  *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
@@ -24,13 +24,43 @@
 #define CL_INTEGER_CRA
 
 #include <cln/integer.h>
+#include <cln/rational.h>
 #include <vector>
 
 namespace cln {
 
+/**
+ * @brief Chinese remainder algorithm for integers.
+ *
+ * Compute x such that x = residues[i] mod moduli[i] for all i. The moduli
+ * must be pairwise coprime, the result is in the symmetric representation.
+ * Garner's algorithm is used for a few moduli, for many moduli the residues
+ * are combined via the product tree of the moduli.
+ */
 extern cl_I integer_cra(const std::vector<cl_I>& residues,
 	                const std::vector<cl_I>& moduli);
 
+/**
+ * @brief Chinese remainder algorithm for many integers at once.
+ *
+ * Same as above, but for the vector of integers x_j with
+ * x_j = residues[j][i] mod moduli[i] (typically coefficients of a
+ * polynomial). The data depending on moduli only is computed just once.
+ */
+extern std::vector<cl_I>
+integer_cra(const std::vector< std::vector<cl_I> >& residues,
+	    const std::vector<cl_I>& moduli);
+
+/**
+ * @brief Rational number reconstruction.
+ *
+ * Find the rational number n/d such that n = a*d mod m with |n|, d less
+ * than sqrt(m/2). Returns false if there is no such number (either m is
+ * too small or a does not correspond to a rational number).
+ */
+extern bool rational_reconstruction(cl_RA& result, const cl_I& a,
+				    const cl_I& m);
+
 } // namespace cln
 
 #endif // CL_INTEGER_CRA
@@ -0,0 +1,77 @@
+/** @file cra_images.cpp
+ *
+ *  Chinese remaindering of integer vectors from their images modulo many
+ *  primes. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "cra_images.h"
+#include "cra_garner.h"
+#include "smod_helpers.h"
+#include "word_mod.h"
+
+namespace GiNaC {
+
+cra_images::cra_images(std::size_t size, int stable_count)
+  : residues(size), q(1), check(stable_count), fingerprint(0), unchanged(0)
+{
+}
+
+void cra_images::add(const std::vector<cln::cl_I>& images, long p)
+{
+	GINAC_ASSERT(images.size() == residues.size());
+	for (std::size_t j = 0; j < residues.size(); ++j)
+		residues[j].push_back(images[j]);
+	moduli.push_back(cln::cl_I(p));
+	if (check > 0) {
+		// the weights are fixed pseudo-random numbers, so that changes
+		// of different integers are unlikely to cancel
+		const mod_t pm = p;
+		mod_t f = 0;
+		for (std::size_t j = 0; j < images.size(); ++j) {
+			const mod_t w = 1 + (j*2654435761UL) % 65521;
+			f = (f + mulmod(w, cln::cl_I_to_ulong(cln::mod(images[j], p)), pm)) % pm;
+		}
+		const mod_t old = cln::cl_I_to_ulong(cln::mod(fingerprint, p));
+		const mod_t d = (f + pm - old) % pm;
+		if (d || moduli.size() == 1) {
+			const mod_t qinv = recip(cln::cl_I_to_ulong(cln::mod(q, p)), pm);
+			fingerprint = fingerprint + q*smod(cln::cl_I(mulmod(d, qinv, pm)), p);
+			unchanged = 0;
+		} else
+			++unchanged;
+	}
+	q = q*p;
+}
+
+std::vector<cln::cl_I> cra_images::result() const
+{
+	if (moduli.empty())
+		return std::vector<cln::cl_I>(residues.size(), 0);
+	if (moduli.size() == 1) {
+		const long p = cln::cl_I_to_long(moduli[0]);
+		std::vector<cln::cl_I> r(residues.size());
+		for (std::size_t j = 0; j < residues.size(); ++j)
+			r[j] = smod(residues[j][0], p);
+		return r;
+	}
+	return cln::integer_cra(residues, moduli);
+}
+
+} // namespace GiNaC
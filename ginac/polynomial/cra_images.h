@@ -0,0 +1,77 @@
+/** @file cra_images.h
+ *
+ *  Chinese remaindering of integer vectors from their images modulo many
+ *  primes. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_POLYNOMIAL_CRA_IMAGES_H
+#define GINAC_POLYNOMIAL_CRA_IMAGES_H
+
+#include <cln/integer.h>
+#include <cstddef>
+#include <vector>
+
+namespace GiNaC {
+
+/**
+ * Collects the images of a vector of integers modulo word-sized primes and
+ * combines them by the batched integer_cra(), which shares the product
+ * tree of the moduli between all the integers. Combining the images one
+ * prime at a time would cost O(k^2) for k primes.
+ *
+ * Optionally the images are checked for stability. Only a fingerprint,
+ * a fixed linear combination of all the integers, is combined one prime
+ * at a time. The result is stable if the fingerprint did not change for
+ * a given number of primes in a row.
+ */
+class cra_images
+{
+public:
+	/**
+	 * @param size  number of integers
+	 * @param stable_count  number of primes in a row which must not change
+	 *                      the fingerprint, 0 if stability is not checked
+	 */
+	explicit cra_images(std::size_t size, int stable_count = 0);
+
+	/// Add the images of all integers modulo the prime p.
+	void add(const std::vector<cln::cl_I>& images, long p);
+
+	/// Product of all the primes so far.
+	const cln::cl_I& modulus() const { return q; }
+
+	/// Whether the fingerprint did not change for stable_count primes.
+	bool stable() const { return check > 0 && unchanged >= check; }
+
+	/// The integers in the symmetric representation modulo modulus().
+	std::vector<cln::cl_I> result() const;
+
+private:
+	std::vector<std::vector<cln::cl_I> > residues;  ///< [integer][prime]
+	std::vector<cln::cl_I> moduli;
+	cln::cl_I q;
+	const int check;
+	cln::cl_I fingerprint;  ///< symmetric representation modulo q
+	int unchanged;  ///< primes which did not change the fingerprint
+};
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_POLYNOMIAL_CRA_IMAGES_H
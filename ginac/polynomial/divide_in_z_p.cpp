@@ -21,6 +21,7 @@
  */
 
 #include "add.h"
+#include "normal.h"
 #include "operators.h"
 #include "power.h"
 #include "smod_helpers.h"
@@ -97,9 +98,10 @@ bool divide_in_z_p(const ex &a, const ex &b, ex &q, const exvector& vars, const
 			break;
 		term = (term*power(x, rdeg - bdeg)).expand();
 		v.push_back(term);
-		r = (r - term*eb).expand();
 		if (p != 0)
-			r = r.smod(numeric(p));
+			r = expand_mod(r - term*eb, numeric(p));
+		else
+			r = (r - term*eb).expand();
 		if (r.is_zero()) {
 			q = (new add(v))->setflag(status_flags::dynallocated);
 			return true;
@@ -0,0 +1,163 @@
+/** @file mcharpoly.cpp
+ *
+ *  Characteristic polynomial of matrices with rational entries by Hessenberg
+ *  reduction modulo primes and Chinese remaindering. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "chinrem_charpoly.h"
+#include "cra_images.h"
+#include "primes_factory.h"
+#include "smod_helpers.h"
+#include "word_mod.h"
+#include "numeric.h"
+#include "operators.h"
+
+#include <cln/integer.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace GiNaC {
+
+/**
+ * Characteristic polynomial det(x - a) of the n x n matrix a modulo p,
+ * coefficients in increasing powers of x.  The matrix is reduced to upper
+ * Hessenberg form by a similarity transformation first, a is destroyed.
+ */
+static std::vector<mod_t> charpoly_mod(std::vector<mod_t>& a, const std::size_t n,
+				       const mod_t p)
+{
+	for (std::size_t c = 0; c + 2 < n; ++c) {
+		std::size_t r = c + 1;
+		while (r < n && a[r*n + c] == 0)
+			++r;
+		if (r == n)
+			continue;
+		if (r != c + 1) {
+			std::swap_ranges(a.begin() + r*n, a.begin() + r*n + n,
+					 a.begin() + (c + 1)*n);
+			for (std::size_t i = 0; i < n; ++i)
+				std::swap(a[i*n + r], a[i*n + c + 1]);
+		}
+		const mod_t inv = recip(a[(c + 1)*n + c], p);
+		for (r = c + 2; r < n; ++r) {
+			if (a[r*n + c] == 0)
+				continue;
+			const mod_t u = mulmod(a[r*n + c], inv, p);
+			// row r -= u*row c+1, then column c+1 += u*column r
+			for (std::size_t j = c; j < n; ++j)
+				a[r*n + j] = (a[r*n + j] + mulmod(p - u, a[(c + 1)*n + j], p)) % p;
+			for (std::size_t i = 0; i < n; ++i)
+				a[i*n + c + 1] = (a[i*n + c + 1] + mulmod(u, a[i*n + r], p)) % p;
+		}
+	}
+
+	// polynomials of the leading principal submatrices
+	std::vector<std::vector<mod_t> > poly(n + 1);
+	poly[0].assign(1, 1);
+	for (std::size_t k = 1; k <= n; ++k) {
+		std::vector<mod_t>& pk = poly[k];
+		const std::vector<mod_t>& pk1 = poly[k - 1];
+		const mod_t h = p - a[(k - 1)*n + k - 1];
+		pk.assign(k + 1, 0);
+		for (std::size_t j = 0; j < k; ++j) {
+			pk[j + 1] = (pk[j + 1] + pk1[j]) % p;
+			pk[j] = (pk[j] + mulmod(h, pk1[j], p)) % p;
+		}
+		mod_t t = 1;
+		for (std::size_t i = 1; i < k && t; ++i) {
+			t = mulmod(t, a[(k - i)*n + k - i - 1], p);
+			const mod_t f = p - mulmod(a[(k - i - 1)*n + k - 1], t, p);
+			if (f == p)
+				continue;
+			const std::vector<mod_t>& pki = poly[k - i - 1];
+			for (std::size_t j = 0; j < pki.size(); ++j)
+				pk[j] = (pk[j] + mulmod(f, pki[j], p)) % p;
+		}
+	}
+	return poly[n];
+}
+
+/**
+ * Characteristic polynomial det(x - m) of a square matrix with rational
+ * entries.
+ *
+ * The matrix is made integral by multiplying it with the LCM d of all
+ * denominators.  Modulo a prime its characteristic polynomial is computed
+ * in O(n^3) operations on machine words and the images are combined by
+ * Chinese remaindering (all at once, see cra_images) until the modulus
+ * exceeds twice the bound \f$\prod_i (1 + \sum_j |a_{ij}|)\f$ on the
+ * coefficients (every coefficient is a sum of principal minors).  Finally the coefficient of
+ * \f$x^k\f$ is divided by \f$d^{n-k}\f$.
+ *
+ * @param m  the entries of the matrix in row-major order, all rational
+ * @param n  number of rows and columns
+ * @return   the coefficients in increasing powers of x
+ */
+std::vector<numeric> chinrem_charpoly(const exvector& m, const unsigned n)
+{
+	cln::cl_I den = 1;
+	for (std::size_t i = 0; i < m.size(); ++i)
+		den = cln::lcm(den, cln::the<cln::cl_I>(ex_to<numeric>(m[i]).denom().to_cl_N()));
+
+	std::vector<cln::cl_I> a(m.size());
+	std::vector<cln::cl_I> rownorm(n, 1), colnorm(n, 1);
+	for (unsigned r = 0; r < n; ++r) {
+		for (unsigned c = 0; c < n; ++c) {
+			a[r*n + c] = to_cl_I(m[r*n + c]*numeric(den));
+			rownorm[r] = rownorm[r] + cln::abs(a[r*n + c]);
+			colnorm[c] = colnorm[c] + cln::abs(a[r*n + c]);
+		}
+	}
+	cln::cl_I rbound = 1, cbound = 1;
+	for (unsigned i = 0; i < n; ++i) {
+		rbound = rbound*rownorm[i];
+		cbound = cbound*colnorm[i];
+	}
+	const cln::cl_I bound2 = 2*std::min(rbound, cbound);
+
+	cra_images images(n + 1);
+	long p_;
+	primes_factory pfactory;
+	std::vector<mod_t> amod(a.size());
+	while (images.modulus() <= bound2) {
+		if (!pfactory(p_, cln::cl_I(1)))
+			throw std::runtime_error("chinrem_charpoly: ran out of primes");
+		const mod_t p = p_;
+		for (std::size_t i = 0; i < a.size(); ++i)
+			amod[i] = cln::cl_I_to_ulong(cln::mod(a[i], p_));
+		const std::vector<mod_t> vals = charpoly_mod(amod, n, p);
+
+		std::vector<cln::cl_I> image(n + 1);
+		for (unsigned k = 0; k <= n; ++k)
+			image[k] = cln::cl_I(vals[k]);
+		images.add(image, p_);
+	}
+	const std::vector<cln::cl_I> acc = images.result();
+
+	std::vector<numeric> result(n + 1);
+	cln::cl_I scale = 1;
+	for (unsigned k = n + 1; k-- > 0; ) {
+		result[k] = numeric(acc[k])/numeric(scale);
+		scale = scale*den;
+	}
+	return result;
+}
+
+} // namespace GiNaC
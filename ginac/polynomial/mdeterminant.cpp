@@ -0,0 +1,308 @@
+/** @file mdeterminant.cpp
+ *
+ *  Determinant of matrices of polynomials with rational coefficients by
+ *  evaluation/interpolation and Chinese remaindering. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "chinrem_determinant.h"
+#include "collect_vargs.h"
+#include "cra_images.h"
+#include "primes_factory.h"
+#include "smod_helpers.h"
+#include "word_mod.h"
+#include "numeric.h"
+#include "operators.h"
+#include "symbol.h"
+
+#include <cln/integer.h>
+#include <algorithm>
+
+namespace GiNaC {
+
+/// Stop as soon as the result agreed with this many primes in a row.
+static const int stable_primes = 2;
+
+/// Polynomial with integer coefficients as a list of terms.
+typedef std::vector<std::pair<exp_vector_t, cln::cl_I> > term_list;
+
+void collect_entry_symbols(const ex& e, exset& syms)
+{
+	if (is_a<symbol>(e)) {
+		syms.insert(e);
+		return;
+	}
+	for (std::size_t i = 0; i < e.nops(); ++i)
+		collect_entry_symbols(e.op(i), syms);
+}
+
+/// Determinant of the n x n matrix a modulo p, a is destroyed.
+static mod_t det_mod(std::vector<mod_t>& a, const std::size_t n, const mod_t p)
+{
+	mod_t det = 1;
+	bool negate = false;
+	for (std::size_t c = 0; c < n; ++c) {
+		std::size_t r = c;
+		while (r < n && a[r*n + c] == 0)
+			++r;
+		if (r == n)
+			return 0;
+		if (r != c) {
+			std::swap_ranges(a.begin() + r*n + c, a.begin() + r*n + n,
+					 a.begin() + c*n + c);
+			negate = !negate;
+		}
+		const mod_t pivot = a[c*n + c];
+		det = mulmod(det, pivot, p);
+		const mod_t inv = recip(pivot, p);
+		for (r = c + 1; r < n; ++r) {
+			if (a[r*n + c] == 0)
+				continue;
+			const mod_t f = p - mulmod(a[r*n + c], inv, p);
+			for (std::size_t j = c + 1; j < n; ++j)
+				a[r*n + j] = (a[r*n + j] + mulmod(f, a[c*n + j], p)) % p;
+		}
+	}
+	return negate && det ? p - det : det;
+}
+
+/**
+ * Interpolate along one line of the grid. The values at y = 0, \ldots, n-1
+ * are stored at v[base], v[base + stride], \ldots and get replaced by the
+ * coefficients of the interpolating polynomial (Newton's divided
+ * differences, then conversion to the monomial basis).
+ */
+static void interpolate_line(std::vector<mod_t>& v, const std::size_t base,
+			     const std::size_t stride, const std::size_t n,
+			     const std::vector<mod_t>& inv, const mod_t p)
+{
+	std::vector<mod_t> c(n);
+	for (std::size_t i = 0; i < n; ++i)
+		c[i] = v[base + i*stride];
+	for (std::size_t k = 1; k < n; ++k) {
+		for (std::size_t i = n - 1; i >= k; --i)
+			c[i] = mulmod(c[i] + p - c[i - 1], inv[k], p);
+	}
+	// poly = (\ldots(c_{n-1} (y - (n-2)) + c_{n-2}) \ldots) (y - 0) + c_0
+	std::vector<mod_t> poly(n, 0);
+	poly[0] = c[n - 1];
+	for (std::size_t i = n - 1, len = 1; i-- > 0; ++len) {
+		const mod_t yi = i;
+		poly[len] = poly[len - 1];
+		for (std::size_t l = len - 1; l > 0; --l)
+			poly[l] = (poly[l - 1] + p - mulmod(yi, poly[l], p)) % p;
+		poly[0] = (c[i] + p - mulmod(yi, poly[0], p)) % p;
+	}
+	for (std::size_t i = 0; i < n; ++i)
+		v[base + i*stride] = poly[i];
+}
+
+/**
+ * Determinant of a square matrix of polynomials with rational coefficients.
+ *
+ * The rows are made integral by multiplying them with the LCM of the
+ * denominators of their coefficients. Modulo a prime the determinant is
+ * then interpolated from its values on the grid
+ * \f$\{0, \ldots, D_1\} \times \ldots \times \{0, \ldots, D_k\}\f$, where
+ * \f$D_j\f$ bounds the degree of the determinant in the j-th symbol (the
+ * smaller one of the sums of the row and column degrees). Only primes
+ * larger than every \f$D_j + 1\f$ are used, so that the grid points are
+ * distinct modulo the prime. The images are combined by Chinese
+ * remaindering (all at once, see cra_images) until the modulus exceeds
+ * twice the bound \f$\prod_i \sum_j \|m_{ij}\|_1\f$ on the
+ * coefficients, or until the result is stable for a couple of primes in
+ * a row.
+ *
+ * @param m  the entries of the matrix in row-major order
+ * @param n  number of rows and columns
+ * @param max_points  give up if the grid has more points than this
+ * @return   the expanded determinant
+ * @exception chinrem_determinant_failed  if an entry is not a polynomial
+ *            with rational coefficients or the grid is too large
+ */
+ex chinrem_determinant(const exvector& m, const unsigned n,
+		       const std::size_t max_points)
+{
+	exset syms;
+	for (std::size_t i = 0; i < m.size(); ++i) {
+		if (!m[i].info(info_flags::rational_polynomial))
+			throw chinrem_determinant_failed();
+		collect_entry_symbols(m[i], syms);
+	}
+	const exvector vars(syms.begin(), syms.end());
+	const std::size_t k = vars.size();
+
+	// layout of the grid, the first symbol varies fastest
+	std::vector<std::size_t> npts(k), stride(k);
+	std::vector<int> maxdeg(k);
+	std::size_t total = 1, maxpts = 0;
+	for (std::size_t j = 0; j < k; ++j) {
+		std::vector<int> rowdeg(n), coldeg(n);
+		for (unsigned r = 0; r < n; ++r) {
+			for (unsigned c = 0; c < n; ++c) {
+				const int d = m[r*n + c].degree(vars[j]);
+				rowdeg[r] = std::max(rowdeg[r], d);
+				coldeg[c] = std::max(coldeg[c], d);
+			}
+		}
+		std::size_t rsum = 0, csum = 0;
+		for (unsigned i = 0; i < n; ++i) {
+			rsum += rowdeg[i];
+			csum += coldeg[i];
+			maxdeg[j] = std::max(maxdeg[j], rowdeg[i]);
+		}
+		npts[j] = std::min(rsum, csum) + 1;
+		maxpts = std::max(maxpts, npts[j]);
+		stride[j] = total;
+		if (npts[j] > max_points/total)
+			throw chinrem_determinant_failed();
+		total *= npts[j];
+	}
+
+	// integral entries and their norms
+	std::vector<term_list> entries(m.size());
+	std::vector<cln::cl_I> rownorm(n), colnorm(n);
+	cln::cl_I den = 1;
+	for (unsigned r = 0; r < n; ++r) {
+		std::vector<ex_collect_t> ec(n);
+		cln::cl_I lcm = 1;
+		for (unsigned c = 0; c < n; ++c) {
+			const ex e = m[r*n + c].expand();
+			if (e.is_zero())
+				continue;
+			collect_vargs(ec[c], e, vars);
+			for (std::size_t t = 0; t < ec[c].size(); ++t)
+				lcm = cln::lcm(lcm, cln::the<cln::cl_I>(ex_to<numeric>(ec[c][t].second).denom().to_cl_N()));
+		}
+		den = den*lcm;
+		for (unsigned c = 0; c < n; ++c) {
+			term_list& tl = entries[r*n + c];
+			cln::cl_I norm = 0;
+			tl.reserve(ec[c].size());
+			for (std::size_t t = 0; t < ec[c].size(); ++t) {
+				const exp_vector_t& ev = ec[c][t].first;
+				tl.push_back(std::make_pair(ev, to_cl_I(ec[c][t].second*numeric(lcm))));
+				norm = norm + cln::abs(tl.back().second);
+			}
+			rownorm[r] = rownorm[r] + norm;
+			colnorm[c] = colnorm[c] + norm;
+		}
+	}
+
+	cln::cl_I rbound = 1, cbound = 1;
+	for (unsigned i = 0; i < n; ++i) {
+		rbound = rbound*rownorm[i];
+		cbound = cbound*colnorm[i];
+	}
+	const cln::cl_I bound2 = 2*std::min(rbound, cbound);
+
+	cra_images images(total, stable_primes);
+	long p_;
+	primes_factory pfactory;
+	while (images.modulus() <= bound2 && !images.stable()) {
+		if (!pfactory(p_, cln::cl_I(1)))
+			throw chinrem_determinant_failed();
+		// the grid points must be distinct modulo p (the primes start
+		// at about 2^14 on 32 bit machines)
+		if (std::size_t(p_) <= maxpts)
+			continue;
+		const mod_t p = p_;
+
+		std::vector<std::vector<mod_t> > cmod(entries.size());
+		for (std::size_t i = 0; i < entries.size(); ++i) {
+			cmod[i].resize(entries[i].size());
+			for (std::size_t t = 0; t < entries[i].size(); ++t)
+				cmod[i][t] = cln::cl_I_to_ulong(cln::mod(entries[i][t].second, p_));
+		}
+
+		// values of the determinant on the grid
+		std::vector<mod_t> vals(total);
+		std::vector<std::size_t> idx(k);
+		std::vector<std::vector<mod_t> > pows(k);
+		std::vector<mod_t> a(m.size());
+		for (std::size_t t = 0; t < total; ++t) {
+			// the first symbol changes at every step, the next one only
+			// if the previous one wrapped around
+			for (std::size_t j = 0; j < k; ++j) {
+				pows[j].assign(maxdeg[j] + 1, 1);
+				for (int e = 1; e <= maxdeg[j]; ++e)
+					pows[j][e] = mulmod(pows[j][e - 1], idx[j], p);
+				if (idx[j])
+					break;
+			}
+			for (std::size_t i = 0; i < entries.size(); ++i) {
+				mod_t v = 0;
+				for (std::size_t s = 0; s < entries[i].size(); ++s) {
+					const exp_vector_t& ev = entries[i][s].first;
+					mod_t term = cmod[i][s];
+					for (std::size_t j = 0; j < k; ++j) {
+						if (ev[j])
+							term = mulmod(term, pows[j][ev[j]], p);
+					}
+					v = (v + term) % p;
+				}
+				a[i] = v;
+			}
+			vals[t] = det_mod(a, n, p);
+			// next grid point
+			for (std::size_t j = 0; j < k; ++j) {
+				if (++idx[j] < npts[j])
+					break;
+				idx[j] = 0;
+			}
+		}
+
+		// interpolate one variable after the other
+		for (std::size_t j = 0; j < k; ++j) {
+			std::vector<mod_t> inv(npts[j], 1);
+			for (std::size_t i = 2; i < npts[j]; ++i)
+				inv[i] = recip(i, p);
+			for (std::size_t t = 0; t < total; ++t) {
+				if ((t/stride[j]) % npts[j] == 0)
+					interpolate_line(vals, t, stride[j], npts[j], inv, p);
+			}
+		}
+
+		std::vector<cln::cl_I> image(total);
+		for (std::size_t t = 0; t < total; ++t)
+			image[t] = cln::cl_I(vals[t]);
+		images.add(image, p_);
+	}
+	const std::vector<cln::cl_I> acc = images.result();
+
+	ex_collect_t ec;
+	std::vector<std::size_t> idx(k);
+	const numeric dennum(den);
+	for (std::size_t t = 0; t < total; ++t) {
+		if (!zerop(acc[t])) {
+			exp_vector_t ev(k);
+			for (std::size_t j = 0; j < k; ++j)
+				ev[j] = idx[j];
+			ec.push_back(std::make_pair(ev, ex(numeric(acc[t])/dennum)));
+		}
+		for (std::size_t j = 0; j < k; ++j) {
+			if (++idx[j] < npts[j])
+				break;
+			idx[j] = 0;
+		}
+	}
+	return ex_collect_to_ex(ec, vars);
+}
+
+} // namespace GiNaC
@@ -79,8 +79,12 @@ ex chinrem_gcd(const ex& A_, const ex& B_, const exvector& vars)
 		std::min(A_max_coeff, B_max_coeff);
 
 
+	// Modular images of the GCD and the corresponding primes. The images
+	// are combined all at once (which is much cheaper than folding them
+	// one by one) when it's time to check if the GCD is found.
+	exvector images;
+	std::vector<cln::cl_I> moduli;
 	cln::cl_I q = 0;
-	ex H = 0;
 
 	long p;
 	primes_factory pfactory;
@@ -101,26 +105,26 @@ ex chinrem_gcd(const ex& A_, const ex& B_, const exvector& vars)
 		exp_vector_t cp_deg = degree_vector(Cp, vars);
 		if (zerop(cp_deg))
 			return numeric(c);
-		if (zerop(q)) {
-			H = Cp;
+		if (zerop(q) || cp_deg < n) {
+			// all previous homomorphisms (if any) are unlucky
+			images.clear();
+			moduli.clear();
+			images.push_back(Cp);
+			moduli.push_back(p);
 			n = cp_deg;
 			q = p;
+		} else if (cp_deg == n) {
+			images.push_back(Cp);
+			moduli.push_back(p);
+			q = q*cln::cl_I(p);
 		} else {
-			if (cp_deg == n) {
-				ex H_next = chinese_remainder(H, q, Cp, p);
-				q = q*cln::cl_I(p);
-				H = H_next;
-			} else if (cp_deg < n) {
-				// all previous homomorphisms are unlucky
-				q = p;
-				H = Cp;
-				n = cp_deg;
-			} else {
-				// dp_deg > d_deg: current prime is bad
-			}
+			// dp_deg > d_deg: current prime is bad
 		}
 		if (q < lcoeff_limit)
 			continue; // don't bother to do division checks
+		const ex H = chinese_remainder(images, moduli, vars);
+		images.assign(1, H);
+		moduli.assign(1, q);
 		ex C, dummy1, dummy2;
 		extract_integer_content(C, H);
 		if (divide_in_z_p(A, C, dummy1, vars, 0) && 
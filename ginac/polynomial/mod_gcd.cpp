@@ -166,7 +166,9 @@ void mod_gcd(upoly& result, upoly A, upoly B)
 
 
 		// check for unlucky homomorphisms
-		if (degree(cp) < max_gcd_degree) {
+		if (!zerop(q) && degree(cp) > max_gcd_degree)
+			continue;
+		if (zerop(q) || degree(cp) < max_gcd_degree) {
 			q = p;
 			max_gcd_degree = degree(cp);
 			retract(H, cp, Rp);
@@ -0,0 +1,324 @@
+/** @file mresultant.cpp
+ *
+ *  Resultant of multivariate polynomials by Chinese remainder algorithm
+ *  and dense evaluation/interpolation. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "chinrem_resultant.h"
+#include "collect_vargs.h"
+#include "cra_images.h"
+#include "optimal_vars_finder.h"
+#include "primes_factory.h"
+#include "smod_helpers.h"
+#include "upoly.h"
+#include "numeric.h"
+#include "symbol.h"
+
+#include <cln/integer.h>
+#include <cln/modinteger.h>
+#include <algorithm>
+
+namespace GiNaC {
+
+/// Give up if the resultant would have to be interpolated from more values
+/// than this. The caller falls back to the subresultant PRS then.
+static const std::size_t max_eval_points = 1 << 16;
+
+/// Polynomial in x, y_1, \ldots, y_k with integer coefficients as a list of
+/// terms, the first exponent is the one of x.
+typedef std::vector<std::pair<exp_vector_t, cln::cl_I> > term_list;
+
+static void make_term_list(term_list& tl, const ex& e, const exvector& vars)
+{
+	ex_collect_t ec;
+	collect_vargs(ec, e, vars);
+	tl.reserve(ec.size());
+	for (std::size_t i = 0; i < ec.size(); ++i)
+		tl.push_back(std::make_pair(ec[i].first, to_cl_I(ec[i].second)));
+}
+
+/// Sum of the squares of the 1-norms of the coefficients with respect to x.
+static cln::cl_I norm_sq(const term_list& tl, const int deg)
+{
+	std::vector<cln::cl_I> norms(deg + 1);
+	for (std::size_t i = 0; i < tl.size(); ++i)
+		norms[tl[i].first[0]] = norms[tl[i].first[0]] + cln::abs(tl[i].second);
+	cln::cl_I ret = 0;
+	for (int i = 0; i <= deg; ++i)
+		ret = ret + norms[i]*norms[i];
+	return ret;
+}
+
+static cln::cl_MI expt(const cln::cl_MI& a, const std::size_t e)
+{
+	if (e == 0)
+		return a.ring()->one();
+	return expt_pos(a, cln::cl_I(long(e)));
+}
+
+/// a := a mod b in Z_p[x], b must not be zero.
+static void rem_in_place(umodpoly& a, const umodpoly& b)
+{
+	if (a.size() < b.size())
+		return;
+	const std::size_t db = degree(b);
+	const cln::cl_MI b_lcinv = recip(lcoeff(b));
+	for (std::size_t k = a.size(); k-- > db; ) {
+		if (zerop(a[k]))
+			continue;
+		const cln::cl_MI qk = a[k]*b_lcinv;
+		for (std::size_t i = 0; i < db; ++i)
+			a[k - db + i] = a[k - db + i] - qk*b[i];
+	}
+	a.resize(db);
+	canonicalize(a);
+}
+
+/**
+ * Resultant of two univariate polynomials over Z_p of formal degrees n and
+ * m. Their leading coefficients may vanish, the result is the determinant
+ * of the Sylvester matrix anyway, hence it commutes with every evaluation
+ * of the coefficients and there are no unlucky primes or points.
+ */
+static cln::cl_MI resultant_in_field(umodpoly a, std::size_t n,
+				     umodpoly b, std::size_t m,
+				     const cln::cl_modint_ring& R)
+{
+	cln::cl_MI res = R->one();
+	canonicalize(a);
+	canonicalize(b);
+	while (true) {
+		if (n == 0)
+			return a.empty() ? (m ? R->zero() : res) : res*expt(a[0], m);
+		if (m == 0)
+			return b.empty() ? R->zero() : res*expt(b[0], n);
+		if (a.empty() || b.empty())
+			return R->zero();
+		const std::size_t da = degree(a), db = degree(b);
+		if (da < n && db < m) {
+			// the first column of the Sylvester matrix is zero
+			return R->zero();
+		}
+		if (db < m) {
+			res = res*expt(lcoeff(a), m - db);
+			m = db;
+			continue;
+		}
+		if (da < n) {
+			if ((n & m) & 1)
+				res = -res;
+			std::swap(a, b);
+			std::swap(n, m);
+			continue;
+		}
+		// res(a, b) = (-1)^{nm} lc(b)^{n - deg(r)} res(b, r), r = a mod b
+		rem_in_place(a, b);
+		if (a.empty())
+			return R->zero();
+		const std::size_t dr = degree(a);
+		if ((n & m) & 1)
+			res = -res;
+		res = res*expt(lcoeff(b), n - dr);
+		std::swap(a, b);
+		n = m;
+		m = dr;
+	}
+}
+
+/// Evaluate the polynomial modulo p at y_j = pows[j][1], the result is a
+/// dense polynomial in x of size deg + 1.
+static void eval_term_list(umodpoly& up, const term_list& tl,
+			   const std::vector<cln::cl_MI>& cmod,
+			   const std::vector<std::vector<cln::cl_MI> >& pows,
+			   const int deg, const cln::cl_modint_ring& R)
+{
+	up.assign(deg + 1, R->zero());
+	for (std::size_t i = 0; i < tl.size(); ++i) {
+		const exp_vector_t& ev = tl[i].first;
+		cln::cl_MI t = cmod[i];
+		for (std::size_t j = 1; j < ev.size(); ++j) {
+			if (ev[j])
+				t = t*pows[j - 1][ev[j]];
+		}
+		up[ev[0]] = up[ev[0]] + t;
+	}
+}
+
+/**
+ * Interpolate along one line of the grid. The values at y = 0, \ldots, n-1
+ * are stored at v[base], v[base + stride], \ldots and get replaced by the
+ * coefficients of the interpolating polynomial (Newton's divided
+ * differences, then conversion to the monomial basis).
+ */
+static void interpolate_line(std::vector<cln::cl_MI>& v, const std::size_t base,
+			     const std::size_t stride, const std::size_t n,
+			     const std::vector<cln::cl_MI>& inv,
+			     const cln::cl_modint_ring& R)
+{
+	std::vector<cln::cl_MI> c(n);
+	for (std::size_t i = 0; i < n; ++i)
+		c[i] = v[base + i*stride];
+	for (std::size_t k = 1; k < n; ++k) {
+		for (std::size_t i = n - 1; i >= k; --i)
+			c[i] = (c[i] - c[i - 1])*inv[k];
+	}
+	// poly = (\ldots(c_{n-1} (y - (n-2)) + c_{n-2}) \ldots) (y - 0) + c_0
+	std::vector<cln::cl_MI> poly(n, R->zero());
+	poly[0] = c[n - 1];
+	for (std::size_t i = n - 1, len = 1; i-- > 0; ++len) {
+		const cln::cl_MI yi = R->canonhom(cln::cl_I(long(i)));
+		poly[len] = poly[len - 1];
+		for (std::size_t l = len - 1; l > 0; --l)
+			poly[l] = poly[l - 1] - yi*poly[l];
+		poly[0] = c[i] - yi*poly[0];
+	}
+	for (std::size_t i = 0; i < n; ++i)
+		v[base + i*stride] = poly[i];
+}
+
+/**
+ * Resultant of A and B in Z[x, y_1, \ldots, y_k] with respect to x.
+ *
+ * Modulo a prime the resultant is interpolated from its values on the grid
+ * \f$\{0, \ldots, D_1\} \times \ldots \times \{0, \ldots, D_k\}\f$, where
+ * \f$D_j = \deg_x(B) \deg_{y_j}(A) + \deg_x(A) \deg_{y_j}(B)\f$ bounds the
+ * degree of the resultant in y_j. The images are combined by Chinese
+ * remaindering (all at once, see cra_images) until the modulus exceeds
+ * twice the Goldstein-Graham bound on the coefficients of the Sylvester
+ * determinant.
+ *
+ * @param A  polynomial in Z[x, y_1, \ldots, y_k], \f$\deg_x(A) > 0\f$
+ * @param B  polynomial in Z[x, y_1, \ldots, y_k], \f$\deg_x(B) > 0\f$
+ * @param x  the variable to eliminate
+ * @return   resultant of A and B with respect to x
+ * @exception chinrem_resultant_failed  if the grid is too large
+ */
+ex chinrem_resultant(const ex& A, const ex& B, const symbol& x)
+{
+	const exvector allvars = gcd_optimal_variables_order(A, B);
+	exvector yvars;
+	for (std::size_t i = 0; i < allvars.size(); ++i) {
+		if (!allvars[i].is_equal(x))
+			yvars.push_back(allvars[i]);
+	}
+	exvector vars(1, x);
+	vars.insert(vars.end(), yvars.begin(), yvars.end());
+	const std::size_t k = yvars.size();
+
+	const int n = A.degree(x);
+	const int m = B.degree(x);
+
+	// layout of the grid, y_1 varies fastest
+	std::vector<std::size_t> npts(k), stride(k);
+	std::vector<int> maxdeg(k);
+	std::size_t total = 1;
+	for (std::size_t j = 0; j < k; ++j) {
+		maxdeg[j] = std::max(A.degree(yvars[j]), B.degree(yvars[j]));
+		npts[j] = m*A.degree(yvars[j]) + n*B.degree(yvars[j]) + 1;
+		stride[j] = total;
+		if (npts[j] > max_eval_points/total)
+			throw chinrem_resultant_failed();
+		total *= npts[j];
+	}
+
+	term_list ta, tb;
+	make_term_list(ta, A, vars);
+	make_term_list(tb, B, vars);
+	// q > 2*bound <=> q^2 > 4*bound^2
+	const cln::cl_I bound_sq4 = 4*cln::expt_pos(norm_sq(ta, n), m)*
+				      cln::expt_pos(norm_sq(tb, m), n);
+
+	cra_images images(total);
+	long p;
+	primes_factory pfactory;
+	while (images.modulus()*images.modulus() <= bound_sq4) {
+		if (!pfactory(p, cln::cl_I(1)))
+			throw chinrem_resultant_failed();
+		const cln::cl_modint_ring R = cln::find_modint_ring(p);
+
+		std::vector<cln::cl_MI> ca(ta.size()), cb(tb.size());
+		for (std::size_t i = 0; i < ta.size(); ++i)
+			ca[i] = R->canonhom(ta[i].second);
+		for (std::size_t i = 0; i < tb.size(); ++i)
+			cb[i] = R->canonhom(tb[i].second);
+
+		// values of the resultant on the grid
+		std::vector<cln::cl_MI> vals(total, R->zero());
+		std::vector<std::size_t> idx(k);
+		std::vector<std::vector<cln::cl_MI> > pows(k);
+		umodpoly ua, ub;
+		for (std::size_t t = 0; t < total; ++t) {
+			// y_1 changes at every step, y_{j+1} only if y_j wrapped around
+			for (std::size_t j = 0; j < k; ++j) {
+				const cln::cl_MI y = R->canonhom(cln::cl_I(long(idx[j])));
+				pows[j].assign(maxdeg[j] + 1, R->one());
+				for (int e = 1; e <= maxdeg[j]; ++e)
+					pows[j][e] = pows[j][e - 1]*y;
+				if (idx[j])
+					break;
+			}
+			eval_term_list(ua, ta, ca, pows, n, R);
+			eval_term_list(ub, tb, cb, pows, m, R);
+			vals[t] = resultant_in_field(ua, n, ub, m, R);
+			// next grid point
+			for (std::size_t j = 0; j < k; ++j) {
+				if (++idx[j] < npts[j])
+					break;
+				idx[j] = 0;
+			}
+		}
+
+		// interpolate one variable after the other
+		for (std::size_t j = 0; j < k; ++j) {
+			std::vector<cln::cl_MI> inv(npts[j], R->one());
+			for (std::size_t i = 2; i < npts[j]; ++i)
+				inv[i] = recip(R->canonhom(cln::cl_I(long(i))));
+			for (std::size_t t = 0; t < total; ++t) {
+				if ((t/stride[j]) % npts[j] == 0)
+					interpolate_line(vals, t, stride[j], npts[j], inv, R);
+			}
+		}
+
+		std::vector<cln::cl_I> image(total);
+		for (std::size_t t = 0; t < total; ++t)
+			image[t] = R->retract(vals[t]);
+		images.add(image, p);
+	}
+	const std::vector<cln::cl_I> acc = images.result();
+
+	ex_collect_t ec;
+	std::vector<std::size_t> idx(k);
+	for (std::size_t t = 0; t < total; ++t) {
+		if (!zerop(acc[t])) {
+			exp_vector_t ev(k);
+			for (std::size_t j = 0; j < k; ++j)
+				ev[j] = idx[j];
+			ec.push_back(std::make_pair(ev, ex(numeric(acc[t]))));
+		}
+		for (std::size_t j = 0; j < k; ++j) {
+			if (++idx[j] < npts[j])
+				break;
+			idx[j] = 0;
+		}
+	}
+	return ex_collect_to_ex(ec, yvars);
+}
+
+} // namespace GiNaC
@@ -0,0 +1,186 @@
+/** @file msqrfree.cpp
+ *
+ *  Square-free factorization by Chinese remainder algorithm. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "chinrem_sqrfree.h"
+#include "pgcd.h"
+#include "collect_vargs.h"
+#include "optimal_vars_finder.h"
+#include "primes_factory.h"
+#include "divide_in_z_p.h"
+#include "poly_cra.h"
+#include "smod_helpers.h"
+#include "operators.h"
+#include "numeric.h"
+#include "power.h"
+#include "symbol.h"
+
+#include <algorithm>
+
+namespace GiNaC {
+
+/**
+ * Yun's algorithm in \f$Z_p[x_1, \ldots, x_n]\f$. The factors are returned
+ * in ascending multiplicity, as by sqrfree_yun() in normal.cpp.
+ */
+static void yun_in_z_p(exvector& res, const ex& a, const symbol& x,
+		       const exvector& vars, const long p)
+{
+	const numeric pnum(p);
+	ex w = a;
+	ex z = w.diff(x).expand().smod(pnum);
+	ex g = pgcd(w, z, vars, p);
+	if (is_a<numeric>(g)) {
+		res.push_back(a);
+		return;
+	}
+	do {
+		ex y, wq;
+		divide_in_z_p(w, g, wq, vars, p);
+		divide_in_z_p(z, g, y, vars, p);
+		w = wq;
+		z = (y - w.diff(x)).expand().smod(pnum);
+		g = z.is_zero() ? w : pgcd(w, z, vars, p);
+		res.push_back(g);
+	} while (!z.is_zero());
+}
+
+/// Total degree of the leading monomial, it increases strictly with every
+/// non-constant factor.
+static int leading_degree(const ex& e, const exvector& vars)
+{
+	const exp_vector_t d = degree_vector(e, vars);
+	int deg = 0;
+	for (std::size_t i = 0; i < d.size(); ++i)
+		deg += d[i];
+	return deg;
+}
+
+/**
+ * Square-free factorization of a in Z[x_1, \ldots, x_n] with respect to x.
+ *
+ * Yun's algorithm is run on the images of a modulo several primes, and the
+ * factors are reconstructed by Chinese remaindering. Multiplicities can only
+ * go up modulo a prime, so an image whose sequence of factor degrees is
+ * lexicographically smaller than another one is unlucky. The factors are
+ * normalized to the leading coefficient of a before remaindering and made
+ * primitive afterwards. The result is checked by trial division.
+ *
+ * @param a_ polynomial in Z[x_1, \ldots, x_n], treated as a polynomial in x
+ * @param x  variable of the derivatives in Yun's algorithm
+ * @return   square-free factors sorted in ascending multiplicity, their
+ *           product is a up to a factor not depending on x
+ */
+exvector chinrem_sqrfree_yun(const ex& a_, const symbol& x)
+{
+	const ex a = a_.expand();
+	const ex da = a.diff(x);
+	const exvector vars = gcd_optimal_variables_order(a, da);
+	const cln::cl_I lc = integer_lcoeff(a, vars);
+	cln::cl_I limit = 2*cln::abs(lc)*to_cl_I(a.max_coefficient());
+	// give up (and let the caller use the plain Yun algorithm) if the
+	// modulus grows way beyond the expected size of the coefficients
+	const cln::cl_I hopeless = cln::expt_pos(limit, 4);
+
+	// Modular images of every factor, the corresponding primes and the
+	// sequence of the leading degrees of the factors
+	std::vector<exvector> images;
+	std::vector<cln::cl_I> moduli;
+	std::vector<int> shape;
+	cln::cl_I q = 0;
+
+	long p;
+	primes_factory pfactory;
+	while (true) {
+		bool has_primes = pfactory(p, lc);
+		if (!has_primes)
+			throw chinrem_sqrfree_failed();
+
+		const numeric pnum(p);
+		exvector res;
+		try {
+			yun_in_z_p(res, a.smod(pnum), x, vars, p);
+		} catch (const pgcd_failed&) {
+			continue;
+		}
+
+		// make the leading coefficient of every factor equal to lc
+		const cln::cl_I lcp = smod(lc, p);
+		std::vector<int> res_shape(res.size());
+		for (std::size_t i = 0; i < res.size(); ++i) {
+			const cln::cl_I res_lc = integer_lcoeff(res[i], vars);
+			const cln::cl_I nlc = smod(recip(res_lc, p)*lcp, p);
+			res[i] = (res[i]*numeric(nlc)).expand().smod(pnum);
+			res_shape[i] = leading_degree(res[i], vars);
+		}
+
+		if (res.size() == 1) {
+			// square free modulo p, hence square free
+			return exvector(1, a_);
+		}
+
+		if (zerop(q) || std::lexicographical_compare(shape.begin(), shape.end(),
+							     res_shape.begin(), res_shape.end())) {
+			// all previous homomorphisms (if any) are unlucky
+			images.assign(res.size(), exvector());
+			for (std::size_t i = 0; i < res.size(); ++i)
+				images[i].push_back(res[i]);
+			moduli.assign(1, cln::cl_I(p));
+			shape = res_shape;
+			q = p;
+		} else if (shape == res_shape) {
+			for (std::size_t i = 0; i < res.size(); ++i)
+				images[i].push_back(res[i]);
+			moduli.push_back(p);
+			q = q*cln::cl_I(p);
+		} else {
+			// current prime is unlucky
+		}
+		if (q < limit)
+			continue; // don't bother to do division checks
+
+		// reconstruct the factors and check their product
+		exvector factors(images.size());
+		ex prod = 1;
+		for (std::size_t i = 0; i < images.size(); ++i) {
+			const ex H = chinese_remainder(images[i], moduli, vars);
+			images[i].assign(1, H);
+			factors[i] = (H/H.integer_content()).expand();
+			if (integer_lcoeff(factors[i], vars) < 0)
+				factors[i] = (-factors[i]).expand();
+			prod *= pow(factors[i], int(i + 1));
+		}
+		moduli.assign(1, q);
+		// Yun's algorithm drops the content with respect to x, the caller
+		// puts it back
+		ex cofactor;
+		if (divide_in_z_p(a, prod.expand(), cofactor, vars, 0) &&
+		    !cofactor.has(x))
+			return factors;
+
+		// try more primes, check again when the modulus has doubled in size
+		if (q > hopeless)
+			throw chinrem_sqrfree_failed();
+		limit = q*q;
+	}
+}
+
+} // namespace GiNaC
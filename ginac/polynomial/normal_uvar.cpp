@@ -0,0 +1,356 @@
+/** @file normal_uvar.cpp
+ *
+ *  Normalization of univariate rational functions with dense polynomials. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "normal_uvar.h"
+#include "upoly.h"
+#include "mod_gcd.h"
+#include "debug.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "numeric.h"
+#include "symbol.h"
+#include "operators.h"
+
+#include <cln/integer.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace GiNaC {
+
+/// Rational function num/den in Z[x] with gcd(num, den) = 1 and a positive
+/// leading coefficient of den. Zero is 0/1, i.e. an empty num.
+struct ufrac
+{
+	upoly num;
+	upoly den;
+};
+
+static bool is_one(const upoly& p)
+{
+	return p.size() == 1 && p[0] == 1;
+}
+
+/// Dense polynomials are used if the bound on the degrees of the result is
+/// in this range. Below it the generic code is fast enough and keeps the
+/// numerator and denominator partially factored, beyond it the dense
+/// representation may be too wasteful.
+static const double min_degree = 16;
+static const double max_degree = 1000;
+
+/// Check that e is a rational function in a single symbol x with rational
+/// coefficients, and compute bounds on the degrees of a numerator and a
+/// denominator of e
+static bool is_uvar_rational_function(const ex& e, ex& x, double& dnum, double& dden)
+{
+	dnum = dden = 0;
+	if (is_exactly_a<numeric>(e))
+		return ex_to<numeric>(e).is_rational();
+	if (is_a<symbol>(e)) {
+		dnum = 1;
+		if (x.is_zero()) {
+			x = e;
+			return true;
+		}
+		return x.is_equal(e);
+	}
+	if (is_exactly_a<add>(e)) {
+		double maxdiff = 0;
+		for (std::size_t i = 0; i < e.nops(); ++i) {
+			double n, d;
+			if (!is_uvar_rational_function(e.op(i), x, n, d))
+				return false;
+			maxdiff = std::max(maxdiff, n - d);
+			dden += d;
+		}
+		dnum = dden + maxdiff;
+		return true;
+	}
+	if (is_exactly_a<mul>(e)) {
+		for (std::size_t i = 0; i < e.nops(); ++i) {
+			double n, d;
+			if (!is_uvar_rational_function(e.op(i), x, n, d))
+				return false;
+			dnum += n;
+			dden += d;
+		}
+		return true;
+	}
+	if (is_exactly_a<power>(e) && e.op(1).info(info_flags::integer)) {
+		double n, d;
+		if (!is_uvar_rational_function(e.op(0), x, n, d))
+			return false;
+		const double k = ex_to<numeric>(e.op(1)).to_double();
+		dnum = k > 0 ? k*n : -k*d;
+		dden = k > 0 ? k*d : -k*n;
+		return dnum <= max_degree && dden <= max_degree;
+	}
+	return false;
+}
+
+static void upoly_mul(upoly& r, const upoly& a, const upoly& b)
+{
+	if (a.empty() || b.empty()) {
+		r.clear();
+		return;
+	}
+	upoly c(a.size() + b.size() - 1);
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		if (zerop(a[i]))
+			continue;
+		for (std::size_t j = 0; j < b.size(); ++j)
+			c[i + j] = c[i + j] + a[i]*b[j];
+	}
+	r.swap(c);
+}
+
+/// Exact division q = a/b in Z[x]
+static void upoly_exquo(upoly& q, const upoly& a, const upoly& b)
+{
+	if (is_one(b)) {
+		q = a;
+		return;
+	}
+	if (a.size() < b.size()) {
+		bug_on(!a.empty(), "upoly_exquo: division is not exact");
+		q.clear();
+		return;
+	}
+	upoly r(a);
+	upoly c(a.size() - b.size() + 1);
+	const std::size_t db = degree(b);
+	const cln::cl_I& lc = lcoeff(b);
+	for (std::size_t k = a.size(); k-- > db; ) {
+		if (zerop(r[k]))
+			continue;
+		const cln::cl_I qk = cln::exquo(r[k], lc);
+		c[k - db] = qk;
+		for (std::size_t i = 0; i <= db; ++i)
+			r[k - db + i] = r[k - db + i] - qk*b[i];
+	}
+	canonicalize(r);
+	bug_on(!r.empty(), "upoly_exquo: division is not exact");
+	canonicalize(c);
+	q.swap(c);
+}
+
+/// GCD in Z[x] (including the integer content), with positive leading
+/// coefficient
+static void upoly_gcd(upoly& g, const upoly& a, const upoly& b)
+{
+	if (a.empty() || b.empty()) {
+		g = a.empty() ? b : a;
+		if (!g.empty() && minusp(lcoeff(g))) {
+			for (std::size_t i = 0; i < g.size(); ++i)
+				g[i] = -g[i];
+		}
+		return;
+	}
+	if (is_one(a) || is_one(b)) {
+		g.assign(1, cln::cl_I(1));
+		return;
+	}
+	if (degree(a) == 0 || degree(b) == 0) {
+		// integer GCD of all the coefficients
+		cln::cl_I c = 0;
+		for (std::size_t i = 0; i < a.size(); ++i)
+			c = cln::gcd(c, a[i]);
+		for (std::size_t i = 0; i < b.size(); ++i)
+			c = cln::gcd(c, b[i]);
+		g.assign(1, c);
+		return;
+	}
+	mod_gcd(g, a, b);
+}
+
+static void negate(upoly& p)
+{
+	for (std::size_t i = 0; i < p.size(); ++i)
+		p[i] = -p[i];
+}
+
+/// r = a + b (Henrici's algorithm)
+static void add_ufrac(ufrac& r, const ufrac& a, const ufrac& b)
+{
+	if (a.num.empty()) {
+		r = b;
+		return;
+	}
+	if (b.num.empty()) {
+		r = a;
+		return;
+	}
+	upoly g;
+	upoly_gcd(g, a.den, b.den);
+	upoly aden_g, bden_g;
+	upoly_exquo(aden_g, a.den, g);
+	upoly_exquo(bden_g, b.den, g);
+
+	upoly num, t;
+	upoly_mul(num, a.num, bden_g);
+	upoly_mul(t, b.num, aden_g);
+	if (num.size() < t.size())
+		num.resize(t.size());
+	for (std::size_t i = 0; i < t.size(); ++i)
+		num[i] = num[i] + t[i];
+	canonicalize(num);
+	if (num.empty()) {
+		r.num.clear();
+		r.den.assign(1, cln::cl_I(1));
+		return;
+	}
+
+	// only factors of g can cancel
+	upoly h;
+	upoly_gcd(h, num, g);
+	upoly_exquo(r.num, num, h);
+	upoly_exquo(t, b.den, h);
+	upoly_mul(r.den, aden_g, t);
+}
+
+/// r = a*b, cancelling the numerator of each factor with the denominator
+/// of the other one
+static void mul_ufrac(ufrac& r, const ufrac& a, const ufrac& b)
+{
+	if (a.num.empty() || b.num.empty()) {
+		r.num.clear();
+		r.den.assign(1, cln::cl_I(1));
+		return;
+	}
+	upoly g1, g2, n1, n2, d1, d2;
+	upoly_gcd(g1, a.num, b.den);
+	upoly_gcd(g2, b.num, a.den);
+	upoly_exquo(n1, a.num, g1);
+	upoly_exquo(d2, b.den, g1);
+	upoly_exquo(n2, b.num, g2);
+	upoly_exquo(d1, a.den, g2);
+	upoly_mul(r.num, n1, n2);
+	upoly_mul(r.den, d1, d2);
+}
+
+static void upoly_pow(upoly& r, const upoly& a, unsigned long k)
+{
+	upoly b(a);
+	r.assign(1, cln::cl_I(1));
+	while (k) {
+		if (k & 1)
+			upoly_mul(r, r, b);
+		k >>= 1;
+		if (k)
+			upoly_mul(b, b, b);
+	}
+}
+
+static void normal_uvar(ufrac& r, const ex& e, const ex& x)
+{
+	if (is_exactly_a<numeric>(e)) {
+		const numeric& n = ex_to<numeric>(e);
+		r.num.clear();
+		if (!n.is_zero())
+			r.num.push_back(cln::the<cln::cl_I>(n.numer().to_cl_N()));
+		r.den.assign(1, cln::the<cln::cl_I>(n.denom().to_cl_N()));
+	} else if (is_a<symbol>(e)) {
+		r.num.assign(2, cln::cl_I(0));
+		r.num[1] = 1;
+		r.den.assign(1, cln::cl_I(1));
+	} else if (is_exactly_a<add>(e) || is_exactly_a<mul>(e)) {
+		// combine the operands in a balanced tree
+		std::vector<ufrac> f(e.nops());
+		for (std::size_t i = 0; i < e.nops(); ++i)
+			normal_uvar(f[i], e.op(i), x);
+		const bool is_add = is_exactly_a<add>(e);
+		while (f.size() > 1) {
+			std::size_t j = 0;
+			for (std::size_t i = 0; i + 1 < f.size(); i += 2, ++j) {
+				ufrac t;
+				if (is_add)
+					add_ufrac(t, f[i], f[i+1]);
+				else
+					mul_ufrac(t, f[i], f[i+1]);
+				f[j] = t;
+			}
+			if (f.size() % 2)
+				f[j++] = f.back();
+			f.resize(j);
+		}
+		r = f[0];
+	} else {
+		GINAC_ASSERT(is_exactly_a<power>(e));
+		ufrac b;
+		normal_uvar(b, e.op(0), x);
+		const numeric& k = ex_to<numeric>(e.op(1));
+		if (k.is_negative()) {
+			if (b.num.empty())
+				throw std::overflow_error("normal(): division by zero");
+			b.num.swap(b.den);
+			if (minusp(lcoeff(b.den))) {
+				negate(b.num);
+				negate(b.den);
+			}
+		}
+		const unsigned long n = abs(k).to_long();
+		upoly_pow(r.num, b.num, n);
+		upoly_pow(r.den, b.den, n);
+	}
+}
+
+static ex upoly_to_ex(const upoly& a, const ex& x)
+{
+	exvector terms;
+	terms.reserve(a.size());
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		if (!zerop(a[i]))
+			terms.push_back(numeric(a[i]) * pow(x, int(i)));
+	}
+	return (new add(terms))->setflag(status_flags::dynallocated);
+}
+
+/**
+ * Normalization of rational functions in a single variable with rational
+ * coefficients. The whole computation is done with dense polynomials in
+ * Z[x], using Henrici's algorithm for sums and the modular GCD, and the
+ * result is converted to ex only once at the end.
+ *
+ * @param num  numerator of the result (returned)
+ * @param den  denominator of the result (returned), its leading
+ *             coefficient is positive and it is coprime to num
+ * @param e    expression to normalize
+ * @return false if e is not a rational function in one symbol with
+ *         rational coefficients, num and den are left alone in this case
+ */
+bool normal_uvar(ex& num, ex& den, const ex& e)
+{
+	ex x = 0;
+	double dnum, dden;
+	if (!is_uvar_rational_function(e, x, dnum, dden) || x.is_zero() ||
+	    std::max(dnum, dden) < min_degree ||
+	    dnum > max_degree || dden > max_degree)
+		return false;
+
+	ufrac r;
+	normal_uvar(r, e, x);
+	num = upoly_to_ex(r.num, x);
+	den = upoly_to_ex(r.den, x);
+	return true;
+}
+
+} // namespace GiNaC
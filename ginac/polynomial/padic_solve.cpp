@@ -0,0 +1,319 @@
+/** @file padic_solve.cpp
+ *
+ *  Solution of linear systems with rational coefficients by p-adic lifting
+ *  (Dixon's algorithm) and rational number reconstruction. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "padic_solve.h"
+#include "cra_garner.h"
+#include "primes_factory.h"
+#include "smod_helpers.h"
+#include "word_mod.h"
+#include "numeric.h"
+#include "operators.h"
+
+#include <cln/integer.h>
+#include <cln/rational.h>
+#include <algorithm>
+
+namespace GiNaC {
+
+/// Give up (the matrix is most likely singular) after this many primes.
+static const int max_unlucky_primes = 3;
+
+/**
+ * Inverse of the n x n matrix a modulo p by Gauss-Jordan elimination, a is
+ * destroyed.  Returns false if a is singular modulo p.
+ */
+static bool inverse_mod(std::vector<mod_t>& a, std::vector<mod_t>& inv,
+			const std::size_t n, const mod_t p)
+{
+	inv.assign(n*n, 0);
+	for (std::size_t i = 0; i < n; ++i)
+		inv[i*n + i] = 1;
+	for (std::size_t c = 0; c < n; ++c) {
+		std::size_t r = c;
+		while (r < n && a[r*n + c] == 0)
+			++r;
+		if (r == n)
+			return false;
+		if (r != c) {
+			std::swap_ranges(a.begin() + r*n, a.begin() + r*n + n,
+					 a.begin() + c*n);
+			std::swap_ranges(inv.begin() + r*n, inv.begin() + r*n + n,
+					 inv.begin() + c*n);
+		}
+		const mod_t pinv = recip(a[c*n + c], p);
+		for (std::size_t j = 0; j < n; ++j) {
+			a[c*n + j] = mulmod(a[c*n + j], pinv, p);
+			inv[c*n + j] = mulmod(inv[c*n + j], pinv, p);
+		}
+		for (r = 0; r < n; ++r) {
+			if (r == c || a[r*n + c] == 0)
+				continue;
+			const mod_t f = p - a[r*n + c];
+			for (std::size_t j = c; j < n; ++j)
+				a[r*n + j] = (a[r*n + j] + mulmod(f, a[c*n + j], p)) % p;
+			for (std::size_t j = 0; j < n; ++j)
+				inv[r*n + j] = (inv[r*n + j] + mulmod(f, inv[c*n + j], p)) % p;
+		}
+	}
+	return true;
+}
+
+/// The entries of the matrix are split into limbs of this many bits.
+static const int limb_bits = 30;
+static const mod_t limb_base = 1ULL << limb_bits;
+static const mod_t limb_mask = limb_base - 1;
+
+/**
+ * Scalar product of a row of the matrix with the digits y.  The limbs of
+ * the entries (l-th limb of entry j at limbs[j*nlimbs + l]) are multiplied
+ * with the digits, the lower and upper 30 bits of the products (below
+ * 2^60) are summed up separately per limb.  After propagating the carries
+ * in machine words only a few operations on big integers remain.
+ */
+static cln::cl_I dot_row(const mod_t* limbs, const std::size_t nlimbs,
+			 const std::vector<bool>::const_iterator negative,
+			 const std::vector<mod_t>& y, std::vector<long long>& d)
+{
+	d.assign(nlimbs + 1, 0);
+	for (std::size_t j = 0; j < y.size(); ++j) {
+		if (!y[j])
+			continue;
+		const mod_t* limb = limbs + j*nlimbs;
+		const bool neg = negative[j];
+		for (std::size_t l = 0; l < nlimbs; ++l) {
+			const mod_t prod = limb[l]*y[j];
+			const long long lo = prod & limb_mask, hi = prod >> limb_bits;
+			if (neg) {
+				d[l] -= lo;
+				d[l + 1] -= hi;
+			} else {
+				d[l] += lo;
+				d[l + 1] += hi;
+			}
+		}
+	}
+	// normalize to digits in [0, 2^30) and a signed carry
+	long long carry = 0;
+	for (std::size_t l = 0; l <= nlimbs; ++l) {
+		const long long v = d[l] + carry;
+		carry = v >= 0 ? v/(long long)limb_base
+			       : -((-v + (long long)limb_mask)/(long long)limb_base);
+		d[l] = v - carry*(long long)limb_base;
+	}
+	// combine two digits at a time
+	cln::cl_I result = carry;
+	std::size_t l = nlimbs + 1;
+	if (l % 2) {
+		--l;
+		result = cln::ash(result, limb_bits) + cln::cl_I(d[l]);
+	}
+	while (l) {
+		l -= 2;
+		result = cln::ash(result, 2*limb_bits)
+		         + cln::cl_I((mod_t(d[l + 1]) << limb_bits) | mod_t(d[l]));
+	}
+	return result;
+}
+
+/**
+ * Recover the rationals with the images x modulo m.  The entries of one
+ * solution usually share most of their denominator, so every entry is
+ * first multiplied by the denominators found so far.  Returns false if
+ * some entry could not be reconstructed.
+ */
+static bool reconstruct(std::vector<cln::cl_RA>& result,
+			const std::vector<cln::cl_I>& x, const cln::cl_I& m)
+{
+	cln::cl_I den = 1;
+	for (std::size_t i = 0; i < x.size(); ++i) {
+		const cln::cl_I t = cln::mod(x[i]*den, m);
+		const cln::cl_I ts = t > (m >> 1) ? t - m : t;
+		if (2*ts*ts < m) {
+			result[i] = ts/den;
+			continue;
+		}
+		cln::cl_RA r;
+		if (!cln::rational_reconstruction(r, t, m))
+			return false;
+		result[i] = r/den;
+		den = den*cln::denominator(r);
+	}
+	return true;
+}
+
+/**
+ * Solve the linear system a x = b with a square non-singular matrix a of
+ * rational numbers by Dixon's p-adic lifting.
+ *
+ * The rows are made integral first.  The inverse C of a modulo a word-sized
+ * prime p is computed once; then every step computes the next p-adic digit
+ * y = C r mod p of the solution and replaces the residual r by (r - a y)/p,
+ * which needs O(n^2) operations only.  After k steps the solution is known
+ * modulo p^k and rational number reconstruction recovers it as soon as
+ * p^k exceeds twice the square of Hadamard's bound on the numerators and
+ * the denominator.  Since this bound is usually far too pessimistic,
+ * reconstruction is tried after every step (a failure is noticed at once)
+ * and a successful early guess is accepted after checking it.
+ *
+ * @param a  the entries of the n x n matrix in row-major order
+ * @param b  the entries of the n x q right hand side in row-major order
+ * @param n  number of equations and unknowns
+ * @param q  number of right hand sides
+ * @param x  the entries of the n x q solution in row-major order
+ * @return   false if an entry is not rational or the matrix is singular
+ *           modulo a couple of primes (then it most likely is singular)
+ */
+bool padic_solve(const exvector& a, const exvector& b,
+		 const unsigned n, const unsigned q, exvector& x)
+{
+	for (std::size_t i = 0; i < a.size(); ++i)
+		if (!a[i].info(info_flags::rational))
+			return false;
+	for (std::size_t i = 0; i < b.size(); ++i)
+		if (!b[i].info(info_flags::rational))
+			return false;
+
+	// integral rows and Hadamard's bounds
+	std::vector<cln::cl_I> ai(n*n), bi(n*q);
+	cln::cl_I dbound2 = 1, nbound2 = 1;
+	for (unsigned r = 0; r < n; ++r) {
+		cln::cl_I lcm = 1;
+		for (unsigned c = 0; c < n; ++c)
+			lcm = cln::lcm(lcm, cln::the<cln::cl_I>(ex_to<numeric>(a[r*n + c]).denom().to_cl_N()));
+		for (unsigned c = 0; c < q; ++c)
+			lcm = cln::lcm(lcm, cln::the<cln::cl_I>(ex_to<numeric>(b[r*q + c]).denom().to_cl_N()));
+		const numeric lcmnum(lcm);
+		cln::cl_I norm2 = 0, bmax2 = 0;
+		for (unsigned c = 0; c < n; ++c) {
+			ai[r*n + c] = to_cl_I(a[r*n + c]*lcmnum);
+			norm2 = norm2 + cln::square(ai[r*n + c]);
+		}
+		for (unsigned c = 0; c < q; ++c) {
+			bi[r*q + c] = to_cl_I(b[r*q + c]*lcmnum);
+			bmax2 = std::max(bmax2, cln::square(bi[r*q + c]));
+		}
+		dbound2 = dbound2*norm2;
+		nbound2 = nbound2*(norm2 + bmax2);
+	}
+	// reconstruction needs p^k > 2*max(N,D)^2, i.e. p^(2k) > 4*max(N,D)^4
+	const cln::cl_I bound4 = 4*cln::square(std::max(dbound2, nbound2));
+
+	// inverse modulo a prime not dividing the determinant
+	long p_;
+	primes_factory pfactory;
+	std::vector<mod_t> amod(n*n), inv;
+	int unlucky = 0;
+	while (true) {
+		if (!pfactory(p_, cln::cl_I(1)) || unlucky == max_unlucky_primes)
+			return false;
+		for (std::size_t i = 0; i < amod.size(); ++i)
+			amod[i] = cln::cl_I_to_ulong(cln::mod(ai[i], p_));
+		if (inverse_mod(amod, inv, n, p_))
+			break;
+		++unlucky;
+	}
+	const mod_t p = p_;
+
+	bug_on(p >= limb_base, "prime " << p << " too large for the digits");
+
+	// The entries are split into limbs of 30 bits, their products with
+	// the digits are summed up in machine words.
+	std::size_t nlimbs = 1;
+	for (std::size_t i = 0; i < ai.size(); ++i)
+		nlimbs = std::max(nlimbs, std::size_t((cln::integer_length(ai[i]) + limb_bits - 1)/limb_bits));
+	std::vector<mod_t> limbs(nlimbs*n*n);
+	std::vector<bool> negative(n*n);
+	for (std::size_t i = 0; i < ai.size(); ++i) {
+		cln::cl_I t = cln::abs(ai[i]);
+		negative[i] = cln::minusp(ai[i]);
+		for (std::size_t l = 0; l < nlimbs; ++l) {
+			limbs[i*nlimbs + l] = cln::cl_I_to_ulong(cln::ldb(t, cln::cl_byte(limb_bits, 0)));
+			t = cln::ash(t, -limb_bits);
+		}
+	}
+	std::vector<long long> digits;
+
+	// p-adic lifting of all columns at once
+	std::vector<cln::cl_I> res(bi), xacc(n*q, 0);
+	std::vector<mod_t> rmod(n), ymod(n);
+	std::vector<std::vector<cln::cl_RA> > sol(q, std::vector<cln::cl_RA>(n));
+	std::vector<cln::cl_I> column(n);
+	cln::cl_I pk = 1;
+	while (true) {
+		for (unsigned c = 0; c < q; ++c) {
+			for (unsigned i = 0; i < n; ++i)
+				rmod[i] = cln::cl_I_to_ulong(cln::mod(res[i*q + c], p_));
+			for (unsigned i = 0; i < n; ++i) {
+				mod_t s = 0;
+				for (unsigned j = 0; j < n; ++j)
+					s = (s + mulmod(inv[i*n + j], rmod[j], p)) % p;
+				ymod[i] = s;
+			}
+			for (unsigned i = 0; i < n; ++i) {
+				if (ymod[i])
+					xacc[i*q + c] = xacc[i*q + c] + pk*cln::cl_I(ymod[i]);
+				cln::cl_I t = res[i*q + c];
+				t = t - dot_row(&limbs[i*n*nlimbs], nlimbs, negative.begin() + i*n, ymod, digits);
+				res[i*q + c] = cln::exquo(t, p_);
+			}
+		}
+		pk = pk*p_;
+
+		const bool enough = cln::square(pk) > bound4;
+		bool ok = true;
+		for (unsigned c = 0; c < q && ok; ++c) {
+			for (unsigned i = 0; i < n; ++i)
+				column[i] = xacc[i*q + c];
+			ok = reconstruct(sol[c], column, pk);
+		}
+		if (!ok)
+			continue;
+		if (!enough) {
+			// check the guess: a x = b with x = num/den
+			for (unsigned c = 0; c < q && ok; ++c) {
+				cln::cl_I den = 1;
+				for (unsigned i = 0; i < n; ++i)
+					den = cln::lcm(den, cln::denominator(sol[c][i]));
+				for (unsigned i = 0; i < n; ++i)
+					column[i] = cln::numerator(sol[c][i])*cln::exquo(den, cln::denominator(sol[c][i]));
+				for (unsigned r = 0; r < n && ok; ++r) {
+					cln::cl_I t = -den*bi[r*q + c];
+					for (unsigned j = 0; j < n; ++j)
+						t = t + ai[r*n + j]*column[j];
+					ok = zerop(t);
+				}
+			}
+			if (!ok)
+				continue;
+		}
+		break;
+	}
+
+	x.resize(n*q);
+	for (unsigned i = 0; i < n; ++i)
+		for (unsigned c = 0; c < q; ++c)
+			x[i*q + c] = numeric(sol[c][i]);
+	return true;
+}
+
+} // namespace GiNaC
@@ -0,0 +1,36 @@
+/** @file padic_solve.h
+ *
+ *  Interface to the p-adic solver for linear systems with rational
+ *  coefficients. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_PADIC_SOLVE_H
+#define GINAC_PADIC_SOLVE_H
+
+#include "ex.h"
+
+namespace GiNaC {
+
+extern bool padic_solve(const exvector& a, const exvector& b,
+			const unsigned n, const unsigned q, exvector& x);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_PADIC_SOLVE_H
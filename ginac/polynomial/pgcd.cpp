@@ -27,6 +27,7 @@
 #include "eval_point_finder.h"
 #include "newton_interpolate.h"
 #include "divide_in_z_p.h"
+#include "normal.h"
 
 namespace GiNaC {
 
@@ -140,13 +141,13 @@ ex pgcd(const ex& A, const ex& B, const exvector& vars, const long p)
 			primpart_content(C, contH, H, vars, p);
 			// Normalize GCD so that leading coefficient is 1
 			const cln::cl_I Clc = recip(integer_lcoeff(C, vars), p);
-			C = (C*numeric(Clc)).expand().smod(pn);
+			C = expand_mod(C*numeric(Clc), pn);
 
 			ex dummy1, dummy2;
 
 			if (divide_in_z_p(Aprim, C, dummy1, vars, p) &&
 					divide_in_z_p(Bprim, C, dummy2, vars, p))
-				return (cont_gcd*C).expand().smod(pn);
+				return expand_mod(cont_gcd*C, pn);
 			// else continue building the candidate
 		} 
 	} while(true);
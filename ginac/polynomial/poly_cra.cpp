@@ -0,0 +1,92 @@
+/** @file poly_cra.cpp
+ *
+ *  Chinese remainder algorithm for polynomials. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "poly_cra.h"
+#include "collect_vargs.h"
+#include "cra_garner.h"
+#include "numeric.h"
+#include "operators.h"
+
+#include <cln/integer.h>
+#include <map>
+#include <stdexcept>
+
+namespace GiNaC {
+
+ex chinese_remainder(const ex& e1, const cln::cl_I& q1,
+		     const ex& e2, const long q2)
+{
+	// res = v_1 + v_2 q_1
+	// v_1 = e_1 mod q_1
+	// v_2 = (e_2 - v_1)/q_1 mod q_2
+	const numeric q2n(q2);
+	const numeric q1n(q1);
+	ex v1 = e1.smod(q1n);
+	ex u = v1.smod(q2n);
+	ex v2 = (e2.smod(q2n) - v1.smod(q2n)).expand().smod(q2n);
+	const numeric q1_1(recip(q1, q2)); // 1/q_1 mod q_2
+	v2 = (v2*q1_1).smod(q2n);
+	ex ret = (v1 + v2*q1n).expand();
+	return ret;
+}
+
+ex chinese_remainder(const exvector& images,
+		     const std::vector<cln::cl_I>& moduli,
+		     const exvector& vars)
+{
+	if (images.size() != moduli.size())
+		throw std::invalid_argument("chinese_remainder: number of images and moduli differ");
+	if (images.size() == 1)
+		return images[0].smod(numeric(moduli[0]));
+
+	// Collect the coefficients of every monomial, terms missing in
+	// some image have zero coefficient there.
+	typedef std::map<exp_vector_t, std::vector<cln::cl_I> > coeffs_map_t;
+	coeffs_map_t coeffs;
+	for (std::size_t i = 0; i < images.size(); ++i) {
+		ex_collect_t ec;
+		collect_vargs(ec, images[i], vars);
+		for (ex_collect_t::const_iterator j = ec.begin(); j != ec.end(); ++j) {
+			std::vector<cln::cl_I>& c = coeffs[j->first];
+			if (c.empty())
+				c.resize(images.size(), cln::cl_I(0));
+			c[i] = to_cl_I(j->second);
+		}
+	}
+
+	std::vector<std::vector<cln::cl_I> > residues;
+	residues.reserve(coeffs.size());
+	for (coeffs_map_t::const_iterator i = coeffs.begin(); i != coeffs.end(); ++i)
+		residues.push_back(i->second);
+	const std::vector<cln::cl_I> values = cln::integer_cra(residues, moduli);
+
+	ex_collect_t ec;
+	ec.reserve(coeffs.size());
+	std::size_t k = 0;
+	for (coeffs_map_t::const_iterator i = coeffs.begin(); i != coeffs.end(); ++i, ++k) {
+		if (!zerop(values[k]))
+			ec.push_back(std::make_pair(i->first, ex(numeric(values[k]))));
+	}
+	return ex_collect_to_ex(ec, vars);
+}
+
+} // namespace GiNaC
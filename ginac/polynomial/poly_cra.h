@@ -27,6 +27,7 @@
 #include "smod_helpers.h"
 
 #include <cln/integer.h>
+#include <vector>
 
 namespace GiNaC {
 
@@ -38,22 +39,20 @@ namespace GiNaC {
  * \f$r \in Z_{q_1 q_2}[x_1, \ldots, x_n]\f$ such that \f$ r mod q_1 = e_1\f$
  * and \f$ r mod q_2 = e_2 \f$ 
  */
-ex chinese_remainder(const ex& e1, const cln::cl_I& q1,
-		     const ex& e2, const long q2)
-{
-	// res = v_1 + v_2 q_1
-	// v_1 = e_1 mod q_1
-	// v_2 = (e_2 - v_1)/q_1 mod q_2
-	const numeric q2n(q2);
-	const numeric q1n(q1);
-	ex v1 = e1.smod(q1n);
-	ex u = v1.smod(q2n);
-	ex v2 = (e2.smod(q2n) - v1.smod(q2n)).expand().smod(q2n);
-	const numeric q1_1(recip(q1, q2)); // 1/q_1 mod q_2
-	v2 = (v2*q1_1).smod(q2n);
-	ex ret = (v1 + v2*q1n).expand();
-	return ret;
-}
+extern ex chinese_remainder(const ex& e1, const cln::cl_I& q1,
+			    const ex& e2, const long q2);
+
+/**
+ * @brief Chinese remainder algorithm for many polynomials at once.
+ *
+ * Given the polynomials \f$e_i \in Z_{q_i}[x_1, \ldots, x_n]\f$ compute
+ * \f$r \in Z_{q_1 \ldots q_k}[x_1, \ldots, x_n]\f$ such that
+ * \f$ r mod q_i = e_i \f$ for all i. All coefficients are reconstructed
+ * in one go, so this is much cheaper than combining the images one by one.
+ */
+extern ex chinese_remainder(const exvector& images,
+			    const std::vector<cln::cl_I>& moduli,
+			    const exvector& vars);
 
 } // namespace GiNaC
 
@@ -0,0 +1,50 @@
+/** @file word_mod.h
+ *
+ *  Modular arithmetic on machine words, for the primes of primes_factory. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_POLYNOMIAL_WORD_MOD_H
+#define GINAC_POLYNOMIAL_WORD_MOD_H
+
+namespace GiNaC {
+
+/// The primes are below 2^32, so products of residues fit into 64 bits.
+typedef unsigned long long mod_t;
+
+static inline mod_t mulmod(const mod_t a, const mod_t b, const mod_t p)
+{
+	return (a*b) % p;
+}
+
+/// Inverse of a modulo p, by the extended Euclidean algorithm.
+static inline mod_t recip(mod_t a, const mod_t p)
+{
+	long long r0 = p, r1 = a, s0 = 0, s1 = 1;
+	while (r1) {
+		const long long q = r0/r1, r2 = r0 - q*r1, s2 = s0 - q*s1;
+		r0 = r1; r1 = r2;
+		s0 = s1; s1 = s2;
+	}
+	return s0 < 0 ? s0 + p : s0;
+}
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_POLYNOMIAL_WORD_MOD_H
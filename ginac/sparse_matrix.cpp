@@ -0,0 +1,449 @@
+/** @file sparse_matrix.cpp
+ *
+ *  Implementation of the sparse matrix used for solving large sparse linear
+ *  systems.
+ *
+ *  The system is brought into triangular form by Gauss elimination.  In
+ *  every step the pivot is chosen by the Markowitz criterion: an entry in
+ *  a row with r non-zero entries and a column with c non-zero entries can
+ *  create at most (r-1)*(c-1) new non-zero entries, so the entry which
+ *  minimizes this product is used.  Numeric pivots are preferred among
+ *  equally good candidates since dividing by them does not make the
+ *  entries any more complicated. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "sparse_matrix.h"
+#include "matrix.h"
+#include "add.h"
+#include "operators.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace GiNaC {
+
+namespace {
+
+/** Orders row entries by their column. */
+struct entry_col_less {
+	bool operator()(const sparse_matrix::entry & e, unsigned c) const
+	{
+		return e.first < c;
+	}
+};
+
+/** Number of entries of a row which belong to the coefficient matrix. */
+inline unsigned coeff_count(const sparse_matrix::row_type & row, unsigned ncols)
+{
+	return std::lower_bound(row.begin(), row.end(), ncols, entry_col_less()) - row.begin();
+}
+
+/** Bring a freshly computed entry into normal form, so that it can be
+ *  tested for zero. */
+inline void simplify_entry(ex & e)
+{
+	if (!e.info(info_flags::numeric))
+		e = e.normal();
+}
+
+} // anonymous namespace
+
+/** Set up the augmented matrix of the linear system a*x == rhs. */
+sparse_matrix::sparse_matrix(const matrix & a, const matrix & rhs)
+  : nrows(a.rows()), ncols(a.cols()), nrhs(rhs.cols()),
+    rows(nrows), col_count(ncols + nrhs, 0), col_rows(ncols + nrhs),
+    row_done(nrows, false)
+{
+	GINAC_ASSERT(rhs.rows() == nrows);
+	for (unsigned r = 0; r < nrows; ++r)
+		for (unsigned c = 0; c < ncols + nrhs; ++c)
+			rows[r].push_back(entry(c, c < ncols ? a(r, c) : rhs(r, c - ncols)));
+	count_entries();
+}
+
+/** Set up the augmented matrix from its rows, without going through a
+ *  dense matrix.  The entries of every row must be sorted by column, the
+ *  columns ncols to ncols+nrhs-1 belong to the right hand side. */
+sparse_matrix::sparse_matrix(unsigned unknowns, unsigned rhs_cols, const std::vector<row_type> & system)
+  : nrows(system.size()), ncols(unknowns), nrhs(rhs_cols),
+    rows(system), col_count(ncols + nrhs, 0), col_rows(ncols + nrhs),
+    row_done(nrows, false)
+{
+	count_entries();
+}
+
+/** Drop the vanishing entries of all rows and set up the column counts. */
+void sparse_matrix::count_entries()
+{
+	for (unsigned r = 0; r < nrows; ++r) {
+		row_type & row = rows[r];
+		row_type::iterator out = row.begin();
+		for (row_type::const_iterator i = row.begin(); i != row.end(); ++i) {
+			GINAC_ASSERT(i->first < ncols + nrhs);
+			const ex & e = i->second;
+			if (e.is_zero() || (!e.info(info_flags::numeric) && e.expand().is_zero()))
+				continue;
+			*out++ = *i;
+			++col_count[i->first];
+			col_rows[i->first].push_back(r);
+		}
+		row.erase(out, row.end());
+	}
+}
+
+/** Search the pivot with the lowest Markowitz cost among the rows which
+ *  have not been used as pivot rows yet.
+ *
+ *  @return false if these rows have no entries in the coefficient matrix */
+bool sparse_matrix::find_pivot(unsigned & pr, unsigned & pc) const
+{
+	bool found = false;
+	bool best_numeric = false;
+	unsigned long best_cost = 0;
+	for (unsigned r = 0; r < nrows; ++r) {
+		if (row_done[r])
+			continue;
+		const row_type & row = rows[r];
+		const unsigned rc = coeff_count(row, ncols);
+		for (unsigned k = 0; k < rc; ++k) {
+			const unsigned c = row[k].first;
+			const unsigned long cost = (unsigned long)(rc - 1) * (col_count[c] - 1);
+			const bool is_numeric = row[k].second.info(info_flags::numeric);
+			if (!found || cost < best_cost ||
+			    (cost == best_cost && is_numeric && !best_numeric)) {
+				found = true;
+				best_cost = cost;
+				best_numeric = is_numeric;
+				pr = r;
+				pc = c;
+				if (cost == 0 && is_numeric)
+					return true;
+			}
+		}
+	}
+	return found;
+}
+
+/** Subtract factor times the pivot row prow from row r and drop the entry
+ *  in the pivot column pc. */
+void sparse_matrix::update_row(unsigned r, const ex & factor, const row_type & prow, unsigned pc)
+{
+	row_type & row = rows[r];
+	row_type result;
+	result.reserve(row.size() + prow.size());
+
+	row_type::const_iterator i = row.begin(), iend = row.end();
+	row_type::const_iterator j = prow.begin(), jend = prow.end();
+	while (i != iend || j != jend) {
+		if (i != iend && i->first == pc) {
+			--col_count[pc];
+			++i;
+		} else if (j != jend && j->first == pc) {
+			++j;
+		} else if (j == jend || (i != iend && i->first < j->first)) {
+			result.push_back(*i);
+			++i;
+		} else if (i == iend || j->first < i->first) {
+			ex e = -factor * j->second;
+			simplify_entry(e);
+			if (!e.is_zero()) {
+				result.push_back(entry(j->first, e));
+				++col_count[j->first];
+				col_rows[j->first].push_back(r);
+			}
+			++j;
+		} else {
+			ex e = i->second - factor * j->second;
+			simplify_entry(e);
+			if (e.is_zero())
+				--col_count[i->first];
+			else
+				result.push_back(entry(i->first, e));
+			++i;
+			++j;
+		}
+	}
+	row.swap(result);
+}
+
+/** Use the entry (pr, pc) as pivot and eliminate it from all other rows
+ *  which have not been used as pivot rows yet. */
+void sparse_matrix::eliminate_column(unsigned pr, unsigned pc)
+{
+	row_done[pr] = true;
+	pivots.push_back(std::make_pair(pr, pc));
+
+	const row_type & prow = rows[pr];
+	ex piv;
+	for (row_type::const_iterator i = prow.begin(); i != prow.end(); ++i) {
+		--col_count[i->first];
+		if (i->first == pc)
+			piv = i->second;
+	}
+
+	// Rows may appear more than once in col_rows[pc], but after the first
+	// update they do not have an entry in that column any more.
+	std::vector<unsigned> candidates;
+	candidates.swap(col_rows[pc]);
+	for (std::vector<unsigned>::const_iterator r = candidates.begin(); r != candidates.end(); ++r) {
+		if (row_done[*r])
+			continue;
+		const row_type & row = rows[*r];
+		row_type::const_iterator e = std::lower_bound(row.begin(), row.end(), pc, entry_col_less());
+		if (e == row.end() || e->first != pc)
+			continue;
+		update_row(*r, e->second / piv, prow, pc);
+	}
+}
+
+/** Bring the matrix into triangular form, the order of rows and columns
+ *  is given by the chosen pivots. */
+void sparse_matrix::eliminate()
+{
+	unsigned pr, pc;
+	while (find_pivot(pr, pc))
+		eliminate_column(pr, pc);
+}
+
+/** Assemble the solution of the eliminated system.  Unknowns which do not
+ *  correspond to a pivot are free parameters.
+ *
+ *  @param vars ncols x nrhs matrix of symbols
+ *  @exception runtime_error (inconsistent linear system) */
+matrix sparse_matrix::solve(const matrix & vars) const
+{
+	// The rows which were not used as pivots only have entries in the
+	// right hand side, they must be zero
+	for (unsigned r = 0; r < nrows; ++r)
+		if (!row_done[r] && !rows[r].empty())
+			throw (std::runtime_error("matrix::solve(): inconsistent linear system"));
+
+	std::vector<bool> is_free(ncols, true);
+	for (unsigned k = 0; k < pivots.size(); ++k)
+		is_free[pivots[k].second] = false;
+
+	matrix sol(ncols, nrhs);
+	for (unsigned co = 0; co < nrhs; ++co) {
+		for (unsigned c = 0; c < ncols; ++c)
+			if (is_free[c])
+				sol(c, co) = vars(c, co);
+		for (int k = pivots.size() - 1; k >= 0; --k) {
+			const row_type & row = rows[pivots[k].first];
+			const unsigned pc = pivots[k].second;
+			exvector terms;
+			terms.reserve(row.size());
+			ex piv;
+			for (row_type::const_iterator i = row.begin(); i != row.end(); ++i) {
+				if (i->first == pc)
+					piv = i->second;
+				else if (i->first < ncols)
+					terms.push_back(-i->second * sol(i->first, co));
+				else if (i->first == ncols + co)
+					terms.push_back(i->second);
+			}
+			const ex e = (new add(terms))->setflag(status_flags::dynallocated);
+			sol(pc, co) = (e / piv).normal();
+		}
+	}
+	return sol;
+}
+
+/** Decide whether the automatic choice of matrix::solve() should go for
+ *  sparse elimination.  Large sparse systems are best eliminated without
+ *  touching the zeros.  With symbolic entries the choice of pivots pays
+ *  off up to a density of about 40%, and quotients of polynomials are
+ *  always better off with it than with the divisions of Bareiss'
+ *  algorithm (see the timings of check/time_matrix_algorithms.cpp).
+ *
+ *  @param m  number of equations
+ *  @param n  number of unknowns
+ *  @param nonzero  number of non-zero coefficients
+ *  @param numeric_flag  all entries are numeric
+ *  @param normal_flag  some coefficient is a quotient of polynomials */
+bool prefer_sparse_elimination(unsigned m, unsigned n, unsigned nonzero,
+                               bool numeric_flag, bool normal_flag)
+{
+	return m>3 && (5*nonzero<=m*n ||
+	               (!numeric_flag && (normal_flag || 5*nonzero<=2*m*n)));
+}
+
+namespace {
+
+/** Find a perfect matching of the rows and columns of a square matrix,
+ *  i.e. a non-zero entry in every row such that no two of them share a
+ *  column.  This is done by searching augmenting paths (without
+ *  recursion, so that long paths do not exhaust the stack).
+ *
+ *  @param adj  columns of the non-zero entries of every row
+ *  @param row_match  column matched with every row (returned)
+ *  @return false if there is no perfect matching, i.e. the matrix is
+ *          structurally singular */
+bool perfect_matching(const std::vector<std::vector<unsigned> > & adj,
+                      std::vector<unsigned> & row_match)
+{
+	const unsigned n = adj.size();
+	const unsigned none = n;
+	std::vector<unsigned> col_match(n, none);
+	row_match.assign(n, none);
+
+	// cheap assignment first
+	for (unsigned r = 0; r < n; ++r) {
+		for (unsigned k = 0; k < adj[r].size(); ++k) {
+			const unsigned c = adj[r][k];
+			if (col_match[c] == none) {
+				col_match[c] = r;
+				row_match[r] = c;
+				break;
+			}
+		}
+	}
+
+	std::vector<unsigned> visited(n, none);
+	std::vector<std::pair<unsigned, unsigned> > path;  // (row, next edge)
+	std::vector<unsigned> via;  // column leading from path[i] to path[i+1]
+	for (unsigned r0 = 0; r0 < n; ++r0) {
+		if (row_match[r0] != none)
+			continue;
+		path.clear();
+		via.clear();
+		path.push_back(std::make_pair(r0, 0u));
+		unsigned free_col = none;
+		while (!path.empty() && free_col == none) {
+			const unsigned r = path.back().first;
+			if (path.back().second == adj[r].size()) {
+				path.pop_back();
+				if (!via.empty())
+					via.pop_back();
+				continue;
+			}
+			const unsigned c = adj[r][path.back().second++];
+			if (visited[c] == r0)
+				continue;
+			visited[c] = r0;
+			if (col_match[c] == none)
+				free_col = c;
+			else {
+				via.push_back(c);
+				path.push_back(std::make_pair(col_match[c], 0u));
+			}
+		}
+		if (free_col == none)
+			return false;
+		// flip the matching along the path
+		for (unsigned i = path.size(); i-- > 0; ) {
+			const unsigned c = i + 1 == path.size() ? free_col : via[i];
+			row_match[path[i].first] = c;
+			col_match[c] = path[i].first;
+		}
+	}
+	return true;
+}
+
+} // anonymous namespace
+
+/** Compute the block triangular form of a square matrix.  The rows are
+ *  matched with the columns of a perfect matching; row r depends on row s
+ *  if it has a non-zero entry in the column matched with s.  The strongly
+ *  connected components of this graph are the diagonal blocks.  They are
+ *  found with Tarjan's algorithm, which emits every component after all
+ *  the components it depends on.
+ *
+ *  @param adj  columns of the non-zero entries of every row of a square
+ *              matrix
+ *  @param blocks  the diagonal blocks (returned), the rows of every block
+ *                 only have non-zero entries in its columns and in the
+ *                 columns of earlier blocks
+ *  @return false if the matrix is structurally singular */
+bool block_triangular_form(const std::vector<std::vector<unsigned> > & adj,
+                           std::vector<matrix_block> & blocks)
+{
+	const unsigned n = adj.size();
+	std::vector<unsigned> row_match;
+	if (!perfect_matching(adj, row_match))
+		return false;
+	std::vector<unsigned> col_match(n);
+	for (unsigned r = 0; r < n; ++r)
+		col_match[row_match[r]] = r;
+
+	// Tarjan's algorithm, without recursion
+	const unsigned none = n;
+	std::vector<unsigned> index(n, none), low(n, 0);
+	std::vector<bool> on_stack(n, false);
+	std::vector<unsigned> stack;
+	std::vector<std::pair<unsigned, unsigned> > calls;  // (row, next edge)
+	unsigned next_index = 0;
+	blocks.clear();
+	for (unsigned r0 = 0; r0 < n; ++r0) {
+		if (index[r0] != none)
+			continue;
+		calls.push_back(std::make_pair(r0, 0u));
+		index[r0] = low[r0] = next_index++;
+		stack.push_back(r0);
+		on_stack[r0] = true;
+		while (!calls.empty()) {
+			const unsigned v = calls.back().first;
+			if (calls.back().second < adj[v].size()) {
+				const unsigned w = col_match[adj[v][calls.back().second++]];
+				if (index[w] == none) {
+					index[w] = low[w] = next_index++;
+					stack.push_back(w);
+					on_stack[w] = true;
+					calls.push_back(std::make_pair(w, 0u));
+				} else if (on_stack[w] && index[w] < low[v])
+					low[v] = index[w];
+				continue;
+			}
+			calls.pop_back();
+			if (!calls.empty() && low[v] < low[calls.back().first])
+				low[calls.back().first] = low[v];
+			if (low[v] == index[v]) {
+				blocks.push_back(matrix_block());
+				matrix_block & b = blocks.back();
+				unsigned w;
+				do {
+					w = stack.back();
+					stack.pop_back();
+					on_stack[w] = false;
+					b.rows.push_back(w);
+				} while (w != v);
+				std::sort(b.rows.begin(), b.rows.end());
+				for (unsigned i = 0; i < b.rows.size(); ++i)
+					b.cols.push_back(row_match[b.rows[i]]);
+			}
+		}
+	}
+	return true;
+}
+
+/** Compute the block triangular form of the square matrix a. */
+bool block_triangular_form(const matrix & a, std::vector<matrix_block> & blocks)
+{
+	GINAC_ASSERT(a.rows() == a.cols());
+	const unsigned n = a.rows();
+	std::vector<std::vector<unsigned> > adj(n);
+	for (unsigned r = 0; r < n; ++r)
+		for (unsigned c = 0; c < n; ++c)
+			if (!a(r, c).is_zero())
+				adj[r].push_back(c);
+	return block_triangular_form(adj, blocks);
+}
+
+} // namespace GiNaC
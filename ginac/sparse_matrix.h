@@ -0,0 +1,88 @@
+/** @file sparse_matrix.h
+ *
+ *  Interface to the sparse matrix used for solving large sparse linear
+ *  systems. */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef GINAC_SPARSE_MATRIX_H
+#define GINAC_SPARSE_MATRIX_H
+
+#include "ex.h"
+
+#include <utility>
+#include <vector>
+
+namespace GiNaC {
+
+class matrix;
+
+/** Augmented matrix of a sparse linear system.  Every row only stores its
+ *  non-zero entries as (column, value) pairs sorted by column; the columns
+ *  of the right hand side follow the columns of the coefficient matrix.
+ *  This is not a GiNaC class, it is only used internally by
+ *  matrix::solve() and lsolve(). */
+class sparse_matrix {
+public:
+	typedef std::pair<unsigned, ex> entry;
+	typedef std::vector<entry> row_type;
+
+	sparse_matrix(const matrix & a, const matrix & rhs);
+	sparse_matrix(unsigned unknowns, unsigned rhs_cols, const std::vector<row_type> & system);
+
+	void eliminate();
+	matrix solve(const matrix & vars) const;
+
+private:
+	void count_entries();
+	bool find_pivot(unsigned & pr, unsigned & pc) const;
+	void eliminate_column(unsigned pr, unsigned pc);
+	void update_row(unsigned r, const ex & factor, const row_type & prow, unsigned pc);
+
+	unsigned nrows;   ///< number of equations
+	unsigned ncols;   ///< number of unknowns
+	unsigned nrhs;    ///< number of right hand sides
+	std::vector<row_type> rows;
+	/** Number of non-zero entries in every column, only counting rows
+	 *  which have not been used as pivot rows yet. */
+	std::vector<unsigned> col_count;
+	/** Rows which have (or once had) an entry in every column. */
+	std::vector<std::vector<unsigned> > col_rows;
+	std::vector<bool> row_done;
+	/** The pivots (row, column) in the order they were chosen. */
+	std::vector<std::pair<unsigned, unsigned> > pivots;
+};
+
+extern bool prefer_sparse_elimination(unsigned m, unsigned n, unsigned nonzero,
+                                      bool numeric_flag, bool normal_flag);
+
+/** Rows and columns of a diagonal block of a matrix in block triangular
+ *  form. */
+struct matrix_block {
+	std::vector<unsigned> rows;
+	std::vector<unsigned> cols;
+};
+
+extern bool block_triangular_form(const std::vector<std::vector<unsigned> > & adj,
+                                  std::vector<matrix_block> & blocks);
+extern bool block_triangular_form(const matrix & a, std::vector<matrix_block> & blocks);
+
+} // namespace GiNaC
+
+#endif // ndef GINAC_SPARSE_MATRIX_H
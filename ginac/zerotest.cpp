@@ -0,0 +1,430 @@
+/** @file zerotest.cpp
+ *
+ *  Probabilistic zero test of rational expressions (implementation).
+ *
+ *  The interface function is_zero_probabilistic() at the end of this file is
+ *  defined in the GiNaC namespace. All other utility functions and classes
+ *  are defined in an additional anonymous namespace.
+ *
+ *  The expression is evaluated at random points modulo random word-sized
+ *  primes. A symbol x occurring with rational exponents p_i/q_i is replaced
+ *  by r^Q, Q the LCM of the q_i, so that x^(p_i/q_i) = r^(p_i Q/q_i). Like in
+ *  normal(), every other subexpression that is not a rational function
+ *  (functions, constants, roots of sums, ...) is treated as an additional
+ *  symbol. A non-zero value proves that the expression is not zero (as long
+ *  as these additional symbols are algebraically independent).
+ *
+ *  If the numerator of the expression has degree at most d and is not zero,
+ *  it vanishes at a random point modulo p with probability at most d/p
+ *  (Schwartz-Zippel lemma), independent trials make this arbitrarily small.
+ */
+
+/*
+ *  GiNaC Copyright (C) 1999-2014 Johannes Gutenberg University Mainz, Germany
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "normal.h"
+#include "ex.h"
+#include "add.h"
+#include "mul.h"
+#include "power.h"
+#include "numeric.h"
+#include "operators.h"
+#include "symbol.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace GiNaC {
+
+namespace {
+
+typedef unsigned long long umodint;
+
+/** Pseudo random numbers (xorshift64*).  Every seed is scrambled once
+ *  (splitmix64), so that consecutive seeds give unrelated sequences. */
+class random_source
+{
+	umodint state;
+public:
+	explicit random_source(umodint seed)
+	{
+		state = seed + 0x9e3779b97f4a7c15ULL;
+		state = (state ^ (state >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		state = (state ^ (state >> 27)) * 0x94d049bb133111ebULL;
+		state ^= state >> 31;
+		if (state == 0)
+			state = 0x9e3779b97f4a7c15ULL;
+	}
+	umodint operator()()
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545f4914f6cdd1dULL;
+	}
+};
+
+umodint mulmod(umodint a, umodint b, umodint p)
+{
+	return (a * b) % p;
+}
+
+umodint powmod(umodint a, umodint e, umodint p)
+{
+	umodint r = 1;
+	while (e) {
+		if (e & 1)
+			r = mulmod(r, a, p);
+		a = mulmod(a, a, p);
+		e >>= 1;
+	}
+	return r;
+}
+
+/** Deterministic Miller-Rabin test, valid for n < 3215031751. */
+bool is_prime(umodint n)
+{
+	static const umodint bases[] = { 2, 3, 5, 7 };
+	umodint d = n - 1;
+	int s = 0;
+	while (!(d & 1)) {
+		d >>= 1;
+		++s;
+	}
+	for (int i = 0; i < 4; ++i) {
+		if (n == bases[i])
+			return true;
+		umodint x = powmod(bases[i], d, n);
+		if (x == 1 || x == n - 1)
+			continue;
+		bool composite = true;
+		for (int r = 1; r < s && composite; ++r) {
+			x = mulmod(x, x, n);
+			if (x == n - 1)
+				composite = false;
+		}
+		if (composite)
+			return false;
+	}
+	return true;
+}
+
+/** Bits of the primes, products of two residues fit into a machine word. */
+const int prime_bits = 31;
+
+/** Symbols and the LCM of the denominators of their rational exponents. */
+typedef std::map<ex, numeric, ex_is_less> root_map;
+
+bool is_symbol_root(const ex& e)
+{
+	return is_exactly_a<power>(e) && is_a<symbol>(e.op(0)) &&
+	       e.op(1).info(info_flags::rational) &&
+	       !e.op(1).info(info_flags::integer);
+}
+
+void collect_roots(const ex& e, root_map& roots)
+{
+	if (is_symbol_root(e)) {
+		root_map::iterator i = roots.find(e.op(0));
+		const numeric q = ex_to<numeric>(e.op(1)).denom();
+		if (i == roots.end())
+			roots.insert(std::make_pair(e.op(0), q));
+		else
+			i->second = lcm(i->second, q);
+	} else {
+		for (size_t i = 0; i < e.nops(); ++i)
+			collect_roots(e.op(i), roots);
+	}
+}
+
+/** Exponent of r in x^k = r^(k Q), with Q = 1 for symbols without roots. */
+numeric root_exponent(const ex& x, const numeric& k, const root_map& roots)
+{
+	root_map::const_iterator i = roots.find(x);
+	return i == roots.end() ? k : k*i->second;
+}
+
+/** Evaluation of an expression modulo p at one point. */
+class modular_evaluator
+{
+public:
+	modular_evaluator(umodint p_, umodint i_, const root_map& roots_,
+			  random_source& rnd_)
+		: p(p_), imag_unit(i_), roots(roots_), rnd(rnd_) { }
+
+	/** Value of e, returns false if a denominator vanishes. */
+	bool eval(const ex& e, umodint& v);
+
+private:
+	bool eval_numeric(const numeric& n, umodint& v) const;
+	bool eval_rational(const numeric& n, umodint& v) const;
+	umodint eval_generic(const ex& e);
+	bool eval_power(umodint b, const numeric& k, umodint& v) const;
+
+	const umodint p;
+	const umodint imag_unit; // square root of -1 modulo p
+	const root_map& roots;
+	random_source& rnd;
+	std::map<ex, umodint, ex_is_less> values;
+};
+
+bool modular_evaluator::eval_rational(const numeric& n, umodint& v) const
+{
+	const numeric pn(static_cast<long>(p));
+	const umodint den = mod(n.denom(), pn).to_long();
+	if (den == 0)
+		return false;
+	const umodint num = mod(n.numer(), pn).to_long();
+	v = mulmod(num, powmod(den, p - 2, p), p);
+	return true;
+}
+
+bool modular_evaluator::eval_numeric(const numeric& n, umodint& v) const
+{
+	if (n.is_rational())
+		return eval_rational(n, v);
+	umodint re, im;
+	if (!eval_rational(n.real(), re) || !eval_rational(n.imag(), im))
+		return false;
+	v = (re + mulmod(im, imag_unit, p)) % p;
+	return true;
+}
+
+/** Random value of a symbol or of a subexpression that is not a rational
+ *  function, equal subexpressions get equal values. */
+umodint modular_evaluator::eval_generic(const ex& e)
+{
+	std::map<ex, umodint, ex_is_less>::const_iterator i = values.find(e);
+	if (i != values.end())
+		return i->second;
+	const umodint v = rnd() % p;
+	values.insert(std::make_pair(e, v));
+	return v;
+}
+
+/** v = b^k, returns false for negative powers of 0. */
+bool modular_evaluator::eval_power(umodint b, const numeric& k, umodint& v) const
+{
+	if (b == 0) {
+		if (k.is_negative())
+			return false;
+		v = k.is_zero() ? 1 : 0;
+		return true;
+	}
+	// Fermat, the exponent may be huge
+	const umodint ek = mod(abs(k), numeric(static_cast<long>(p - 1))).to_long();
+	v = powmod(b, ek, p);
+	if (k.is_negative())
+		v = powmod(v, p - 2, p);
+	return true;
+}
+
+bool modular_evaluator::eval(const ex& e, umodint& v)
+{
+	if (is_exactly_a<numeric>(e)) {
+		const numeric& n = ex_to<numeric>(e);
+		if (n.is_crational())
+			return eval_numeric(n, v);
+		v = eval_generic(e);
+		return true;
+	}
+	if (is_exactly_a<add>(e)) {
+		umodint sum = 0, t;
+		for (size_t i = 0; i < e.nops(); ++i) {
+			if (!eval(e.op(i), t))
+				return false;
+			sum = (sum + t) % p;
+		}
+		v = sum;
+		return true;
+	}
+	if (is_exactly_a<mul>(e)) {
+		umodint prod = 1, t;
+		for (size_t i = 0; i < e.nops(); ++i) {
+			if (!eval(e.op(i), t))
+				return false;
+			prod = mulmod(prod, t, p);
+		}
+		v = prod;
+		return true;
+	}
+	if (is_a<symbol>(e))
+		return eval_power(eval_generic(e), root_exponent(e, *_num1_p, roots), v);
+	if (is_symbol_root(e))
+		return eval_power(eval_generic(e.op(0)),
+				  root_exponent(e.op(0), ex_to<numeric>(e.op(1)), roots), v);
+	if (is_exactly_a<power>(e) && e.op(1).info(info_flags::integer)) {
+		umodint b;
+		if (!eval(e.op(0), b))
+			return false;
+		return eval_power(b, ex_to<numeric>(e.op(1)), v);
+	}
+	v = eval_generic(e);
+	return true;
+}
+
+/** Bounds on the total degrees of a numerator and a denominator of e, where
+ *  every subexpression that is not a rational function counts as a symbol. */
+void degree_bounds(const ex& e, const root_map& roots, double& dnum, double& dden)
+{
+	if (is_a<symbol>(e)) {
+		dnum = root_exponent(e, *_num1_p, roots).to_double();
+		dden = 0;
+	} else if (is_symbol_root(e)) {
+		const double k = root_exponent(e.op(0), ex_to<numeric>(e.op(1)), roots).to_double();
+		dnum = std::max(k, 0.0);
+		dden = std::max(-k, 0.0);
+	} else if (is_exactly_a<numeric>(e)) {
+		const numeric& n = ex_to<numeric>(e);
+		dnum = n.is_crational() ? 0 : 1;
+		dden = 0;
+	} else if (is_exactly_a<add>(e)) {
+		// a_1/b_1 + ... + a_n/b_n = (a_1 b_2 \ldots b_n + \ldots)/(b_1 \ldots b_n)
+		std::vector<double> nums(e.nops()), dens(e.nops());
+		double sum_dens = 0;
+		for (size_t i = 0; i < e.nops(); ++i) {
+			degree_bounds(e.op(i), roots, nums[i], dens[i]);
+			sum_dens += dens[i];
+		}
+		dnum = 0;
+		for (size_t i = 0; i < e.nops(); ++i)
+			dnum = std::max(dnum, nums[i] + sum_dens - dens[i]);
+		dden = sum_dens;
+	} else if (is_exactly_a<mul>(e)) {
+		dnum = dden = 0;
+		for (size_t i = 0; i < e.nops(); ++i) {
+			double n, d;
+			degree_bounds(e.op(i), roots, n, d);
+			dnum += n;
+			dden += d;
+		}
+	} else if (is_exactly_a<power>(e) && e.op(1).info(info_flags::integer)) {
+		double n, d;
+		degree_bounds(e.op(0), roots, n, d);
+		const double k = ex_to<numeric>(e.op(1)).to_double();
+		if (k >= 0) {
+			dnum = k*n;
+			dden = k*d;
+		} else {
+			dnum = -k*d;
+			dden = -k*n;
+		}
+	} else {
+		dnum = 1;
+		dden = 0;
+	}
+}
+
+/** Seed for a call of is_zero_probabilistic() without a seed of its own.
+ *  Different calls (and different runs) get different points, so that an
+ *  unlucky point for one expression is not hit again and again. */
+umodint next_seed()
+{
+	static umodint counter = static_cast<umodint>(std::time(0)) << 32;
+	return ++counter;
+}
+
+} // anonymous namespace
+
+/** Test whether an expression is zero as a rational function.
+ *
+ *  The expression is evaluated at random points modulo random primes of
+ *  31 bits, no expansion or normalization takes place.  Rational powers of
+ *  symbols are fine.  Like in normal(), other subexpressions which are not
+ *  rational functions of their symbols are regarded as additional symbols,
+ *  so for example sin(x)^2+cos(x)^2-1 is not zero in this sense.
+ *
+ *  A result of false is correct, unless these additional symbols are
+ *  related algebraically (like sqrt(1+x) and 1+x).  A result of true is
+ *  wrong with probability at most 2^(-confidence).  (Strictly speaking this
+ *  assumes that the random primes do not divide all coefficients of the
+ *  numerator, which is exceedingly unlikely.)
+ *
+ *  @param e  expression to test
+ *  @param confidence  number of bits of confidence
+ *  @param error  if not 0, the bound on the error probability of the result
+ *         is stored there (0 if the result is exact)
+ *  @param exact_fallback  if true, decide by normal() if the modular test
+ *         is not applicable (degree bound too large, vanishing denominators),
+ *         otherwise throw an exception in this case
+ *  @param seed  if not 0, the random points and primes are derived from it,
+ *         so that the result is reproducible; by default every call uses
+ *         fresh ones
+ *  @return true if e is zero (probably), false if e is not zero
+ *  @exception runtime_error (test not applicable and no fallback requested) */
+bool is_zero_probabilistic(const ex & e, unsigned confidence, double * error, bool exact_fallback,
+                           unsigned long seed)
+{
+	if (error)
+		*error = 0;
+	if (e.is_zero())
+		return true;
+
+	root_map roots;
+	collect_roots(e, roots);
+	double dnum, dden;
+	degree_bounds(e, roots, dnum, dden);
+
+	// Probability that a single trial fails to detect a non-zero numerator
+	const double single_error = dnum / std::ldexp(1.0, prime_bits - 1);
+	if (single_error < 1) {
+		const unsigned trials = single_error > 0 ?
+			std::max(1, int(std::ceil(confidence / -std::log(single_error) * std::log(2.0)))) : 1;
+		random_source rnd(seed ? seed : next_seed());
+		unsigned successful = 0, unlucky = 0;
+		while (successful < trials && unlucky < trials + 10) {
+			// random prime p = 1 mod 4 in [2^30, 2^31), so that -1 is a square
+			umodint p;
+			do {
+				p = ((rnd() % (1ULL << (prime_bits - 1))) | (1ULL << (prime_bits - 1))) & ~3ULL;
+				p |= 1;
+			} while (!is_prime(p));
+			umodint imag_unit;
+			do {
+				imag_unit = powmod(rnd() % (p - 2) + 2, (p - 1) / 4, p);
+			} while (mulmod(imag_unit, imag_unit, p) != p - 1);
+
+			modular_evaluator ev(p, imag_unit, roots, rnd);
+			umodint v;
+			if (!ev.eval(e, v)) {
+				// vanishing denominator, try another point
+				++unlucky;
+				continue;
+			}
+			if (v != 0)
+				return false;
+			++successful;
+		}
+		if (successful == trials) {
+			if (error)
+				*error = std::pow(single_error, double(trials));
+			return true;
+		}
+	}
+
+	if (!exact_fallback)
+		throw std::runtime_error("is_zero_probabilistic(): modular evaluation not applicable");
+	return e.normal().is_zero();
+}
+
+} // namespace GiNaC